@@ -0,0 +1,187 @@
+﻿#pragma once
+
+/*
+* Micro-benchmark harness
+*
+* Each benchmark is warmed up, calibrated so one repetition takes
+* roughly `target_rep_time`, then timed for `repetitions` batches.
+* Results are reported as median/MAD ns per operation.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+template <typename T>
+inline void do_not_optimize(T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile char sink;
+  sink = *reinterpret_cast<volatile char*>(&value);
+  _ReadWriteBarrier();
+#endif
+}
+
+struct BenchResult {
+  std::string name;
+  double median_ns;
+  double mad_ns;
+  double items_per_second;
+  std::size_t iterations;
+  std::size_t repetitions;
+};
+
+struct BenchOptions {
+  std::string filter;
+  std::size_t repetitions = 15;
+  std::chrono::milliseconds warmup_time{50};
+  std::chrono::milliseconds target_rep_time{10};
+};
+
+class BenchRunner {
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit BenchRunner(BenchOptions options) : m_options{std::move(options)} {}
+
+  // fn(iterations) must perform `iterations` operations; each operation processes `items` items.
+  template <typename Fn>
+  void run(const std::string& name, const double items, Fn&& fn) {
+    if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos) return;
+
+    // Warm-up, doubling the batch until it is long enough to time reliably.
+    std::size_t iterations = 1;
+    const auto warmup_end = clock::now() + m_options.warmup_time;
+    double batch_ns = 0.0;
+    do {
+      batch_ns = time_batch(fn, iterations);
+      if (batch_ns < static_cast<double>(std::chrono::nanoseconds(m_options.target_rep_time).count()) / 2.0) {
+        iterations *= 2;
+      }
+    } while (clock::now() < warmup_end);
+
+    const double target_ns = static_cast<double>(std::chrono::nanoseconds(m_options.target_rep_time).count());
+    const double per_op_ns = std::max(batch_ns / static_cast<double>(iterations), 1e-3);
+    iterations = std::max<std::size_t>(1, static_cast<std::size_t>(target_ns / per_op_ns));
+
+    std::vector<double> samples;
+    samples.reserve(m_options.repetitions);
+    for (std::size_t rep = 0; rep < m_options.repetitions; ++rep) {
+      samples.push_back(time_batch(fn, iterations) / static_cast<double>(iterations));
+    }
+
+    BenchResult result{};
+    result.name = name;
+    result.median_ns = median(samples);
+    for (double& sample : samples) sample = std::abs(sample - result.median_ns);
+    result.mad_ns = median(samples);
+    result.items_per_second = result.median_ns > 0.0 ? items * 1e9 / result.median_ns : 0.0;
+    result.iterations = iterations;
+    result.repetitions = m_options.repetitions;
+
+    std::printf("%-40s %12.2f ns/op  +-%8.2f  %14.0f items/s\n", name.c_str(), result.median_ns, result.mad_ns,
+                result.items_per_second);
+    m_results.push_back(result);
+  }
+
+  [[nodiscard]] const std::vector<BenchResult>& get_results() const { return m_results; }
+
+  bool write_json(const std::string& filename) const {
+    nlohmann::json benchmarks = nlohmann::json::array();
+    for (const BenchResult& result : m_results) {
+      benchmarks.push_back({
+        {"name", result.name},
+        {"median_ns", result.median_ns},
+        {"mad_ns", result.mad_ns},
+        {"items_per_second", result.items_per_second},
+        {"iterations", result.iterations},
+        {"repetitions", result.repetitions}
+      });
+    }
+
+    std::ofstream file(filename);
+    if (!file) return false;
+    file << nlohmann::json{{"benchmarks", benchmarks}}.dump(2);
+    return static_cast<bool>(file);
+  }
+
+  // Flags results slower than the baseline by more than `threshold` (relative) and more than
+  // three MADs of combined noise. Returns the number of regressions, or -1 if the baseline is unreadable.
+  int compare(const std::string& baseline_filename, const double threshold) const {
+    std::ifstream file(baseline_filename);
+    if (!file) {
+      std::cerr << "ERROR: Cannot open baseline " << baseline_filename << '\n';
+      return -1;
+    }
+
+    nlohmann::json baseline;
+    try {
+      file >> baseline;
+    }
+    catch (const nlohmann::json::exception& e) {
+      std::cerr << "ERROR: Cannot parse baseline " << baseline_filename << ": " << e.what() << '\n';
+      return -1;
+    }
+
+    if (!baseline.is_object() || !baseline.contains("benchmarks") || !baseline["benchmarks"].is_array()) {
+      std::cerr << "ERROR: Baseline " << baseline_filename << " has no \"benchmarks\" array\n";
+      return -1;
+    }
+    const nlohmann::json& entries = baseline["benchmarks"];
+    // Fields of a hand-edited or older baseline may be missing or of the wrong type.
+    const auto number_or = [](const nlohmann::json& entry, const char* key, const double fallback) {
+      const auto field = entry.find(key);
+      return field != entry.end() && field->is_number() ? field->get<double>() : fallback;
+    };
+
+    int regressions = 0;
+    std::printf("\n%-40s %12s %12s %9s\n", "benchmark", "baseline", "current", "delta");
+    for (const BenchResult& result : m_results) {
+      const auto it = std::find_if(entries.begin(), entries.end(), [&](const nlohmann::json& entry) {
+        const auto name = entry.find("name");
+        return name != entry.end() && name->is_string() && name->get<std::string>() == result.name;
+      });
+      if (it == entries.end()) continue;
+
+      const double base_ns = number_or(*it, "median_ns", -1.0);
+      if (base_ns < 0.0) continue;
+      const double base_mad = number_or(*it, "mad_ns", 0.0);
+      const double delta = base_ns > 0.0 ? (result.median_ns - base_ns) / base_ns : 0.0;
+      const bool regressed = delta > threshold && result.median_ns - base_ns > 3.0 * (base_mad + result.mad_ns);
+      if (regressed) ++regressions;
+
+      std::printf("%-40s %12.2f %12.2f %+8.1f%% %s\n", result.name.c_str(), base_ns, result.median_ns, delta * 100.0,
+                  regressed ? "REGRESSION" : "");
+    }
+    return regressions;
+  }
+
+private:
+  BenchOptions m_options;
+  std::vector<BenchResult> m_results;
+
+  template <typename Fn>
+  static double time_batch(Fn& fn, const std::size_t iterations) {
+    const auto start = clock::now();
+    fn(iterations);
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+  }
+
+  static double median(std::vector<double> values) {
+    const auto mid = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+  }
+};
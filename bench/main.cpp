@@ -0,0 +1,354 @@
+﻿#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+#include "bench.h"
+
+#include "BufferSuballocator.h"
+#include "Camera.h"
+#include "DensityRaster.h"
+#include "DirtyRanges.h"
+#include "EditJournal.h"
+#include "Scene.h"
+#include "Triangle.h"
+#include "TriangleBvh.h"
+#include "VertexWelder.h"
+#include "geometry.h"
+#include "heron.h"
+#include "saves.h"
+#include "scene_generator.h"
+
+namespace {
+  void print_usage() {
+    std::cout << "Usage: heron_bench [--filter <substring>] [--repetitions <n>] [--json <out.json>]\n"
+                 "                   [--compare <baseline.json>] [--threshold <fraction>]\n"
+                 "       heron_bench --verify\n";
+  }
+
+  std::vector<glm::vec2> random_points(const std::size_t count, const float extent, std::mt19937& rng) {
+    std::uniform_real_distribution<float> dist(-extent, extent);
+    std::vector<glm::vec2> points(count);
+    for (glm::vec2& point : points) point = {dist(rng), dist(rng)};
+    return points;
+  }
+
+  // Reports a failed check; returns whether it passed.
+  bool check(const bool passed, const char* name) {
+    if (!passed) std::cerr << "FAILED: " << name << '\n';
+    return passed;
+  }
+
+  // Welded indices as the welder promises them: each vertex joins the lowest earlier vertex within epsilon.
+  std::vector<std::uint32_t> weld_brute_force(const std::vector<glm::vec2>& vertices, const float epsilon) {
+    std::vector<std::uint32_t> indices(vertices.size());
+    std::uint32_t unique = 0;
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+      indices[i] = unique;
+      for (std::size_t j = 0; j < i; ++j) {
+        if (distance_squared(vertices[i], vertices[j]) <= epsilon * epsilon) {
+          indices[i] = indices[j];
+          break;
+        }
+      }
+      if (indices[i] == unique) ++unique;
+    }
+    return indices;
+  }
+
+  // Correctness checks for the structures benchmarked below. Returns the number of failures.
+  int verify() {
+    int failures = 0;
+    VertexWelder welder;
+    const auto welds_like_brute_force = [&](const std::vector<glm::vec2>& vertices, const float epsilon) {
+      welder.weld(vertices, epsilon);
+      return welder.get_indices() == weld_brute_force(vertices, epsilon);
+    };
+
+    // Corners far from the first vertex of their cell still weld with each other.
+    failures += !check(welds_like_brute_force({{0.05f, 0.05f}, {0.95f, 0.95f}, {0.95f, 0.95f}}, 1.0f),
+                       "VertexWelder: identical corners behind a distant cell neighbour");
+    failures += !check(welds_like_brute_force({{1e-5f, 1e-5f}, {9.9e-5f, 9.9e-5f}, {9.9e-5f, 9.9e-5f}},
+                                              VertexWelder::DEFAULT_EPSILON),
+                       "VertexWelder: identical corners at the default epsilon");
+    // Coordinates whose cell index does not fit in 32 bits share the clamped edge cell.
+    failures += !check(welds_like_brute_force({{3e38f, -3e38f}, {3e38f, -3e38f}, {1e30f, 0.0f}, {1e30f, 0.0f}},
+                                              VertexWelder::DEFAULT_EPSILON),
+                       "VertexWelder: corners far outside the cell range");
+
+    // Clustered corners, on one thread and split across workers.
+    std::mt19937 rng{3};
+    for (const std::size_t count : {std::size_t{2000}, VertexWelder::PARALLEL_THRESHOLD * 2}) {
+      std::vector<glm::vec2> vertices = random_points(count / 4, 2.0f, rng);
+      std::uniform_int_distribution<std::size_t> pick(0, vertices.size() - 1);
+      std::uniform_real_distribution<float> jitter(-0.01f, 0.01f);
+      while (vertices.size() < count) vertices.push_back(vertices[pick(rng)] + glm::vec2{jitter(rng), jitter(rng)});
+      failures += !check(welds_like_brute_force(vertices, 0.01f), "VertexWelder: clustered corners");
+    }
+
+    // A welded drag moves two corners per event; the group still holds one delta per corner.
+    Scene scene;
+    const ObjectId first = scene.add_triangle({glm::vec2{0.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, 1.0f}});
+    const ObjectId second = scene.add_triangle({glm::vec2{0.0f, 0.0f}, {-1.0f, 0.0f}, {0.0f, -1.0f}});
+    EditJournal journal;
+    journal.begin_group();
+    for (int step = 1; step <= 100; ++step) {
+      const glm::vec2 position{0.01f * static_cast<float>(step), 0.0f};
+      for (const ObjectId id : {first, second}) {
+        journal.record(id, 0, scene.get(id)->triangle.get_vertices()[0], position);
+        scene.move_vertex(id, 0, position);
+      }
+    }
+    journal.end_group();
+    failures += !check(journal.get_stats().memory_bytes == sizeof(std::uint32_t) + 2 * sizeof(VertexEdit),
+                       "EditJournal: interleaved drag coalesces per vertex");
+    journal.undo(scene);
+    failures += !check(scene.get(first)->triangle.get_vertices()[0] == glm::vec2{0.0f, 0.0f} &&
+                       scene.get(second)->triangle.get_vertices()[0] == glm::vec2{0.0f, 0.0f},
+                       "EditJournal: undo restores the drag start");
+
+    if (failures == 0) std::cout << "INFO: All checks passed\n";
+    return failures;
+  }
+}
+
+int main(int argc, char** argv) {
+  BenchOptions options;
+  std::string json_path;
+  std::string baseline_path;
+  double threshold = 0.10;
+  bool run_verify = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "--filter") == 0 && has_value) options.filter = argv[++i];
+    else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value) options.repetitions = std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--json") == 0 && has_value) json_path = argv[++i];
+    else if (std::strcmp(argv[i], "--compare") == 0 && has_value) baseline_path = argv[++i];
+    else if (std::strcmp(argv[i], "--threshold") == 0 && has_value) threshold = std::strtod(argv[++i], nullptr);
+    else if (std::strcmp(argv[i], "--verify") == 0) run_verify = true;
+    else {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+  options.repetitions = std::max<std::size_t>(options.repetitions, 1);
+  if (run_verify) return verify() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  BenchRunner runner{options};
+  std::mt19937 rng{42};
+
+  {
+    const std::vector<glm::vec2> sides = random_points(1024, 10.0f, rng);
+    runner.run("HeronSteps::calculate", 1, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        const glm::vec2& ab = sides[i & 1023];
+        HeronSteps steps{std::abs(ab.x), std::abs(ab.y), 5.0f, 0.0f, 0.0f, false};
+        steps.calculate();
+        do_not_optimize(steps);
+      }
+    });
+  }
+
+  {
+    Triangle triangle(3.0f, 4.0f, 5.0f);
+    const glm::vec2 positions[2] = {{1.0f, 3.0f}, {2.0f, 4.0f}};
+    runner.run("Triangle::move_vertex (sides + area)", 1, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        triangle.move_vertex(2, positions[i & 1]);
+        float area = triangle.get_area();
+        do_not_optimize(area);
+      }
+    });
+  }
+
+  {
+    const std::vector<glm::vec2> points = random_points(4096, 20.0f, rng);
+    runner.run("snap_to_grid", 4096, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        for (const glm::vec2& point : points) {
+          glm::vec2 snapped = snap_to_grid(point);
+          do_not_optimize(snapped);
+        }
+      }
+    });
+  }
+
+  {
+    const glm::vec2 window_size{1000.0f, 800.0f};
+    const Camera camera{window_size, {1.5f, -2.0f}};
+    std::vector<glm::vec2> cursor = random_points(4096, 400.0f, rng);
+    for (glm::vec2& point : cursor) point += glm::vec2(500.0f, 400.0f);
+
+    runner.run("screen_to_world", 4096, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        for (const glm::vec2& point : cursor) {
+          glm::vec2 world = screen_to_world(camera, window_size, point);
+          do_not_optimize(world);
+        }
+      }
+    });
+  }
+
+  {
+    const Triangle triangle(3.0f, 4.0f, 5.0f);
+    const std::vector<glm::vec2> probes = random_points(4096, 6.0f, rng);
+    runner.run("pick_vertex", 4096, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        for (const glm::vec2& probe : probes) {
+          int picked = pick_vertex(triangle.get_vertices(), probe);
+          do_not_optimize(picked);
+        }
+      }
+    });
+  }
+
+  {
+    Scene scene;
+    std::vector<ObjectId> ids;
+    runner.run("Scene add_triangle + remove", 1024, [&](const std::size_t iterations) {
+      const Triangle triangle(3.0f, 4.0f, 5.0f);
+      for (std::size_t i = 0; i < iterations; ++i) {
+        ids.clear();
+        for (int n = 0; n < 1024; ++n) ids.push_back(scene.add_triangle(triangle.get_vertices()));
+        for (const ObjectId id : ids) scene.remove(id);
+      }
+    });
+  }
+
+  {
+    // Mixed mesh sizes, freed in a scattered order so the free list has to merge neighbours.
+    std::vector<std::size_t> sizes(1024);
+    std::uniform_int_distribution<std::size_t> size_dist(3, 300);
+    for (std::size_t& size : sizes) size = size_dist(rng);
+    std::vector<std::size_t> offsets(sizes.size());
+    runner.run("BufferSuballocator allocate + free", sizes.size(), [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        BufferSuballocator allocator{1 << 20};
+        for (std::size_t n = 0; n < sizes.size(); ++n) offsets[n] = allocator.allocate(sizes[n]);
+        for (std::size_t n = 0; n < sizes.size(); n += 2) allocator.free(offsets[n], sizes[n]);
+        for (std::size_t n = 1; n < sizes.size(); n += 2) allocator.free(offsets[n], sizes[n]);
+        do_not_optimize(allocator);
+      }
+    });
+  }
+
+  {
+    // Scattered single-element edits, as a multi-vertex drag produces them.
+    std::vector<std::size_t> edits(4096);
+    std::uniform_int_distribution<std::size_t> edit_dist(0, 1 << 20);
+    for (std::size_t& edit : edits) edit = edit_dist(rng);
+    DirtyRanges ranges;
+    runner.run("DirtyRanges add + coalesce", edits.size(), [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        ranges.clear();
+        for (const std::size_t edit : edits) ranges.add(edit);
+        ranges.coalesce(64);
+        do_not_optimize(ranges);
+      }
+    });
+  }
+
+  {
+    // A zoomed-in view over a large scene: the visible set is a few percent of it.
+    constexpr std::size_t SCENE_TRIANGLES = 100000;
+    const std::vector<glm::vec2> vertices = generate_random_triangles(SCENE_TRIANGLES, 11);
+    Scene scene;
+    scene.reserve(SCENE_TRIANGLES);
+    for (std::size_t i = 0; i < vertices.size(); i += 3) scene.add_triangle({vertices[i], vertices[i + 1], vertices[i + 2]});
+    std::vector<std::uint32_t> visible;
+    const Bounds2D view{{-10.0f, -8.0f}, {10.0f, 8.0f}};
+    runner.run("Scene::query_box (100k triangles)", 1, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        scene.query_box(view, visible);
+        do_not_optimize(visible);
+      }
+    });
+
+    std::mt19937 rng{17};
+    const std::vector<glm::vec2> probes = random_points(1024, 100.0f, rng);
+    runner.run("Scene::pick_vertex (100k triangles)", probes.size(), [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        for (const glm::vec2& probe : probes) {
+          VertexRef picked = scene.pick_vertex(probe);
+          do_not_optimize(picked);
+        }
+      }
+    });
+  }
+
+  {
+    constexpr std::size_t SCENE_TRIANGLES = 100000;
+    const std::vector<glm::vec2> vertices = generate_random_triangles(SCENE_TRIANGLES, 13);
+    Scene scene;
+    scene.reserve(SCENE_TRIANGLES);
+    for (std::size_t i = 0; i < vertices.size(); i += 3) scene.add_triangle({vertices[i], vertices[i + 1], vertices[i + 2]});
+    const std::shared_ptr<const SceneSnapshot> snapshot = scene.make_snapshot();
+    runner.run("DensityRaster::build (100k triangles)", SCENE_TRIANGLES, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        DensityRaster::Image image = DensityRaster::build(*snapshot);
+        do_not_optimize(image);
+      }
+    });
+  }
+
+  {
+    constexpr std::size_t SCENE_TRIANGLES = 100000;
+    const std::vector<glm::vec2> vertices = generate_random_triangles(SCENE_TRIANGLES, 19);
+    TriangleBvh bvh;
+    bvh.build(vertices);
+
+    std::mt19937 rng{23};
+    const std::vector<glm::vec2> points = random_points(65536, 100.0f, rng);
+    std::vector<std::uint32_t> results(points.size());
+    runner.run("TriangleBvh::classify (100k triangles)", points.size(), [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        bvh.classify(points, results);
+        do_not_optimize(results);
+      }
+    });
+  }
+
+  {
+    constexpr std::size_t SCENE_TRIANGLES = 1000;
+    const std::string path = (std::filesystem::temp_directory_path() / "heron_bench_scene.json").string();
+    const std::vector<glm::vec2> vertices = generate_random_triangles(SCENE_TRIANGLES, 7);
+    Scene scene;
+    for (std::size_t i = 0; i < vertices.size(); i += 3) scene.add_triangle({vertices[i], vertices[i + 1], vertices[i + 2]});
+
+    runner.run("save_scene_to_file (1k triangles)", SCENE_TRIANGLES, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        save_scene_to_file(path, scene);
+      }
+    });
+
+    runner.run("load_scene_from_file (1k triangles)", SCENE_TRIANGLES, [&](const std::size_t iterations) {
+      for (std::size_t i = 0; i < iterations; ++i) {
+        load_scene_from_file(path, scene);
+        std::size_t size = scene.size();
+        do_not_optimize(size);
+      }
+    });
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+  }
+
+  if (!json_path.empty()) {
+    if (!runner.write_json(json_path)) {
+      std::cerr << "ERROR: Failed to write " << json_path << '\n';
+      return EXIT_FAILURE;
+    }
+    std::cout << "INFO: Wrote results to " << json_path << '\n';
+  }
+
+  if (!baseline_path.empty()) {
+    const int regressions = runner.compare(baseline_path, threshold);
+    if (regressions != 0) {
+      if (regressions > 0) std::cerr << "ERROR: " << regressions << " benchmark(s) regressed\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
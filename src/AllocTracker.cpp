@@ -0,0 +1,359 @@
+﻿#include "AllocTracker.h"
+
+#include <imgui.h>
+
+#ifdef HERON_TRACK_ALLOCATIONS
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#if defined(HERON_PLATFORM_WINDOWS)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <malloc.h>
+#elif defined(HERON_PLATFORM_LINUX)
+#include <execinfo.h>
+#endif
+
+namespace {
+  constexpr std::size_t MAX_ZONE_DEPTH = 64;
+  constexpr std::size_t MAX_VIOLATIONS = 8;
+
+  // Everything here is constant-initialized: operator new can run before any dynamic initializer.
+  struct ZoneSlot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> bytes{0};
+    // Render thread only, updated by new_frame().
+    std::uint64_t frame_start_allocations = 0;
+    std::uint64_t frame_start_bytes = 0;
+    std::uint64_t last_allocations = 0;
+    std::uint64_t last_bytes = 0;
+  };
+
+  ZoneSlot g_zones[AllocTracker::MAX_ZONES];
+  std::atomic<std::uint64_t> g_allocations{0};
+  std::atomic<std::uint64_t> g_frees{0};
+  std::atomic<std::uint64_t> g_bytes{0};
+  AllocTracker::Counters g_frame_start{};
+  AllocTracker::Counters g_last_frame{};
+
+  std::atomic<std::uint32_t> g_sample_rate{0};
+  std::atomic_flag g_sample_lock = ATOMIC_FLAG_INIT; // try-lock only, the hook never waits
+  AllocTracker::Callsite g_samples[AllocTracker::SAMPLE_HISTORY]{};
+  std::size_t g_sample_count = 0;
+
+  std::atomic<std::uint64_t> g_violations{0};
+  AllocTracker::Callsite g_violation_sites[MAX_VIOLATIONS]{};
+
+  thread_local const char* t_zones[MAX_ZONE_DEPTH];
+  thread_local std::size_t t_zone_depth = 0;
+  thread_local bool t_in_hook = false;
+  thread_local bool t_watched = false;
+
+  const char* current_zone() {
+    if (t_zone_depth == 0) return nullptr;
+    return t_zones[std::min(t_zone_depth, MAX_ZONE_DEPTH) - 1];
+  }
+
+  // Open addressing keyed by the name pointer; zone names are literals or interned.
+  ZoneSlot* find_zone(const char* name) {
+    std::size_t index = (reinterpret_cast<std::uintptr_t>(name) >> 3) % AllocTracker::MAX_ZONES;
+    for (std::size_t probe = 0; probe < AllocTracker::MAX_ZONES; ++probe) {
+      ZoneSlot& slot = g_zones[index];
+      const char* current = slot.name.load(std::memory_order_acquire);
+      if (current == nullptr && slot.name.compare_exchange_strong(current, name, std::memory_order_acq_rel)) {
+        return &slot;
+      }
+      if (current == name) return &slot;
+      index = (index + 1) % AllocTracker::MAX_ZONES;
+    }
+    return nullptr;
+  }
+
+  void capture(AllocTracker::Callsite& site, const std::size_t bytes) {
+    site.zone = current_zone();
+    site.bytes = bytes;
+#if defined(HERON_PLATFORM_LINUX)
+    site.depth = static_cast<std::size_t>(backtrace(site.frames, static_cast<int>(AllocTracker::MAX_STACK_DEPTH)));
+#elif defined(HERON_PLATFORM_WINDOWS)
+    site.depth = CaptureStackBackTrace(0, static_cast<DWORD>(AllocTracker::MAX_STACK_DEPTH), site.frames, nullptr);
+#else
+    site.depth = 0;
+#endif
+  }
+
+  // Calls fn(line) for every frame of the call stack, symbolized where the platform allows.
+  template <typename Fn>
+  void for_each_frame(const AllocTracker::Callsite& site, Fn&& fn) {
+#if defined(HERON_PLATFORM_LINUX)
+    // backtrace_symbols() uses malloc, so it is not counted.
+    char** symbols = backtrace_symbols(site.frames, static_cast<int>(site.depth));
+    if (symbols) {
+      for (std::size_t i = 0; i < site.depth; ++i) fn(symbols[i]);
+      std::free(symbols);
+      return;
+    }
+#endif
+    char line[32];
+    for (std::size_t i = 0; i < site.depth; ++i) {
+      std::snprintf(line, sizeof(line), "%p", site.frames[i]);
+      fn(line);
+    }
+  }
+
+  void on_allocate(const std::size_t bytes) {
+    if (t_in_hook) return; // backtrace() and friends may allocate
+    t_in_hook = true;
+
+    const std::uint64_t index = g_allocations.fetch_add(1, std::memory_order_relaxed) + 1;
+    g_bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+    if (const char* zone = current_zone()) {
+      if (ZoneSlot* slot = find_zone(zone)) {
+        slot->allocations.fetch_add(1, std::memory_order_relaxed);
+        slot->bytes.fetch_add(bytes, std::memory_order_relaxed);
+      }
+    }
+
+    const std::uint32_t rate = g_sample_rate.load(std::memory_order_relaxed);
+    if (rate != 0 && index % rate == 0 && !g_sample_lock.test_and_set(std::memory_order_acquire)) {
+      capture(g_samples[g_sample_count % AllocTracker::SAMPLE_HISTORY], bytes);
+      ++g_sample_count;
+      g_sample_lock.clear(std::memory_order_release);
+    }
+
+    if (t_watched) {
+      const std::uint64_t violation = g_violations.fetch_add(1, std::memory_order_relaxed);
+      if (violation < MAX_VIOLATIONS) capture(g_violation_sites[violation], bytes);
+    }
+
+    t_in_hook = false;
+  }
+
+  void on_free(const void* pointer) {
+    if (pointer && !t_in_hook) g_frees.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void* allocate(const std::size_t bytes) {
+    on_allocate(bytes);
+    return std::malloc(bytes == 0 ? 1 : bytes);
+  }
+
+  void* allocate_aligned(const std::size_t bytes, const std::align_val_t alignment) {
+    on_allocate(bytes);
+    const auto align = static_cast<std::size_t>(alignment);
+#if defined(HERON_PLATFORM_WINDOWS)
+    return _aligned_malloc(bytes == 0 ? 1 : bytes, align);
+#else
+    // aligned_alloc wants the size to be a multiple of the alignment.
+    return std::aligned_alloc(align, (std::max<std::size_t>(bytes, 1) + align - 1) & ~(align - 1));
+#endif
+  }
+
+  void release(void* pointer) {
+    on_free(pointer);
+    std::free(pointer);
+  }
+
+  void release_aligned(void* pointer) {
+    on_free(pointer);
+#if defined(HERON_PLATFORM_WINDOWS)
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+  }
+
+  void* allocate_or_throw(const std::size_t bytes) {
+    if (void* pointer = allocate(bytes)) return pointer;
+    throw std::bad_alloc();
+  }
+
+  void* allocate_aligned_or_throw(const std::size_t bytes, const std::align_val_t alignment) {
+    if (void* pointer = allocate_aligned(bytes, alignment)) return pointer;
+    throw std::bad_alloc();
+  }
+}
+
+void* operator new(const std::size_t size) { return allocate_or_throw(size); }
+void* operator new[](const std::size_t size) { return allocate_or_throw(size); }
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(const std::size_t size, const std::align_val_t alignment) {
+  return allocate_aligned_or_throw(size, alignment);
+}
+void* operator new[](const std::size_t size, const std::align_val_t alignment) {
+  return allocate_aligned_or_throw(size, alignment);
+}
+void* operator new(const std::size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocate_aligned(size, alignment);
+}
+void* operator new[](const std::size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { release(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { release_aligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { release_aligned(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { release_aligned(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { release_aligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { release_aligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { release_aligned(pointer); }
+
+bool AllocTracker::is_available() {
+  return true;
+}
+
+void AllocTracker::push_zone(const char* name) {
+  if (t_zone_depth < MAX_ZONE_DEPTH) t_zones[t_zone_depth] = name;
+  ++t_zone_depth;
+}
+
+void AllocTracker::pop_zone() {
+  if (t_zone_depth > 0) --t_zone_depth;
+}
+
+void AllocTracker::new_frame() {
+  const Counters total = get_total();
+  g_last_frame = {total.allocations - g_frame_start.allocations, total.frees - g_frame_start.frees,
+                  total.bytes - g_frame_start.bytes};
+  g_frame_start = total;
+
+  for (ZoneSlot& slot : g_zones) {
+    if (slot.name.load(std::memory_order_acquire) == nullptr) continue;
+    const std::uint64_t allocations = slot.allocations.load(std::memory_order_relaxed);
+    const std::uint64_t bytes = slot.bytes.load(std::memory_order_relaxed);
+    slot.last_allocations = allocations - slot.frame_start_allocations;
+    slot.last_bytes = bytes - slot.frame_start_bytes;
+    slot.frame_start_allocations = allocations;
+    slot.frame_start_bytes = bytes;
+  }
+}
+
+AllocTracker::Counters AllocTracker::get_last_frame() {
+  return g_last_frame;
+}
+
+AllocTracker::Counters AllocTracker::get_total() {
+  return {g_allocations.load(std::memory_order_relaxed), g_frees.load(std::memory_order_relaxed),
+          g_bytes.load(std::memory_order_relaxed)};
+}
+
+void AllocTracker::set_sample_rate(const std::uint32_t every_nth) {
+  g_sample_rate.store(every_nth, std::memory_order_relaxed);
+}
+
+std::uint32_t AllocTracker::get_sample_rate() {
+  return g_sample_rate.load(std::memory_order_relaxed);
+}
+
+void AllocTracker::watch_thread(const bool enabled) {
+  t_watched = enabled;
+}
+
+std::uint64_t AllocTracker::get_violations() {
+  return g_violations.load(std::memory_order_relaxed);
+}
+
+void AllocTracker::report_violations() {
+  const std::uint64_t violations = get_violations();
+  if (violations == 0) return;
+
+  std::cerr << "ERROR: " << violations << " heap allocation(s) on a watched thread\n";
+  for (std::size_t i = 0; i < std::min<std::uint64_t>(violations, MAX_VIOLATIONS); ++i) {
+    const Callsite& site = g_violation_sites[i];
+    std::cerr << "  #" << i << ": " << site.bytes << " bytes in zone '" << (site.zone ? site.zone : "<none>") << "'\n";
+    for_each_frame(site, [](const char* frame) { std::cerr << "      " << frame << '\n'; });
+  }
+}
+
+void AllocTracker::render_stats() {
+  const Counters frame = get_last_frame();
+  ImGui::Text("Heap allocations: %llu (%llu bytes), frees: %llu", static_cast<unsigned long long>(frame.allocations),
+              static_cast<unsigned long long>(frame.bytes), static_cast<unsigned long long>(frame.frees));
+
+  if (ImGui::TreeNode("Allocations by zone")) {
+    for (const ZoneSlot& slot : g_zones) {
+      const char* name = slot.name.load(std::memory_order_acquire);
+      if (name == nullptr || slot.last_allocations == 0) continue;
+      ImGui::Text("%s: %llu (%llu bytes)", name, static_cast<unsigned long long>(slot.last_allocations),
+                  static_cast<unsigned long long>(slot.last_bytes));
+    }
+    ImGui::TreePop();
+  }
+
+  int rate = static_cast<int>(get_sample_rate());
+  if (ImGui::SliderInt("Sample every Nth allocation", &rate, 0, 1000)) {
+    set_sample_rate(static_cast<std::uint32_t>(std::max(rate, 0)));
+  }
+  if (rate == 0 || !ImGui::TreeNode("Sampled callsites")) return;
+
+  // Snapshot the ring so symbolizing does not hold up allocating threads.
+  static Callsite samples[SAMPLE_HISTORY];
+  while (g_sample_lock.test_and_set(std::memory_order_acquire)) {}
+  const std::size_t count = std::min(g_sample_count, SAMPLE_HISTORY);
+  const std::size_t newest = g_sample_count;
+  for (std::size_t i = 0; i < count; ++i) samples[i] = g_samples[(newest - 1 - i) % SAMPLE_HISTORY];
+  g_sample_lock.clear(std::memory_order_release);
+
+  char label[128];
+  for (std::size_t i = 0; i < count; ++i) {
+    const Callsite& site = samples[i];
+    std::snprintf(label, sizeof(label), "%zu bytes in %s##sample%zu", site.bytes, site.zone ? site.zone : "<none>", i);
+    if (!ImGui::TreeNode(label)) continue;
+    for_each_frame(site, [](const char* frame) { ImGui::TextUnformatted(frame); });
+    ImGui::TreePop();
+  }
+  ImGui::TreePop();
+}
+
+#else
+
+bool AllocTracker::is_available() {
+  return false;
+}
+
+void AllocTracker::push_zone(const char*) {}
+
+void AllocTracker::pop_zone() {}
+
+void AllocTracker::new_frame() {}
+
+AllocTracker::Counters AllocTracker::get_last_frame() {
+  return {};
+}
+
+AllocTracker::Counters AllocTracker::get_total() {
+  return {};
+}
+
+void AllocTracker::set_sample_rate(std::uint32_t) {}
+
+std::uint32_t AllocTracker::get_sample_rate() {
+  return 0;
+}
+
+void AllocTracker::watch_thread(bool) {}
+
+std::uint64_t AllocTracker::get_violations() {
+  return 0;
+}
+
+void AllocTracker::report_violations() {}
+
+void AllocTracker::render_stats() {
+  ImGui::TextDisabled("Heap allocation tracking: build with HERON_TRACK_ALLOCATIONS=ON");
+}
+
+#endif
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+* Heap allocation tracker
+*
+* Built with HERON_TRACK_ALLOCATIONS (CMake option of the same name) it
+* replaces the global operator new/delete and counts every allocation
+* per frame and per HG_SCOPED_TIMER zone of the allocating thread. Every
+* Nth allocation can also record its call stack. Without the define all
+* functions are no-ops and is_available() returns false.
+*
+* watch_thread() arms the calling thread: from then on any allocation it
+* makes is a violation, which is what the --zero-alloc-test mode checks
+* after the warm-up frames.
+*/
+class AllocTracker {
+public:
+  static constexpr std::size_t MAX_ZONES = 256;
+  static constexpr std::size_t MAX_STACK_DEPTH = 16;
+  static constexpr std::size_t SAMPLE_HISTORY = 32;
+
+  struct Counters {
+    std::uint64_t allocations;
+    std::uint64_t frees;
+    std::uint64_t bytes;
+  };
+
+  struct Callsite {
+    const char* zone; // innermost zone, nullptr outside of any
+    std::size_t bytes;
+    std::size_t depth;
+    void* frames[MAX_STACK_DEPTH];
+  };
+
+  [[nodiscard]] static bool is_available();
+
+  // Called by ScopedTimer; the innermost zone gets the allocation.
+  static void push_zone(const char* name);
+  static void pop_zone();
+
+  // Closes the current frame; call once per frame from the render thread.
+  static void new_frame();
+
+  [[nodiscard]] static Counters get_last_frame();
+  [[nodiscard]] static Counters get_total();
+
+  // Capture the call stack of every Nth allocation, 0 disables sampling.
+  static void set_sample_rate(std::uint32_t every_nth);
+  [[nodiscard]] static std::uint32_t get_sample_rate();
+
+  static void watch_thread(bool enabled);
+  [[nodiscard]] static std::uint64_t get_violations();
+  // Resolved call stacks of the first violations to stderr.
+  static void report_violations();
+
+  // Per-frame counters, zones and sampled callsites into the current ImGui window.
+  static void render_stats();
+};
@@ -0,0 +1,108 @@
+﻿#include "AutoSaver.h"
+
+#include <iostream>
+
+#include "atomic_file.h"
+
+AutoSaver::AutoSaver(std::string filename) : m_filename{std::move(filename)}, m_enabled{true},
+                                             m_interval{30}, m_debounce{2000}, m_dirty{false}, m_stop{false},
+                                             m_status{false, false, {}, 0.0, 0, {}} {
+  m_worker = std::thread(&AutoSaver::run, this);
+}
+
+AutoSaver::~AutoSaver() {
+  {
+    std::lock_guard lock{m_mutex};
+    m_stop = true;
+  }
+  m_condition.notify_one();
+  m_worker.join();
+}
+
+void AutoSaver::set_enabled(const bool enabled) {
+  m_enabled = enabled;
+}
+
+void AutoSaver::set_interval(const std::chrono::seconds interval) {
+  m_interval = interval;
+}
+
+void AutoSaver::set_debounce(const std::chrono::milliseconds debounce) {
+  m_debounce = debounce;
+}
+
+bool AutoSaver::is_enabled() const {
+  return m_enabled;
+}
+
+void AutoSaver::mark_dirty() {
+  const auto now = clock::now();
+  if (!m_dirty) m_first_change = now;
+  m_last_change = now;
+  m_dirty = true;
+}
+
+bool AutoSaver::has_unsaved_changes() const {
+  return m_dirty;
+}
+
+void AutoSaver::mark_clean() {
+  m_dirty = false;
+}
+
+bool AutoSaver::wants_snapshot() const {
+  if (!m_enabled || !m_dirty) return false;
+  const auto now = clock::now();
+  return now - m_last_change >= m_debounce || now - m_first_change >= m_interval;
+}
+
+void AutoSaver::submit(std::shared_ptr<const SceneSnapshot> snapshot) {
+  {
+    std::lock_guard lock{m_mutex};
+    m_pending = std::move(snapshot);
+  }
+  m_dirty = false;
+  m_condition.notify_one();
+}
+
+const std::string& AutoSaver::get_filename() const {
+  return m_filename;
+}
+
+AutoSaver::Status AutoSaver::get_status() const {
+  std::lock_guard lock{m_mutex};
+  return m_status;
+}
+
+void AutoSaver::run() {
+  std::unique_lock lock{m_mutex};
+  while (true) {
+    m_condition.wait(lock, [this] { return m_stop || m_pending; });
+    if (!m_pending) return; // stopping with nothing left to write
+
+    const std::shared_ptr<const SceneSnapshot> snapshot = std::move(m_pending);
+    m_pending.reset();
+    m_status.saving = true;
+    lock.unlock();
+
+    const auto start = clock::now();
+    std::string error;
+    const bool saved = write_file_atomic(m_filename, serialize_scene(*snapshot), &error);
+    const auto end = clock::now();
+
+    if (!saved) std::cerr << "ERROR: Autosave failed: " << error << '\n';
+
+    lock.lock();
+    m_status.saving = false;
+    if (saved) {
+      m_status.has_saved = true;
+      m_status.last_save = end;
+      m_status.last_duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+      ++m_status.save_count;
+      m_status.last_error.clear();
+    }
+    else {
+      m_status.last_error = error;
+    }
+  }
+}
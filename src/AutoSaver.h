@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "saves.h"
+
+/*
+* Background scene saver
+*
+* The render thread only hands over an immutable SceneSnapshot. The
+* worker serializes it, fsyncs and atomically renames it into place,
+* so a save never blocks a frame and a crash never truncates the file.
+* Taking the snapshot is still a copy of the scene on the render thread
+* (see Scene::make_snapshot). The destructor finishes the pending save;
+* edits not yet submitted have to be submitted before it runs.
+*/
+class AutoSaver {
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct Status {
+    bool saving;
+    bool has_saved;
+    clock::time_point last_save;
+    double last_duration_ms;
+    std::size_t save_count;
+    std::string last_error;
+  };
+
+  explicit AutoSaver(std::string filename);
+  ~AutoSaver();
+
+  AutoSaver(const AutoSaver&) = delete;
+  AutoSaver& operator=(const AutoSaver&) = delete;
+
+  void set_enabled(bool enabled);
+  void set_interval(std::chrono::seconds interval);
+  void set_debounce(std::chrono::milliseconds debounce);
+  [[nodiscard]] bool is_enabled() const;
+
+  // The scene changed since the last save.
+  void mark_dirty();
+  // Edits since the last save that are not yet submitted, debounced or not.
+  [[nodiscard]] bool has_unsaved_changes() const;
+  // The scene was replaced by what is on disk (e.g. after loading).
+  void mark_clean();
+
+  // True once an autosave is due: the scene is dirty and either the edits settled
+  // for the debounce time or the periodic interval elapsed.
+  [[nodiscard]] bool wants_snapshot() const;
+
+  // Queues a save of `snapshot`. Only the latest pending snapshot is written.
+  void submit(std::shared_ptr<const SceneSnapshot> snapshot);
+
+  [[nodiscard]] const std::string& get_filename() const;
+  [[nodiscard]] Status get_status() const;
+
+private:
+  const std::string m_filename;
+
+  bool m_enabled;
+  std::chrono::seconds m_interval;
+  std::chrono::milliseconds m_debounce;
+
+  bool m_dirty;
+  clock::time_point m_first_change;
+  clock::time_point m_last_change;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::shared_ptr<const SceneSnapshot> m_pending;
+  bool m_stop;
+  Status m_status;
+
+  std::thread m_worker;
+
+  void run();
+};
@@ -0,0 +1,84 @@
+﻿#include "BufferPool.h"
+
+#include <algorithm>
+#include <bit>
+
+#include <imgui.h>
+
+#include "Renderer.h"
+
+namespace {
+  constexpr std::size_t MAX_CLASS_SIZE = BufferPool::MIN_CLASS_SIZE << (BufferPool::CLASS_COUNT - 1);
+}
+
+BufferPool::BufferPool() : m_stats{} {}
+
+BufferHandle BufferPool::acquire(const std::size_t size, const unsigned int usage, const std::string_view owner) {
+  const std::size_t capacity = get_capacity(size);
+  const std::size_t index = class_index(capacity);
+  if (index < CLASS_COUNT && !m_free[index].empty()) {
+    FreeBuffer free_buffer = std::move(m_free[index].back());
+    m_free[index].pop_back();
+    ++m_stats.hits;
+    --m_stats.free_buffers;
+    m_stats.free_bytes -= capacity;
+
+    if (free_buffer.usage != usage) {
+      GpuResources::buffer_data(free_buffer.buffer.get(), capacity, nullptr, usage);
+    }
+    GpuResources::set_owner(GpuResourceType::BUFFER, free_buffer.buffer.get(), owner);
+    return std::move(free_buffer.buffer);
+  }
+
+  ++m_stats.misses;
+  BufferHandle buffer{GpuResources::create_buffer(owner)};
+  GpuResources::buffer_data(buffer.get(), capacity, nullptr, usage);
+  return buffer;
+}
+
+void BufferPool::release(BufferHandle buffer, const std::size_t capacity, const unsigned int usage) {
+  if (!buffer) return;
+  const std::size_t index = class_index(capacity);
+  if (index >= CLASS_COUNT || m_free[index].size() >= MAX_FREE_PER_CLASS) {
+    ++m_stats.deleted;
+    return; // the handle deletes it
+  }
+
+  // Orphan: the driver keeps the old storage alive for pending draws and hands us fresh memory.
+  GpuResources::buffer_data(buffer.get(), capacity, nullptr, usage);
+  GpuResources::set_owner(GpuResourceType::BUFFER, buffer.get(), "BufferPool (free)");
+  m_free[index].push_back({std::move(buffer), usage});
+  ++m_stats.recycled;
+  ++m_stats.free_buffers;
+  m_stats.free_bytes += capacity;
+}
+
+void BufferPool::clear() {
+  for (std::vector<FreeBuffer>& free_buffers : m_free) free_buffers.clear();
+  m_stats.free_buffers = 0;
+  m_stats.free_bytes = 0;
+}
+
+BufferPool::Stats BufferPool::get_stats() const {
+  return m_stats;
+}
+
+void BufferPool::render_stats() const {
+  ImGui::Text("Buffer pool: %zu reused, %zu created, %zu free (%.1f KB)", m_stats.hits, m_stats.misses,
+              m_stats.free_buffers, static_cast<double>(m_stats.free_bytes) / 1024.0);
+}
+
+std::size_t BufferPool::get_capacity(const std::size_t size) {
+  if (size > MAX_CLASS_SIZE) return size;
+  return std::max(MIN_CLASS_SIZE, std::bit_ceil(size));
+}
+
+BufferPool& BufferPool::get() {
+  static BufferPool pool;
+  return pool;
+}
+
+std::size_t BufferPool::class_index(const std::size_t capacity) {
+  if (capacity < MIN_CLASS_SIZE || capacity > MAX_CLASS_SIZE || !std::has_single_bit(capacity)) return CLASS_COUNT;
+  return static_cast<std::size_t>(std::countr_zero(capacity / MIN_CLASS_SIZE));
+}
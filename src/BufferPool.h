@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "GLHandle.h"
+
+/*
+* Size-class buffer pool
+*
+* Buffers are handed out with power-of-two capacities from 4 KB to
+* 64 MB. A released buffer is orphaned (glBufferData with nullptr, so
+* draws still in flight keep their old storage) and parked in its class
+* for the next acquire instead of being deleted; only a few per class
+* are kept. Anything above the largest class is created and deleted
+* directly. clear() must run while the GL context is still alive.
+*/
+class BufferPool {
+public:
+  static constexpr std::size_t MIN_CLASS_SIZE = 4 * 1024;
+  static constexpr std::size_t CLASS_COUNT = 15; // up to 64 MB
+  static constexpr std::size_t MAX_FREE_PER_CLASS = 4;
+
+  struct Stats {
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t recycled;
+    std::size_t deleted;
+    std::size_t free_buffers;
+    std::size_t free_bytes;
+  };
+
+  BufferPool();
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  // A buffer with storage for at least `size` bytes, see get_capacity().
+  [[nodiscard]] BufferHandle acquire(std::size_t size, unsigned int usage, std::string_view owner);
+  // `capacity` is what get_capacity() returned for the acquire.
+  void release(BufferHandle buffer, std::size_t capacity, unsigned int usage);
+  void clear();
+
+  [[nodiscard]] Stats get_stats() const;
+  void render_stats() const;
+
+  [[nodiscard]] static std::size_t get_capacity(std::size_t size);
+
+  // Pool of the GL context thread.
+  static BufferPool& get();
+
+private:
+  struct FreeBuffer {
+    BufferHandle buffer;
+    unsigned int usage;
+  };
+
+  std::array<std::vector<FreeBuffer>, CLASS_COUNT> m_free;
+  Stats m_stats;
+
+  [[nodiscard]] static std::size_t class_index(std::size_t capacity);
+};
@@ -0,0 +1,81 @@
+﻿#include "BufferSuballocator.h"
+
+#include <cassert>
+#include <iterator>
+
+BufferSuballocator::BufferSuballocator(const std::size_t capacity) : m_capacity{capacity}, m_used{0} {
+  if (capacity > 0) insert_free(0, capacity);
+}
+
+std::size_t BufferSuballocator::allocate(const std::size_t size) {
+  if (size == 0) return INVALID_OFFSET;
+  const auto fit = m_free_by_size.lower_bound(size);
+  if (fit == m_free_by_size.end()) return INVALID_OFFSET;
+
+  const std::size_t block_size = fit->first;
+  const std::size_t offset = fit->second;
+  erase_free(m_free_by_offset.find(offset));
+  if (block_size > size) insert_free(offset + size, block_size - size);
+  m_used += size;
+  return offset;
+}
+
+void BufferSuballocator::free(std::size_t offset, std::size_t size) {
+  if (size == 0) return;
+  assert(offset + size <= m_capacity);
+  m_used -= size;
+
+  auto next = m_free_by_offset.lower_bound(offset);
+  if (next != m_free_by_offset.begin()) {
+    const auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      offset = previous->first;
+      size += previous->second;
+      erase_free(previous);
+    }
+  }
+  if (next != m_free_by_offset.end() && offset + size == next->first) {
+    size += next->second;
+    erase_free(next);
+  }
+  insert_free(offset, size);
+}
+
+void BufferSuballocator::reset(const std::size_t used) {
+  m_free_by_offset.clear();
+  m_free_by_size.clear();
+  m_used = used;
+  if (used < m_capacity) insert_free(used, m_capacity - used);
+}
+
+std::size_t BufferSuballocator::get_capacity() const {
+  return m_capacity;
+}
+
+std::size_t BufferSuballocator::get_used() const {
+  return m_used;
+}
+
+std::size_t BufferSuballocator::get_largest_free() const {
+  return m_free_by_size.empty() ? 0 : m_free_by_size.rbegin()->first;
+}
+
+std::size_t BufferSuballocator::get_free_blocks() const {
+  return m_free_by_offset.size();
+}
+
+void BufferSuballocator::insert_free(const std::size_t offset, const std::size_t size) {
+  m_free_by_offset.emplace(offset, size);
+  m_free_by_size.emplace(size, offset);
+}
+
+void BufferSuballocator::erase_free(const std::map<std::size_t, std::size_t>::iterator block) {
+  auto [first, last] = m_free_by_size.equal_range(block->second);
+  for (; first != last; ++first) {
+    if (first->second == block->first) {
+      m_free_by_size.erase(first);
+      break;
+    }
+  }
+  m_free_by_offset.erase(block);
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <map>
+
+/*
+* Free-list range allocator
+*
+* Hands out [offset, offset + size) ranges of a fixed capacity in
+* whatever unit the caller uses (vertices, indices, bytes). Picks the
+* best fitting free block and merges neighbours on free, so the free
+* list stays as short as the live set allows. Bookkeeping only; the
+* storage itself lives elsewhere (see GeometryPool).
+*/
+class BufferSuballocator {
+public:
+  static constexpr std::size_t INVALID_OFFSET = std::numeric_limits<std::size_t>::max();
+
+  explicit BufferSuballocator(std::size_t capacity = 0);
+
+  // INVALID_OFFSET when no free block is large enough.
+  [[nodiscard]] std::size_t allocate(std::size_t size);
+  void free(std::size_t offset, std::size_t size);
+  // Forgets all allocations, then marks [0, used) as taken (after compaction).
+  void reset(std::size_t used = 0);
+
+  [[nodiscard]] std::size_t get_capacity() const;
+  [[nodiscard]] std::size_t get_used() const;
+  [[nodiscard]] std::size_t get_largest_free() const;
+  [[nodiscard]] std::size_t get_free_blocks() const;
+
+private:
+  std::size_t m_capacity;
+  std::size_t m_used;
+  std::map<std::size_t, std::size_t> m_free_by_offset;
+  std::multimap<std::size_t, std::size_t> m_free_by_size;
+
+  void insert_free(std::size_t offset, std::size_t size);
+  void erase_free(std::map<std::size_t, std::size_t>::iterator block);
+};
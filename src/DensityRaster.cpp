@@ -0,0 +1,182 @@
+﻿#include "DensityRaster.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "scoped_timer.h"
+#include "util.h"
+
+namespace {
+  // Fewer triangles than this are rastered on the calling thread alone.
+  constexpr std::size_t PARALLEL_THRESHOLD = 16 * 1024;
+  // Every band worker walks all triangles, so narrower bands stop paying off.
+  constexpr int MIN_BAND_ROWS = 32;
+  constexpr float MIN_TEXEL_SIZE = 1e-6f;
+}
+
+DensityRaster::DensityRaster()
+  : m_pending_version(0), m_building(false), m_ready(false), m_stop(false), m_result{0, 0, 0, {}, {}},
+    m_last_duration_ms(0.0) {
+  m_worker = std::thread(&DensityRaster::run, this);
+}
+
+DensityRaster::~DensityRaster() {
+  {
+    std::lock_guard lock{m_mutex};
+    m_stop = true;
+  }
+  m_condition.notify_one();
+  m_worker.join();
+}
+
+void DensityRaster::submit(std::shared_ptr<const SceneSnapshot> snapshot, const std::uint64_t version) {
+  {
+    std::lock_guard lock{m_mutex};
+    m_pending = std::move(snapshot);
+    m_pending_version = version;
+  }
+  m_condition.notify_one();
+}
+
+bool DensityRaster::take(Image& out) {
+  std::lock_guard lock{m_mutex};
+  if (!m_ready) return false;
+  std::swap(out, m_result);
+  m_ready = false;
+  return true;
+}
+
+bool DensityRaster::is_busy() const {
+  std::lock_guard lock{m_mutex};
+  return m_building || m_pending;
+}
+
+double DensityRaster::get_last_duration_ms() const {
+  std::lock_guard lock{m_mutex};
+  return m_last_duration_ms;
+}
+
+DensityRaster::Image DensityRaster::build(const SceneSnapshot& snapshot, const int max_size) {
+  HG_SCOPED_TIMER("DensityRaster::build");
+  Image image{0, 0, 0, {}, {}};
+  const std::size_t count = std::min(snapshot.vertices.size() / 3, snapshot.colors.size());
+  if (count == 0) return image;
+
+  glm::vec2 min{std::numeric_limits<float>::max()};
+  glm::vec2 max{std::numeric_limits<float>::lowest()};
+  for (std::size_t i = 0; i < count * 3; ++i) {
+    min = glm::min(min, snapshot.vertices[i]);
+    max = glm::max(max, snapshot.vertices[i]);
+  }
+  const glm::vec2 extent = max - min;
+  const float texel = std::max(std::max(extent.x, extent.y) / static_cast<float>(max_size), MIN_TEXEL_SIZE);
+  const int width = std::clamp(static_cast<int>(std::ceil(extent.x / texel)), 1, max_size);
+  const int height = std::clamp(static_cast<int>(std::ceil(extent.y / texel)), 1, max_size);
+  image.width = width;
+  image.height = height;
+  image.bounds = {min, min + glm::vec2{static_cast<float>(width), static_cast<float>(height)} * texel};
+  image.texels.resize(static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+
+  // Premultiplied color and coverage, in texels; one band of rows per worker, so no two workers share a texel.
+  std::vector<glm::vec4> accumulated(image.texels.size(), glm::vec4{0.0f});
+  const float inverse_texel = 1.0f / texel;
+  const std::size_t workers = count < PARALLEL_THRESHOLD
+    ? 1
+    : std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1,
+                              static_cast<std::size_t>((height + MIN_BAND_ROWS - 1) / MIN_BAND_ROWS));
+
+  run_parallel(workers, [&](const std::size_t worker) {
+    const int row_first = static_cast<int>(static_cast<std::size_t>(height) * worker / workers);
+    const int row_end = static_cast<int>(static_cast<std::size_t>(height) * (worker + 1) / workers);
+    const auto add = [&](const int x, const int y, const glm::vec4& value) {
+      accumulated[static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x)] += value;
+    };
+
+    for (std::size_t triangle = 0; triangle < count; ++triangle) {
+      const glm::vec2* world = snapshot.vertices.data() + triangle * 3;
+      const glm::vec2 corners[3] = {(world[0] - min) * inverse_texel, (world[1] - min) * inverse_texel,
+                                    (world[2] - min) * inverse_texel};
+      const glm::vec2 low = glm::min(glm::min(corners[0], corners[1]), corners[2]);
+      const glm::vec2 high = glm::max(glm::max(corners[0], corners[1]), corners[2]);
+      if (high.y < static_cast<float>(row_first) || low.y >= static_cast<float>(row_end)) continue;
+
+      const glm::vec4& color = snapshot.colors[triangle];
+      const glm::vec4 premultiplied{glm::vec3{color} * color.a, color.a};
+      const glm::vec2 centroid = (corners[0] + corners[1] + corners[2]) / 3.0f;
+      const int centroid_x = std::clamp(static_cast<int>(centroid.x), 0, width - 1);
+      const int centroid_y = std::clamp(static_cast<int>(centroid.y), 0, height - 1);
+      const bool owns_centroid = centroid_y >= row_first && centroid_y < row_end;
+      const glm::vec2 ab = corners[1] - corners[0];
+      const glm::vec2 ac = corners[2] - corners[0];
+      const float area = std::abs(ab.x * ac.y - ab.y * ac.x) * 0.5f;
+
+      std::size_t covered = 0;
+      if (std::floor(low.x) != std::floor(high.x) || std::floor(low.y) != std::floor(high.y)) {
+        // Rows whose centers lie inside the triangle's y range, then the span each crosses.
+        const int y_first = std::max(row_first, static_cast<int>(std::ceil(low.y - 0.5f)));
+        const int y_last = std::min(row_end - 1, static_cast<int>(std::floor(high.y - 0.5f)));
+        for (int y = y_first; y <= y_last; ++y) {
+          const float center_y = static_cast<float>(y) + 0.5f;
+          float span_low = std::numeric_limits<float>::max();
+          float span_high = std::numeric_limits<float>::lowest();
+          for (int edge = 0; edge < 3; ++edge) {
+            const glm::vec2& p = corners[edge];
+            const glm::vec2& q = corners[(edge + 1) % 3];
+            if ((p.y <= center_y) == (q.y <= center_y)) continue;
+            const float x = p.x + (center_y - p.y) * (q.x - p.x) / (q.y - p.y);
+            span_low = std::min(span_low, x);
+            span_high = std::max(span_high, x);
+          }
+          // A row center level with the top vertex crosses no edge, leaving the span empty.
+          if (span_low > span_high) continue;
+          const int x_first = std::max(0, static_cast<int>(std::ceil(span_low - 0.5f)));
+          const int x_last = std::min(width - 1, static_cast<int>(std::floor(span_high - 0.5f)));
+          for (int x = x_first; x <= x_last; ++x) add(x, y, premultiplied);
+          if (x_last >= x_first) covered += static_cast<std::size_t>(x_last - x_first + 1);
+        }
+      }
+      // Within one texel, or a sliver between texel centers: its area goes to the texel under the centroid.
+      if (covered == 0 && owns_centroid) add(centroid_x, centroid_y, premultiplied * area);
+    }
+
+    for (std::size_t texel_index = static_cast<std::size_t>(row_first) * static_cast<std::size_t>(width);
+         texel_index < static_cast<std::size_t>(row_end) * static_cast<std::size_t>(width); ++texel_index) {
+      const glm::vec4& sum = accumulated[texel_index];
+      if (sum.a <= 0.0f) {
+        image.texels[texel_index] = 0;
+        continue;
+      }
+      // Overlapping triangles average by area; coverage saturates at a full texel.
+      const float coverage = std::min(sum.a, 1.0f);
+      image.texels[texel_index] = pack_rgba8(glm::vec4{glm::vec3{sum} * (coverage / sum.a), coverage});
+    }
+  });
+  return image;
+}
+
+void DensityRaster::run() {
+  std::unique_lock lock{m_mutex};
+  while (true) {
+    m_condition.wait(lock, [this] { return m_stop || m_pending; });
+    if (m_stop) return; // the image is only for display, nothing worth finishing
+
+    const std::shared_ptr<const SceneSnapshot> snapshot = std::move(m_pending);
+    m_pending.reset();
+    const std::uint64_t version = m_pending_version;
+    m_building = true;
+    lock.unlock();
+
+    const auto start = std::chrono::steady_clock::now();
+    Image image = build(*snapshot);
+    image.version = version;
+    const auto end = std::chrono::steady_clock::now();
+
+    lock.lock();
+    m_result = std::move(image);
+    m_ready = true;
+    m_building = false;
+    m_last_duration_ms = std::chrono::duration<double, std::milli>(end - start).count();
+  }
+}
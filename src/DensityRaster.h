@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LooseQuadtree.h"
+#include "SceneSnapshot.h"
+
+/*
+* Density raster
+*
+* Zoomed-out stand-in for the scene: a world-space image over the scene
+* bounds where each texel holds the area-weighted average color of the
+* triangles overlapping it, premultiplied by how much of it they cover.
+* Triangles smaller than a texel are splatted by area at their centroid,
+* larger ones cover the texels whose centers they contain. Builds split
+* the texel rows into bands, one worker thread each.
+*
+* A background thread builds the latest submitted snapshot, so edits
+* never wait for it; the render thread picks finished images up with
+* take(). Camera moves do not need a new image.
+*/
+class DensityRaster {
+public:
+  // Texels along the longer side of the scene bounds.
+  static constexpr int MAX_SIZE = 1024;
+
+  struct Image {
+    std::uint64_t version;
+    int width;
+    int height;
+    // World rectangle covered by the texels, which are square; row 0 is at min.y.
+    Bounds2D bounds;
+    // RGBA8, premultiplied alpha.
+    std::vector<std::uint32_t> texels;
+  };
+
+  DensityRaster();
+  ~DensityRaster();
+
+  DensityRaster(const DensityRaster&) = delete;
+  DensityRaster& operator=(const DensityRaster&) = delete;
+
+  // Queues a build of `snapshot`, tagged with `version`. Only the latest pending snapshot is built.
+  void submit(std::shared_ptr<const SceneSnapshot> snapshot, std::uint64_t version);
+  // Moves the newest finished image into `out`. False when nothing finished since the last call.
+  bool take(Image& out);
+  // A build is pending or running.
+  [[nodiscard]] bool is_busy() const;
+  [[nodiscard]] double get_last_duration_ms() const;
+
+  // Synchronous build on the calling thread plus workers; empty image for an empty snapshot.
+  [[nodiscard]] static Image build(const SceneSnapshot& snapshot, int max_size = MAX_SIZE);
+
+private:
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::shared_ptr<const SceneSnapshot> m_pending;
+  std::uint64_t m_pending_version;
+  bool m_building;
+  bool m_ready;
+  bool m_stop;
+  Image m_result;
+  double m_last_duration_ms;
+
+  std::thread m_worker;
+
+  void run();
+};
@@ -0,0 +1,52 @@
+﻿#include "DirtyRanges.h"
+
+#include <algorithm>
+
+void DirtyRanges::add(const std::size_t first, const std::size_t count) {
+  if (count == 0) return;
+  // Drags touch the same or adjacent elements over and over; extend the last range when possible.
+  if (!m_ranges.empty()) {
+    Range& last = m_ranges.back();
+    if (first >= last.first && first <= last.first + last.count) {
+      last.count = std::max(last.count, first + count - last.first);
+      return;
+    }
+  }
+  m_ranges.push_back({first, count});
+}
+
+void DirtyRanges::clear() {
+  m_ranges.clear();
+}
+
+void DirtyRanges::coalesce(const std::size_t gap) {
+  if (m_ranges.size() < 2) return;
+  std::sort(m_ranges.begin(), m_ranges.end(), [](const Range& a, const Range& b) { return a.first < b.first; });
+
+  std::size_t merged = 0;
+  for (std::size_t i = 1; i < m_ranges.size(); ++i) {
+    Range& current = m_ranges[merged];
+    const Range& next = m_ranges[i];
+    if (next.first <= current.first + current.count + gap) {
+      current.count = std::max(current.count, next.first + next.count - current.first);
+    }
+    else {
+      m_ranges[++merged] = next;
+    }
+  }
+  m_ranges.resize(merged + 1);
+}
+
+bool DirtyRanges::empty() const {
+  return m_ranges.empty();
+}
+
+std::span<const DirtyRanges::Range> DirtyRanges::get_ranges() const {
+  return m_ranges;
+}
+
+std::size_t DirtyRanges::get_total() const {
+  std::size_t total = 0;
+  for (const Range& range : m_ranges) total += range.count;
+  return total;
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/*
+* Dirty range list
+*
+* Collects [first, first + count) ranges of changed elements in any
+* order, then coalesce() sorts them and merges ranges that overlap or
+* lie closer than a gap, so uploading a few untouched elements buys
+* fewer GL calls. Units are whatever the caller uses (vertices,
+* triangles, chunks). The storage is reused between frames.
+*/
+class DirtyRanges {
+public:
+  struct Range {
+    std::size_t first;
+    std::size_t count;
+  };
+
+  void add(std::size_t first, std::size_t count = 1);
+  void clear();
+  // Merges ranges at most `gap` elements apart.
+  void coalesce(std::size_t gap = 0);
+
+  [[nodiscard]] bool empty() const;
+  [[nodiscard]] std::span<const Range> get_ranges() const;
+  // Elements covered; ranges may overlap until coalesce().
+  [[nodiscard]] std::size_t get_total() const;
+
+private:
+  std::vector<Range> m_ranges;
+};
@@ -0,0 +1,226 @@
+﻿#include "EditJournal.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace {
+  constexpr std::size_t NO_GROUP_EDITS = std::numeric_limits<std::size_t>::max();
+}
+
+EditJournal::EditJournal(const std::size_t memory_budget) : m_memory_budget{memory_budget}, m_cursor_entry{0},
+                                                            m_cursor_edit{0}, m_group_open{false},
+                                                            m_group_start{NO_GROUP_EDITS}, m_spill_file{nullptr},
+                                                            m_spill_end{0}, m_spilled_entries{0} {}
+
+EditJournal::~EditJournal() {
+  if (m_spill_file) std::fclose(m_spill_file);
+}
+
+void EditJournal::begin_group() {
+  if (m_group_open) return;
+  m_group_open = true;
+  m_group_start = NO_GROUP_EDITS;
+  m_group_edits.clear();
+}
+
+void EditJournal::record(const ObjectId object, const int vertex, const glm::vec2& before, const glm::vec2& after) {
+  if (!m_group_open) {
+    begin_group();
+    record(object, vertex, before, after);
+    end_group();
+    return;
+  }
+
+  // Redo history is only thrown away once the group actually changes something.
+  if (m_group_start == NO_GROUP_EDITS) {
+    drop_redo();
+    m_group_start = m_edits.size();
+  }
+
+  // Keeps the first `before` and the latest `after` of each vertex. A slot reused by a newer object gets its own edit.
+  const auto index = static_cast<std::uint32_t>(vertex);
+  const std::uint64_t key = static_cast<std::uint64_t>(object.index) << 2 | index;
+  const auto [it, inserted] = m_group_edits.try_emplace(key, m_edits.size());
+  if (!inserted) {
+    VertexEdit& edit = m_edits[it->second];
+    if (edit.object == object) {
+      edit.after = after;
+      return;
+    }
+    it->second = m_edits.size();
+  }
+  m_edits.push_back({object, index, before, after});
+}
+
+void EditJournal::end_group() {
+  if (!m_group_open) return;
+  m_group_open = false;
+  m_group_edits.clear();
+  if (m_group_start == NO_GROUP_EDITS) return;
+
+  // A drag that ended where it started is not worth an entry.
+  const auto first = m_edits.begin() + static_cast<std::ptrdiff_t>(m_group_start);
+  m_edits.erase(std::remove_if(first, m_edits.end(), [](const VertexEdit& edit) { return edit.before == edit.after; }),
+                m_edits.end());
+
+  const std::size_t count = m_edits.size() - m_group_start;
+  m_group_start = NO_GROUP_EDITS;
+  if (count == 0) return;
+
+  m_entries.push_back(static_cast<std::uint32_t>(count));
+  m_cursor_entry = m_entries.size();
+  m_cursor_edit = m_edits.size();
+  enforce_budget();
+}
+
+bool EditJournal::is_group_open() const {
+  return m_group_open;
+}
+
+bool EditJournal::undo(Scene& scene) {
+  end_group();
+  if (m_cursor_entry == 0 && !reload_spilled()) return false;
+
+  const std::size_t count = m_entries[m_cursor_entry - 1];
+  for (std::size_t i = m_cursor_edit; i-- > m_cursor_edit - count;) {
+    const VertexEdit& edit = m_edits[i];
+    scene.move_vertex(edit.object, static_cast<int>(edit.vertex), edit.before);
+  }
+  --m_cursor_entry;
+  m_cursor_edit -= count;
+  return true;
+}
+
+bool EditJournal::redo(Scene& scene) {
+  end_group();
+  if (m_cursor_entry == m_entries.size()) return false;
+
+  const std::size_t count = m_entries[m_cursor_entry];
+  for (std::size_t i = m_cursor_edit; i < m_cursor_edit + count; ++i) {
+    const VertexEdit& edit = m_edits[i];
+    scene.move_vertex(edit.object, static_cast<int>(edit.vertex), edit.after);
+  }
+  ++m_cursor_entry;
+  m_cursor_edit += count;
+  enforce_budget();
+  return true;
+}
+
+bool EditJournal::can_undo() const {
+  return m_cursor_entry > 0 || !m_spilled.empty();
+}
+
+bool EditJournal::can_redo() const {
+  return m_cursor_entry < m_entries.size();
+}
+
+void EditJournal::clear() {
+  m_entries.clear();
+  m_edits.clear();
+  m_cursor_entry = 0;
+  m_cursor_edit = 0;
+  m_group_open = false;
+  m_group_start = NO_GROUP_EDITS;
+  m_group_edits.clear();
+  m_spilled.clear();
+  m_spill_end = 0;
+  m_spilled_entries = 0;
+}
+
+EditJournal::Stats EditJournal::get_stats() const {
+  return {
+    m_cursor_entry + m_spilled_entries,
+    m_entries.size() - m_cursor_entry,
+    memory_usage(),
+    m_spilled_entries,
+    static_cast<std::size_t>(m_spill_end)
+  };
+}
+
+void EditJournal::drop_redo() {
+  m_entries.resize(m_cursor_entry);
+  m_edits.resize(m_cursor_edit);
+}
+
+std::size_t EditJournal::memory_usage() const {
+  return m_entries.size() * sizeof(std::uint32_t) + m_edits.size() * sizeof(VertexEdit);
+}
+
+void EditJournal::enforce_budget() {
+  if (memory_usage() <= m_memory_budget) return;
+
+  // Spill down to half the budget so the next few edits do not hit the disk again.
+  std::size_t entries = 0;
+  std::size_t freed = 0;
+  const std::size_t excess = memory_usage() - m_memory_budget / 2;
+  while (entries < m_cursor_entry && freed < excess) {
+    freed += sizeof(std::uint32_t) + m_entries[entries] * sizeof(VertexEdit);
+    ++entries;
+  }
+  if (entries == 0) return;
+
+  if (!spill_oldest(entries)) {
+    // Without the spilled part the history would have a gap, so forget everything older as well.
+    std::cerr << "WARNING: Cannot spill undo history to disk, dropping " << entries + m_spilled_entries
+      << " oldest entries\n";
+    m_spilled.clear();
+    m_spill_end = 0;
+    m_spilled_entries = 0;
+  }
+
+  std::size_t edits = 0;
+  for (std::size_t i = 0; i < entries; ++i) edits += m_entries[i];
+  m_entries.erase(m_entries.begin(), m_entries.begin() + static_cast<std::ptrdiff_t>(entries));
+  m_edits.erase(m_edits.begin(), m_edits.begin() + static_cast<std::ptrdiff_t>(edits));
+  m_cursor_entry -= entries;
+  m_cursor_edit -= edits;
+}
+
+bool EditJournal::spill_oldest(const std::size_t entries) {
+  if (!m_spill_file) m_spill_file = std::tmpfile();
+  if (!m_spill_file) return false;
+
+  const std::vector<std::uint32_t> sizes(m_entries.begin(), m_entries.begin() + static_cast<std::ptrdiff_t>(entries));
+  std::size_t edit_count = 0;
+  for (const std::uint32_t size : sizes) edit_count += size;
+  const std::vector<VertexEdit> edits(m_edits.begin(), m_edits.begin() + static_cast<std::ptrdiff_t>(edit_count));
+
+  if (std::fseek(m_spill_file, m_spill_end, SEEK_SET) != 0 ||
+      std::fwrite(sizes.data(), sizeof(std::uint32_t), sizes.size(), m_spill_file) != sizes.size() ||
+      std::fwrite(edits.data(), sizeof(VertexEdit), edits.size(), m_spill_file) != edits.size()) {
+    return false;
+  }
+
+  m_spilled.push_back({m_spill_end, entries, edit_count});
+  m_spill_end = std::ftell(m_spill_file);
+  m_spilled_entries += entries;
+  return true;
+}
+
+bool EditJournal::reload_spilled() {
+  if (m_spilled.empty()) return false;
+
+  const SpillBlock block = m_spilled.back();
+  std::vector<std::uint32_t> sizes(block.entries);
+  std::vector<VertexEdit> edits(block.edits);
+  if (std::fseek(m_spill_file, block.offset, SEEK_SET) != 0 ||
+      std::fread(sizes.data(), sizeof(std::uint32_t), sizes.size(), m_spill_file) != sizes.size() ||
+      std::fread(edits.data(), sizeof(VertexEdit), edits.size(), m_spill_file) != edits.size()) {
+    std::cerr << "WARNING: Cannot read spilled undo history, dropping " << m_spilled_entries << " oldest entries\n";
+    m_spilled.clear();
+    m_spill_end = 0;
+    m_spilled_entries = 0;
+    return false;
+  }
+
+  m_entries.insert(m_entries.begin(), sizes.begin(), sizes.end());
+  m_edits.insert(m_edits.begin(), edits.begin(), edits.end());
+  m_cursor_entry += block.entries;
+  m_cursor_edit += block.edits;
+
+  m_spilled.pop_back();
+  m_spill_end = block.offset;
+  m_spilled_entries -= block.entries;
+  return true;
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Scene.h"
+
+struct VertexEdit {
+  ObjectId object;
+  std::uint32_t vertex;
+  glm::vec2 before;
+  glm::vec2 after;
+};
+
+/*
+* Undo/redo journal for vertex edits
+*
+* Each entry is a short run of VertexEdit deltas, never a copy of the
+* scene, so undo and redo cost O(edits in the entry). A group collects
+* everything done during one interaction; repeated moves of the same
+* vertex inside a group collapse into one delta, even when moves of
+* other vertices come in between, so a whole drag costs one 28-byte
+* delta per dragged corner. When the in-memory history grows past its budget
+* the oldest entries are spilled to an anonymous temporary file and read
+* back only once undo reaches them.
+*/
+class EditJournal {
+public:
+  static constexpr std::size_t DEFAULT_MEMORY_BUDGET = 4 * 1024 * 1024;
+
+  struct Stats {
+    std::size_t undo_entries;
+    std::size_t redo_entries;
+    std::size_t memory_bytes;
+    std::size_t spilled_entries;
+    std::size_t spilled_bytes;
+  };
+
+  explicit EditJournal(std::size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+  ~EditJournal();
+
+  EditJournal(const EditJournal&) = delete;
+  EditJournal& operator=(const EditJournal&) = delete;
+
+  void begin_group();
+  // Outside of a group every call becomes its own entry.
+  void record(ObjectId object, int vertex, const glm::vec2& before, const glm::vec2& after);
+  void end_group();
+  [[nodiscard]] bool is_group_open() const;
+
+  // Edits on objects that no longer exist are skipped.
+  bool undo(Scene& scene);
+  bool redo(Scene& scene);
+  [[nodiscard]] bool can_undo() const;
+  [[nodiscard]] bool can_redo() const;
+
+  void clear();
+
+  [[nodiscard]] Stats get_stats() const;
+
+private:
+  // Entries spilled together, stored back to back in the spill file.
+  struct SpillBlock {
+    long offset;
+    std::size_t entries;
+    std::size_t edits;
+  };
+
+  std::size_t m_memory_budget;
+
+  // In-memory history: entry sizes and their edits, oldest first. Everything before
+  // the cursor can be undone, everything after it redone.
+  std::deque<std::uint32_t> m_entries;
+  std::deque<VertexEdit> m_edits;
+  std::size_t m_cursor_entry;
+  std::size_t m_cursor_edit;
+
+  bool m_group_open;
+  std::size_t m_group_start;
+  // Open group's edits by object slot and vertex, into m_edits.
+  std::unordered_map<std::uint64_t, std::size_t> m_group_edits;
+
+  std::FILE* m_spill_file;
+  std::vector<SpillBlock> m_spilled;
+  long m_spill_end;
+  std::size_t m_spilled_entries;
+
+  void drop_redo();
+  [[nodiscard]] std::size_t memory_usage() const;
+  void enforce_budget();
+  bool spill_oldest(std::size_t entries);
+  bool reload_spilled();
+};
@@ -0,0 +1,94 @@
+﻿#include "FrameArena.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace {
+  std::size_t align_up(const std::size_t value, const std::size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+}
+
+FrameArena::FrameArena(const std::size_t capacity, std::pmr::memory_resource* upstream)
+  : m_upstream{upstream}, m_buffer{std::make_unique<std::byte[]>(capacity)}, m_capacity{capacity}, m_offset{0},
+    m_last_offset{0}, m_overflow{nullptr}, m_overflow_bytes{0}, m_overflow_count{0}, m_frame_peak{0}, m_peak{0} {}
+
+FrameArena::~FrameArena() {
+  release_overflow();
+}
+
+void FrameArena::reset() {
+  m_peak = std::max(m_peak, m_frame_peak);
+  if (m_overflow) {
+    release_overflow();
+    // Nothing allocated from the old block survives a reset, so it can simply be replaced.
+    m_capacity = std::max(m_capacity * 2, std::bit_ceil(m_frame_peak));
+    m_buffer = std::make_unique<std::byte[]>(m_capacity);
+  }
+  m_offset = 0;
+  m_last_offset = 0;
+  m_overflow_bytes = 0;
+  m_frame_peak = 0;
+}
+
+std::size_t FrameArena::get_used() const {
+  return m_offset + m_overflow_bytes;
+}
+
+std::size_t FrameArena::get_peak() const {
+  return std::max(m_peak, m_frame_peak);
+}
+
+std::size_t FrameArena::get_capacity() const {
+  return m_capacity;
+}
+
+std::size_t FrameArena::get_overflow_count() const {
+  return m_overflow_count;
+}
+
+FrameArena& FrameArena::get() {
+  static FrameArena arena;
+  return arena;
+}
+
+void* FrameArena::do_allocate(const std::size_t bytes, const std::size_t alignment) {
+  const auto base = reinterpret_cast<std::uintptr_t>(m_buffer.get());
+  const std::size_t offset = align_up(base + m_offset, alignment) - base;
+  if (offset + bytes <= m_capacity) {
+    m_last_offset = offset;
+    m_offset = offset + bytes;
+    m_frame_peak = std::max(m_frame_peak, get_used());
+    return m_buffer.get() + offset;
+  }
+
+  const std::size_t block_alignment = std::max(alignment, alignof(OverflowBlock));
+  const std::size_t header = align_up(sizeof(OverflowBlock), block_alignment);
+  void* memory = m_upstream->allocate(header + bytes, block_alignment);
+  m_overflow = new(memory) OverflowBlock{m_overflow, header + bytes, block_alignment};
+
+  m_overflow_bytes += bytes;
+  ++m_overflow_count;
+  m_frame_peak = std::max(m_frame_peak, get_used());
+  return static_cast<std::byte*>(memory) + header;
+}
+
+void FrameArena::do_deallocate(void* pointer, const std::size_t bytes, std::size_t) {
+  // Give back the most recent allocation so push_back growth does not leave holes behind.
+  if (pointer == m_buffer.get() + m_last_offset && m_last_offset + bytes == m_offset) {
+    m_offset = m_last_offset;
+  }
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
+
+void FrameArena::release_overflow() {
+  while (m_overflow) {
+    OverflowBlock* block = m_overflow;
+    m_overflow = block->next;
+    m_upstream->deallocate(block, block->size, block->alignment);
+  }
+}
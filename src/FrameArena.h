@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+/*
+* Per-frame linear arena
+*
+* Bump allocator for data that only lives until the end of the frame.
+* reset() at the top of the loop frees everything at once; deallocate
+* is a no-op except for the most recent allocation, which lets a
+* growing vector reuse its tail. Requests that do not fit go to
+* overflow blocks from the upstream heap, and the next reset grows the
+* main block to the observed peak so a steady-state frame needs none.
+* Single-threaded: use it from the render thread only.
+*/
+class FrameArena : public std::pmr::memory_resource {
+public:
+  static constexpr std::size_t DEFAULT_CAPACITY = 256 * 1024;
+
+  explicit FrameArena(std::size_t capacity = DEFAULT_CAPACITY,
+                      std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+  ~FrameArena() override;
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  void reset();
+
+  [[nodiscard]] std::size_t get_used() const;
+  [[nodiscard]] std::size_t get_peak() const;
+  [[nodiscard]] std::size_t get_capacity() const;
+  [[nodiscard]] std::size_t get_overflow_count() const;
+
+  // Arena of the render thread, reset once per frame by the main loop.
+  static FrameArena& get();
+
+protected:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+  struct OverflowBlock {
+    OverflowBlock* next;
+    std::size_t size;
+    std::size_t alignment;
+  };
+
+  std::pmr::memory_resource* m_upstream;
+  std::unique_ptr<std::byte[]> m_buffer;
+  std::size_t m_capacity;
+  std::size_t m_offset;
+  std::size_t m_last_offset;
+
+  OverflowBlock* m_overflow;
+  std::size_t m_overflow_bytes;
+  std::size_t m_overflow_count;
+  std::size_t m_frame_peak;
+  std::size_t m_peak;
+
+  void release_overflow();
+};
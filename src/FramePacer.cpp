@@ -0,0 +1,158 @@
+﻿#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define HERON_CPU_RELAX() _mm_pause()
+#else
+#define HERON_CPU_RELAX() std::this_thread::yield()
+#endif
+
+#ifdef HERON_PLATFORM_LINUX
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#endif
+
+using namespace std::chrono_literals;
+
+namespace {
+  constexpr auto MIN_SPIN_THRESHOLD = 200us;
+  constexpr auto MAX_SPIN_THRESHOLD = 4ms;
+  constexpr double OVERSLEEP_EWMA_ALPHA = 0.1;
+}
+
+FramePacer::FramePacer() : m_period{0}, m_anchored{false}, m_spin_threshold{1ms}, m_oversleep_ewma_ns{0.0},
+                           m_timer_fd{-1}, m_use_timerfd{false}, m_errors{}, m_error_head{0}, m_error_count{0} {
+#ifdef HERON_PLATFORM_LINUX
+  m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  m_use_timerfd = m_timer_fd != -1;
+#endif
+}
+
+FramePacer::~FramePacer() {
+#ifdef HERON_PLATFORM_LINUX
+  if (m_timer_fd != -1) close(m_timer_fd);
+#endif
+}
+
+void FramePacer::set_target_fps(const int target_fps) {
+  const auto period = std::chrono::nanoseconds{1'000'000'000LL / std::max(target_fps, 1)};
+  if (period == m_period) return;
+  m_period = period;
+  m_anchored = false;
+}
+
+void FramePacer::set_use_timerfd(const bool use_timerfd) {
+  m_use_timerfd = use_timerfd && is_timerfd_available();
+}
+
+void FramePacer::wait() {
+  const auto now = clock::now();
+
+  if (!m_anchored) {
+    m_deadline = now + m_period;
+    m_anchored = true;
+  }
+  else if (now >= m_deadline + m_period) {
+    // More than a whole frame late (hitch, window drag). Re-anchor instead of
+    // rushing through the missed deadlines back to back.
+    m_deadline = now;
+  }
+
+  wait_until(m_deadline);
+  record_error(clock::now() - m_deadline);
+
+  m_deadline += m_period;
+}
+
+void FramePacer::reset() {
+  m_anchored = false;
+}
+
+bool FramePacer::is_timerfd_available() const {
+  return m_timer_fd != -1;
+}
+
+bool FramePacer::is_using_timerfd() const {
+  return m_use_timerfd;
+}
+
+std::chrono::nanoseconds FramePacer::get_spin_threshold() const {
+  return m_spin_threshold;
+}
+
+FramePacer::Stats FramePacer::get_stats() const {
+  if (m_error_count == 0) return {0.0, 0.0, 0.0, 0};
+
+  std::array<std::int64_t, ERROR_HISTORY> sorted{};
+  std::copy_n(m_errors.begin(), m_error_count, sorted.begin());
+  const auto first = sorted.begin();
+  const auto last = sorted.begin() + static_cast<std::ptrdiff_t>(m_error_count);
+
+  const auto percentile = [&](const double p) {
+    const auto nth = first + static_cast<std::ptrdiff_t>(p * static_cast<double>(m_error_count - 1));
+    std::nth_element(first, nth, last);
+    return static_cast<double>(*nth) / 1000.0;
+  };
+
+  Stats stats{};
+  stats.p50_us = percentile(0.50);
+  stats.p99_us = percentile(0.99);
+  stats.max_us = static_cast<double>(*std::max_element(first, last)) / 1000.0;
+  stats.samples = m_error_count;
+  return stats;
+}
+
+std::size_t FramePacer::copy_error_history(float* out, const std::size_t capacity) const {
+  const std::size_t count = std::min(capacity, m_error_count);
+  const std::size_t start = (m_error_head + ERROR_HISTORY - count) % ERROR_HISTORY;
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = static_cast<float>(m_errors[(start + i) % ERROR_HISTORY]) / 1000.0f;
+  }
+  return count;
+}
+
+void FramePacer::wait_until(const clock::time_point deadline) {
+  const auto wake_point = deadline - m_spin_threshold;
+  if (clock::now() < wake_point) {
+    coarse_sleep_until(wake_point);
+
+    // Track how late the OS wakes us up and keep the spin window just above it.
+    const auto oversleep = std::chrono::duration<double, std::nano>(clock::now() - wake_point).count();
+    m_oversleep_ewma_ns += OVERSLEEP_EWMA_ALPHA * (std::max(oversleep, 0.0) - m_oversleep_ewma_ns);
+    const auto threshold = std::chrono::nanoseconds{static_cast<long long>(m_oversleep_ewma_ns * 2.0)} + 100us;
+    m_spin_threshold = std::clamp<std::chrono::nanoseconds>(threshold, MIN_SPIN_THRESHOLD, MAX_SPIN_THRESHOLD);
+  }
+
+  while (clock::now() < deadline) {
+    HERON_CPU_RELAX();
+  }
+}
+
+void FramePacer::coarse_sleep_until(const clock::time_point wake_point) {
+#ifdef HERON_PLATFORM_LINUX
+  // steady_clock is CLOCK_MONOTONIC on Linux, so its epoch can be handed to timerfd directly.
+  if (m_use_timerfd) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wake_point.time_since_epoch()).count();
+    itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(ns / 1'000'000'000LL);
+    spec.it_value.tv_nsec = static_cast<long>(ns % 1'000'000'000LL);
+    if (timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == 0) {
+      std::uint64_t expirations;
+      while (read(m_timer_fd, &expirations, sizeof(expirations)) == -1 && errno == EINTR) {}
+      return;
+    }
+  }
+#endif
+  std::this_thread::sleep_until(wake_point);
+}
+
+void FramePacer::record_error(const std::chrono::nanoseconds error) {
+  m_errors[m_error_head] = error.count();
+  m_error_head = (m_error_head + 1) % ERROR_HISTORY;
+  m_error_count = std::min(m_error_count + 1, ERROR_HISTORY);
+}
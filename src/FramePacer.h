@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "platform.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+/*
+* Frame pacer
+*
+* Keeps frames on an absolute schedule (deadline += period) with
+* nanosecond resolution. Waiting is hybrid: a coarse sleep (or a
+* timerfd wait on Linux) until just before the deadline, then a
+* short spin to hit it precisely.
+*/
+class FramePacer {
+public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t ERROR_HISTORY = 512;
+
+  struct Stats {
+    double p50_us;
+    double p99_us;
+    double max_us;
+    std::size_t samples;
+  };
+
+  FramePacer();
+  ~FramePacer();
+
+  FramePacer(const FramePacer&) = delete;
+  FramePacer& operator=(const FramePacer&) = delete;
+
+  void set_target_fps(int target_fps);
+  void set_use_timerfd(bool use_timerfd);
+
+  // Blocks until the next deadline of the schedule. Call once per frame.
+  void wait();
+  // Drops the schedule, the next wait() re-anchors to the current time.
+  void reset();
+
+  [[nodiscard]] bool is_timerfd_available() const;
+  [[nodiscard]] bool is_using_timerfd() const;
+  [[nodiscard]] std::chrono::nanoseconds get_spin_threshold() const;
+  [[nodiscard]] Stats get_stats() const;
+
+  // Copies the error history (oldest first, in microseconds) for plotting.
+  std::size_t copy_error_history(float* out, std::size_t capacity) const;
+
+private:
+  std::chrono::nanoseconds m_period;
+  clock::time_point m_deadline;
+  bool m_anchored;
+
+  std::chrono::nanoseconds m_spin_threshold;
+  double m_oversleep_ewma_ns;
+
+  int m_timer_fd;
+  bool m_use_timerfd;
+
+  std::array<std::int64_t, ERROR_HISTORY> m_errors;
+  std::size_t m_error_head;
+  std::size_t m_error_count;
+
+  void wait_until(clock::time_point deadline);
+  void coarse_sleep_until(clock::time_point wake_point);
+  void record_error(std::chrono::nanoseconds error);
+};
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <utility>
+
+#include "GpuResources.h"
+
+/*
+* Owning GL object name
+*
+* Move-only: the moved-from handle is empty, and only a non-empty
+* handle deletes its object (through GpuResources, so the registry and
+* the state cache hear about it). Wrap names that GpuResources created.
+*/
+template <GpuResourceType Type>
+class GLHandle {
+public:
+  GLHandle() = default;
+  explicit GLHandle(const unsigned int id) : m_id{id} {}
+  ~GLHandle() { reset(); }
+
+  GLHandle(const GLHandle&) = delete;
+  GLHandle& operator=(const GLHandle&) = delete;
+
+  GLHandle(GLHandle&& other) noexcept : m_id{std::exchange(other.m_id, 0)} {}
+
+  GLHandle& operator=(GLHandle&& other) noexcept {
+    if (this != &other) {
+      reset();
+      m_id = std::exchange(other.m_id, 0);
+    }
+    return *this;
+  }
+
+  [[nodiscard]] unsigned int get() const { return m_id; }
+  explicit operator bool() const { return m_id != 0; }
+
+  // Gives up ownership without deleting.
+  [[nodiscard]] unsigned int release() { return std::exchange(m_id, 0); }
+
+  void reset(const unsigned int id = 0) {
+    if (m_id != 0) {
+      if constexpr (Type == GpuResourceType::BUFFER) GpuResources::delete_buffer(m_id);
+      else if constexpr (Type == GpuResourceType::VERTEX_ARRAY) GpuResources::delete_vertex_array(m_id);
+      else if constexpr (Type == GpuResourceType::PROGRAM) GpuResources::delete_program(m_id);
+      else if constexpr (Type == GpuResourceType::TEXTURE) GpuResources::delete_texture(m_id);
+    }
+    m_id = id;
+  }
+
+private:
+  unsigned int m_id = 0;
+};
+
+using BufferHandle = GLHandle<GpuResourceType::BUFFER>;
+using VertexArrayHandle = GLHandle<GpuResourceType::VERTEX_ARRAY>;
+using ProgramHandle = GLHandle<GpuResourceType::PROGRAM>;
+using TextureHandle = GLHandle<GpuResourceType::TEXTURE>;
@@ -0,0 +1,154 @@
+﻿#include "GLState.h"
+
+#include <array>
+
+#include "Renderer.h"
+
+namespace {
+  constexpr unsigned int UNKNOWN = 0xFFFFFFFFu;
+
+  struct CachedState {
+    unsigned int program = UNKNOWN;
+    unsigned int vertex_array = UNKNOWN;
+    unsigned int array_buffer = UNKNOWN;
+    unsigned int element_buffer = UNKNOWN;
+    int blend = -1; // -1 unknown, 0 disabled, 1 enabled
+    unsigned int blend_source = UNKNOWN;
+    unsigned int blend_destination = UNKNOWN;
+    std::array<int, 4> viewport{-1, -1, -1, -1};
+    bool viewport_known = false;
+
+    GLState::Stats current{0, 0};
+    GLState::Stats last{0, 0};
+  };
+
+  CachedState& state() {
+    static CachedState s;
+    return s;
+  }
+
+  // True when the call has to go to GL; counts either way.
+  bool changes(unsigned int& cached, const unsigned int value) {
+    CachedState& s = state();
+    if (cached == value) {
+      ++s.current.skipped;
+      return false;
+    }
+    cached = value;
+    ++s.current.issued;
+    return true;
+  }
+}
+
+void GLState::use_program(const unsigned int program) {
+  if (!changes(state().program, program)) return;
+  GLCall(glUseProgram(program));
+}
+
+void GLState::bind_vertex_array(const unsigned int vertex_array) {
+  CachedState& s = state();
+  if (!changes(s.vertex_array, vertex_array)) return;
+  s.element_buffer = UNKNOWN;
+  GLCall(glBindVertexArray(vertex_array));
+}
+
+void GLState::bind_buffer(const unsigned int target, const unsigned int buffer) {
+  CachedState& s = state();
+  if (target == GL_ARRAY_BUFFER) {
+    if (!changes(s.array_buffer, buffer)) return;
+  }
+  else if (target == GL_ELEMENT_ARRAY_BUFFER) {
+    if (!changes(s.element_buffer, buffer)) return;
+  }
+  else {
+    ++s.current.issued;
+  }
+  GLCall(glBindBuffer(target, buffer));
+}
+
+void GLState::set_blend(const bool enabled) {
+  CachedState& s = state();
+  if (s.blend == static_cast<int>(enabled)) {
+    ++s.current.skipped;
+    return;
+  }
+  s.blend = enabled;
+  ++s.current.issued;
+  if (enabled) {
+    GLCall(glEnable(GL_BLEND));
+  }
+  else {
+    GLCall(glDisable(GL_BLEND));
+  }
+}
+
+void GLState::blend_func(const unsigned int source, const unsigned int destination) {
+  CachedState& s = state();
+  if (s.blend_source == source && s.blend_destination == destination) {
+    ++s.current.skipped;
+    return;
+  }
+  s.blend_source = source;
+  s.blend_destination = destination;
+  ++s.current.issued;
+  GLCall(glBlendFunc(source, destination));
+}
+
+void GLState::viewport(const int x, const int y, const int width, const int height) {
+  CachedState& s = state();
+  const std::array<int, 4> value{x, y, width, height};
+  if (s.viewport_known && s.viewport == value) {
+    ++s.current.skipped;
+    return;
+  }
+  s.viewport = value;
+  s.viewport_known = true;
+  ++s.current.issued;
+  GLCall(glViewport(x, y, width, height));
+}
+
+std::array<int, 4> GLState::get_viewport() {
+  CachedState& s = state();
+  if (!s.viewport_known) {
+    GLCall(glGetIntegerv(GL_VIEWPORT, s.viewport.data()));
+    s.viewport_known = true;
+  }
+  return s.viewport;
+}
+
+void GLState::forget_program(const unsigned int program) {
+  // A deleted program stays in use until replaced, but its name must not match a future one.
+  if (state().program == program) state().program = UNKNOWN;
+}
+
+void GLState::forget_vertex_array(const unsigned int vertex_array) {
+  CachedState& s = state();
+  if (s.vertex_array != vertex_array) return;
+  s.vertex_array = 0;
+  s.element_buffer = UNKNOWN;
+}
+
+void GLState::forget_buffer(const unsigned int buffer) {
+  CachedState& s = state();
+  if (s.array_buffer == buffer) s.array_buffer = 0;
+  if (s.element_buffer == buffer) s.element_buffer = 0;
+}
+
+void GLState::invalidate() {
+  CachedState& s = state();
+  const Stats current = s.current;
+  const Stats last = s.last;
+  s = CachedState{};
+  s.current = current;
+  s.last = last;
+}
+
+void GLState::new_frame() {
+  CachedState& s = state();
+  s.last = s.current;
+  s.current = {0, 0};
+}
+
+GLState::Stats GLState::get_last_frame() {
+  return state().last;
+}
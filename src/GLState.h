@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+
+/*
+* GL state cache
+*
+* Mirrors the bound program, vertex array, array/element buffer, blend
+* and viewport state of the context and only calls GL when a request
+* would change something. Everything starts out unknown, so the first
+* request always reaches the driver.
+*
+* The element buffer binding belongs to the vertex array, so it becomes
+* unknown whenever the vertex array changes. GpuResources reports
+* deletions so a recycled name is never mistaken for a bound one. Code
+* that changes this state without restoring it must call invalidate();
+* the ImGui OpenGL backend restores what it touches.
+* GL context thread only.
+*/
+class GLState {
+public:
+  struct Stats {
+    std::uint64_t issued;
+    std::uint64_t skipped;
+  };
+
+  static void use_program(unsigned int program);
+  static void bind_vertex_array(unsigned int vertex_array);
+  // GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER are cached, other targets go straight to GL.
+  static void bind_buffer(unsigned int target, unsigned int buffer);
+  static void set_blend(bool enabled);
+  static void blend_func(unsigned int source, unsigned int destination);
+  static void viewport(int x, int y, int width, int height);
+  // x, y, width, height; asks GL only while the viewport is unknown.
+  [[nodiscard]] static std::array<int, 4> get_viewport();
+
+  static void forget_program(unsigned int program);
+  static void forget_vertex_array(unsigned int vertex_array);
+  static void forget_buffer(unsigned int buffer);
+  static void invalidate();
+
+  // Closes the frame's counters; get_last_frame() returns them afterwards.
+  static void new_frame();
+  [[nodiscard]] static Stats get_last_frame();
+};
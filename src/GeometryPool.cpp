@@ -0,0 +1,191 @@
+﻿#include "GeometryPool.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "GLState.h"
+#include "Renderer.h"
+#include "scoped_timer.h"
+
+namespace {
+  void copy_buffer(const unsigned int source, const unsigned int destination, const std::size_t source_offset,
+                   const std::size_t destination_offset, const std::size_t size) {
+    if (size == 0) return;
+    if (Renderer::has_direct_state_access()) {
+      GLCall(glCopyNamedBufferSubData(source, destination, static_cast<GLintptr>(source_offset),
+                                      static_cast<GLintptr>(destination_offset), static_cast<GLsizeiptr>(size)));
+      return;
+    }
+    GLState::bind_buffer(GL_COPY_READ_BUFFER, source);
+    GLState::bind_buffer(GL_COPY_WRITE_BUFFER, destination);
+    GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(source_offset),
+                               static_cast<GLintptr>(destination_offset), static_cast<GLsizeiptr>(size)));
+  }
+
+  const void* index_offset(const std::size_t first_index) {
+    return reinterpret_cast<const void*>(static_cast<std::uintptr_t>(first_index * sizeof(unsigned int)));
+  }
+}
+
+GeometryPool::GeometryPool(const VertexBufferLayout& layout, const std::string_view owner,
+                           const std::size_t page_vertices, const std::size_t page_indices)
+  : m_layout{layout}, m_owner{owner}, m_page_vertices{page_vertices}, m_page_indices{page_indices} {}
+
+GeometryId GeometryPool::allocate(const void* vertices, const std::size_t vertex_count, const unsigned int* indices,
+                                  const std::size_t index_count) {
+  if (vertex_count == 0 || index_count == 0) return {};
+
+  std::size_t page_index = 0;
+  std::size_t first_vertex = BufferSuballocator::INVALID_OFFSET;
+  std::size_t first_index = BufferSuballocator::INVALID_OFFSET;
+  for (; page_index < m_pages.size(); ++page_index) {
+    Page& page = m_pages[page_index];
+    if (page.vertex_space.get_largest_free() < vertex_count || page.index_space.get_largest_free() < index_count) {
+      continue;
+    }
+    first_vertex = page.vertex_space.allocate(vertex_count);
+    first_index = page.index_space.allocate(index_count);
+    break;
+  }
+  if (page_index == m_pages.size()) {
+    m_pages.push_back(create_page(std::max(m_page_vertices, vertex_count), std::max(m_page_indices, index_count)));
+    first_vertex = m_pages.back().vertex_space.allocate(vertex_count);
+    first_index = m_pages.back().index_space.allocate(index_count);
+  }
+
+  Page& page = m_pages[page_index];
+  const std::size_t stride = m_layout.get_stride();
+  page.vertices->set_sub_data(first_vertex * stride, vertices, vertex_count * stride);
+  page.indices->set_sub_data(first_index, indices, index_count);
+  ++page.ranges;
+  return m_ranges.insert({page_index, first_vertex, vertex_count, first_index, index_count});
+}
+
+void GeometryPool::release(const GeometryId id) {
+  const Range* range = m_ranges.get(id);
+  if (!range) return;
+  Page& page = m_pages[range->page];
+  page.vertex_space.free(range->first_vertex, range->vertex_count);
+  page.index_space.free(range->first_index, range->index_count);
+  --page.ranges;
+  m_ranges.erase(id);
+}
+
+const GeometryPool::Range* GeometryPool::get(const GeometryId id) const {
+  return m_ranges.get(id);
+}
+
+void GeometryPool::draw(const GeometryId id, const unsigned int primitive) const {
+  const Range* range = m_ranges.get(id);
+  if (!range || range->index_count == 0) return;
+  m_pages[range->page].vertex_array->bind();
+  GLCall(glDrawElementsBaseVertex(primitive, static_cast<GLsizei>(range->index_count), GL_UNSIGNED_INT,
+                                  index_offset(range->first_index), static_cast<GLint>(range->first_vertex)));
+}
+
+void GeometryPool::draw(const std::span<const GeometryId> ids, const unsigned int primitive) const {
+  for (std::size_t page_index = 0; page_index < m_pages.size(); ++page_index) {
+    m_counts.clear();
+    m_offsets.clear();
+    m_base_vertices.clear();
+    for (const GeometryId id : ids) {
+      const Range* range = m_ranges.get(id);
+      if (!range || range->page != page_index || range->index_count == 0) continue;
+      m_counts.push_back(static_cast<int>(range->index_count));
+      m_offsets.push_back(index_offset(range->first_index));
+      m_base_vertices.push_back(static_cast<int>(range->first_vertex));
+    }
+    if (m_counts.empty()) continue;
+
+    m_pages[page_index].vertex_array->bind();
+    GLCall(glMultiDrawElementsBaseVertex(primitive, m_counts.data(), GL_UNSIGNED_INT, m_offsets.data(),
+                                         static_cast<GLsizei>(m_counts.size()), m_base_vertices.data()));
+  }
+}
+
+std::size_t GeometryPool::defragment() {
+  HG_SCOPED_TIMER("GeometryPool::defragment");
+  std::size_t moved = 0;
+  for (std::size_t page_index = 0; page_index < m_pages.size(); ++page_index) moved += compact(page_index);
+  return moved;
+}
+
+GeometryPool::Stats GeometryPool::get_stats() const {
+  Stats stats{m_pages.size(), m_ranges.size(), 0, 0, 0, 0, 0};
+  for (const Page& page : m_pages) {
+    stats.vertices_used += page.vertex_space.get_used();
+    stats.vertex_capacity += page.vertex_space.get_capacity();
+    stats.indices_used += page.index_space.get_used();
+    stats.index_capacity += page.index_space.get_capacity();
+    stats.free_blocks += page.vertex_space.get_free_blocks() + page.index_space.get_free_blocks();
+  }
+  return stats;
+}
+
+const VertexBufferLayout& GeometryPool::get_layout() const {
+  return m_layout;
+}
+
+GeometryPool::Page GeometryPool::create_page(const std::size_t vertex_capacity,
+                                             const std::size_t index_capacity) const {
+  Page page;
+  page.vertices = std::make_unique<VertexBuffer>(nullptr, static_cast<unsigned int>(vertex_capacity * m_layout.get_stride()),
+                                                 m_owner, GL_STATIC_DRAW);
+  page.indices = std::make_unique<IndexBuffer>(nullptr, static_cast<unsigned int>(index_capacity), m_owner);
+  page.vertex_array = std::make_unique<VertexArray>(m_owner);
+  page.vertex_array->add_buffer(*page.vertices, m_layout);
+  page.vertex_array->set_index_buffer(*page.indices);
+  page.vertex_space = BufferSuballocator{vertex_capacity};
+  page.index_space = BufferSuballocator{index_capacity};
+  return page;
+}
+
+std::size_t GeometryPool::compact(const std::size_t page_index) {
+  Page& page = m_pages[page_index];
+  if (page.ranges == 0) {
+    page.vertex_space.reset();
+    page.index_space.reset();
+    return 0;
+  }
+
+  // Live ranges in vertex order; packing keeps their relative order.
+  std::vector<Range*> live;
+  live.reserve(page.ranges);
+  for (Range& range : m_ranges) {
+    if (range.page == page_index) live.push_back(&range);
+  }
+  std::sort(live.begin(), live.end(), [](const Range* a, const Range* b) { return a->first_vertex < b->first_vertex; });
+
+  std::size_t next_vertex = 0;
+  std::size_t next_index = 0;
+  bool packed = true;
+  for (const Range* range : live) {
+    packed = packed && range->first_vertex == next_vertex && range->first_index == next_index;
+    next_vertex += range->vertex_count;
+    next_index += range->index_count;
+  }
+  if (packed) return 0;
+
+  // GL forbids overlapping copies within one buffer, so pack into a fresh page and swap.
+  Page fresh = create_page(page.vertex_space.get_capacity(), page.index_space.get_capacity());
+  const std::size_t stride = m_layout.get_stride();
+  next_vertex = 0;
+  next_index = 0;
+  std::size_t moved = 0;
+  for (Range* range : live) {
+    copy_buffer(page.vertices->get_id(), fresh.vertices->get_id(), range->first_vertex * stride, next_vertex * stride,
+                range->vertex_count * stride);
+    copy_buffer(page.indices->get_id(), fresh.indices->get_id(), range->first_index * sizeof(unsigned int),
+                next_index * sizeof(unsigned int), range->index_count * sizeof(unsigned int));
+    if (range->first_vertex != next_vertex || range->first_index != next_index) ++moved;
+    range->first_vertex = next_vertex;
+    range->first_index = next_index;
+    next_vertex += range->vertex_count;
+    next_index += range->index_count;
+  }
+  fresh.vertex_space.reset(next_vertex);
+  fresh.index_space.reset(next_index);
+  fresh.ranges = page.ranges;
+  page = std::move(fresh);
+  return moved;
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BufferSuballocator.h"
+#include "IndexBuffer.h"
+#include "SlotMap.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+
+using GeometryId = SlotId;
+
+/*
+* Shared geometry pages
+*
+* Indexed geometry of one vertex layout sub-allocated from a few large
+* pages, each a vertex buffer, an index buffer and one vertex array.
+* Indices are relative to the range's first vertex and drawn with a
+* base vertex, so ranges can move without rewriting them. Everything on
+* a page goes out with a single glMultiDrawElementsBaseVertex.
+* defragment() packs the live ranges of fragmented pages to the front
+* by copying them into fresh buffers on the GPU; ids stay valid.
+*/
+class GeometryPool {
+public:
+  static constexpr std::size_t DEFAULT_PAGE_VERTICES = 64 * 1024;
+  static constexpr std::size_t DEFAULT_PAGE_INDICES = 256 * 1024;
+
+  struct Range {
+    std::size_t page;
+    std::size_t first_vertex;
+    std::size_t vertex_count;
+    std::size_t first_index;
+    std::size_t index_count;
+  };
+
+  struct Stats {
+    std::size_t pages;
+    std::size_t ranges;
+    std::size_t vertices_used;
+    std::size_t vertex_capacity;
+    std::size_t indices_used;
+    std::size_t index_capacity;
+    std::size_t free_blocks;
+  };
+
+  GeometryPool(const VertexBufferLayout& layout, std::string_view owner,
+               std::size_t page_vertices = DEFAULT_PAGE_VERTICES, std::size_t page_indices = DEFAULT_PAGE_INDICES);
+
+  GeometryPool(const GeometryPool&) = delete;
+  GeometryPool& operator=(const GeometryPool&) = delete;
+
+  // `vertices` must match the pool's layout. Larger than a page gets a page of its own; empty geometry an invalid id.
+  [[nodiscard]] GeometryId allocate(const void* vertices, std::size_t vertex_count, const unsigned int* indices,
+                                    std::size_t index_count);
+  void release(GeometryId id);
+  [[nodiscard]] const Range* get(GeometryId id) const;
+
+  void draw(GeometryId id, unsigned int primitive) const;
+  // One multi-draw per page touched by `ids`.
+  void draw(std::span<const GeometryId> ids, unsigned int primitive) const;
+
+  // Returns the number of ranges that moved.
+  std::size_t defragment();
+
+  [[nodiscard]] Stats get_stats() const;
+  [[nodiscard]] const VertexBufferLayout& get_layout() const;
+
+private:
+  struct Page {
+    std::unique_ptr<VertexBuffer> vertices;
+    std::unique_ptr<IndexBuffer> indices;
+    std::unique_ptr<VertexArray> vertex_array;
+    BufferSuballocator vertex_space;
+    BufferSuballocator index_space;
+    std::size_t ranges = 0;
+  };
+
+  VertexBufferLayout m_layout;
+  std::string m_owner;
+  std::size_t m_page_vertices;
+  std::size_t m_page_indices;
+  std::vector<Page> m_pages;
+  SlotMap<Range> m_ranges;
+
+  // Scratch for multi-draw, reused across frames.
+  mutable std::vector<int> m_counts;
+  mutable std::vector<const void*> m_offsets;
+  mutable std::vector<int> m_base_vertices;
+
+  Page create_page(std::size_t vertex_capacity, std::size_t index_capacity) const;
+  std::size_t compact(std::size_t page_index);
+};
@@ -0,0 +1,236 @@
+﻿#include "GpuResources.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include <imgui.h>
+
+#include "GLState.h"
+#include "Renderer.h"
+
+namespace {
+  struct RegistryState {
+    std::unordered_map<std::uint64_t, GpuResourceInfo> resources;
+    std::array<GpuResources::CategoryStats, static_cast<std::size_t>(GpuResourceType::COUNT)> stats{};
+  };
+
+  constexpr const char* CATEGORY_LABELS[] = {"Buffers", "Vertex arrays", "Programs", "Textures"};
+
+  RegistryState& state() {
+    static RegistryState s;
+    return s;
+  }
+
+  std::uint64_t key(const GpuResourceType type, const unsigned int id) {
+    return static_cast<std::uint64_t>(type) << 32 | id;
+  }
+
+  GpuResources::CategoryStats& category(const GpuResourceType type) {
+    return state().stats[static_cast<std::size_t>(type)];
+  }
+
+  void track(const GpuResourceType type, const unsigned int id, const std::string_view owner) {
+    if (id == 0) return;
+    const auto [it, inserted] = state().resources.try_emplace(key(type, id), type, id, 0, 0, std::string{owner});
+    if (!inserted) {
+      std::cerr << "WARNING: GL " << GpuResources::type_name(type) << ' ' << id << " registered twice ('"
+        << it->second.owner << "' and '" << owner << "')\n";
+      return;
+    }
+    ++category(type).count;
+  }
+
+  void untrack(const GpuResourceType type, const unsigned int id) {
+    if (id == 0) return;
+    const auto it = state().resources.find(key(type, id));
+    if (it == state().resources.end()) {
+      std::cerr << "WARNING: Deleting unregistered GL " << GpuResources::type_name(type) << ' ' << id << '\n';
+      return;
+    }
+    GpuResources::CategoryStats& stats = category(type);
+    --stats.count;
+    stats.bytes -= it->second.size;
+    state().resources.erase(it);
+  }
+
+  void resize(const GpuResourceType type, const unsigned int id, const std::size_t size, const unsigned int usage) {
+    const auto it = state().resources.find(key(type, id));
+    if (it == state().resources.end()) return;
+    GpuResources::CategoryStats& stats = category(type);
+    stats.bytes = stats.bytes - it->second.size + size;
+    it->second.size = size;
+    it->second.usage = usage;
+  }
+}
+
+unsigned int GpuResources::create_buffer(const std::string_view owner) {
+  unsigned int buffer = 0;
+  if (Renderer::has_direct_state_access()) {
+    GLCall(glCreateBuffers(1, &buffer));
+  }
+  else {
+    GLCall(glGenBuffers(1, &buffer));
+  }
+  track(GpuResourceType::BUFFER, buffer, owner);
+  return buffer;
+}
+
+void GpuResources::buffer_data(const unsigned int target, const unsigned int buffer, const std::size_t size,
+                               const void* data, const unsigned int usage) {
+  GLCall(glBufferData(target, static_cast<GLsizeiptr>(size), data, usage));
+  resize(GpuResourceType::BUFFER, buffer, size, usage);
+}
+
+void GpuResources::buffer_data(const unsigned int buffer, const std::size_t size, const void* data,
+                               const unsigned int usage) {
+  if (Renderer::has_direct_state_access()) {
+    GLCall(glNamedBufferData(buffer, static_cast<GLsizeiptr>(size), data, usage));
+    resize(GpuResourceType::BUFFER, buffer, size, usage);
+    return;
+  }
+  // Not vertex array state, so whatever VAO is bound stays untouched.
+  GLState::bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+  buffer_data(GL_COPY_WRITE_BUFFER, buffer, size, data, usage);
+}
+
+void GpuResources::delete_buffer(unsigned int& buffer) {
+  if (buffer == 0) return;
+  untrack(GpuResourceType::BUFFER, buffer);
+  GLState::forget_buffer(buffer);
+  GLCall(glDeleteBuffers(1, &buffer));
+  buffer = 0;
+}
+
+unsigned int GpuResources::create_vertex_array(const std::string_view owner) {
+  unsigned int vertex_array = 0;
+  if (Renderer::has_direct_state_access()) {
+    GLCall(glCreateVertexArrays(1, &vertex_array));
+  }
+  else {
+    GLCall(glGenVertexArrays(1, &vertex_array));
+  }
+  track(GpuResourceType::VERTEX_ARRAY, vertex_array, owner);
+  return vertex_array;
+}
+
+void GpuResources::delete_vertex_array(unsigned int& vertex_array) {
+  if (vertex_array == 0) return;
+  untrack(GpuResourceType::VERTEX_ARRAY, vertex_array);
+  GLState::forget_vertex_array(vertex_array);
+  GLCall(glDeleteVertexArrays(1, &vertex_array));
+  vertex_array = 0;
+}
+
+unsigned int GpuResources::create_program(const std::string_view owner) {
+  GLCall(const unsigned int program = glCreateProgram());
+  track(GpuResourceType::PROGRAM, program, owner);
+  return program;
+}
+
+void GpuResources::delete_program(unsigned int& program) {
+  if (program == 0) return;
+  untrack(GpuResourceType::PROGRAM, program);
+  GLState::forget_program(program);
+  GLCall(glDeleteProgram(program));
+  program = 0;
+}
+
+unsigned int GpuResources::create_texture(const std::string_view owner) {
+  unsigned int texture = 0;
+  GLCall(glGenTextures(1, &texture));
+  track(GpuResourceType::TEXTURE, texture, owner);
+  return texture;
+}
+
+void GpuResources::set_texture_size(const unsigned int texture, const std::size_t size) {
+  resize(GpuResourceType::TEXTURE, texture, size, 0);
+}
+
+void GpuResources::delete_texture(unsigned int& texture) {
+  if (texture == 0) return;
+  untrack(GpuResourceType::TEXTURE, texture);
+  GLCall(glDeleteTextures(1, &texture));
+  texture = 0;
+}
+
+void GpuResources::set_owner(const GpuResourceType type, const unsigned int id, const std::string_view owner) {
+  const auto it = state().resources.find(key(type, id));
+  if (it != state().resources.end()) it->second.owner = owner;
+}
+
+const GpuResourceInfo* GpuResources::find(const GpuResourceType type, const unsigned int id) {
+  const auto it = state().resources.find(key(type, id));
+  return it == state().resources.end() ? nullptr : &it->second;
+}
+
+GpuResources::CategoryStats GpuResources::get_stats(const GpuResourceType type) {
+  return category(type);
+}
+
+std::size_t GpuResources::get_total_bytes() {
+  std::size_t total = 0;
+  for (const CategoryStats& stats : state().stats) total += stats.bytes;
+  return total;
+}
+
+std::size_t GpuResources::report_leaks() {
+  const auto& resources = state().resources;
+  for (const auto& [key, info] : resources) {
+    std::cerr << "WARNING: Leaked GL " << type_name(info.type) << ' ' << info.id << " owned by '" << info.owner
+      << "' (" << info.size << " bytes)\n";
+  }
+  if (resources.empty()) std::cout << "INFO: No GL resources leaked\n";
+  return resources.size();
+}
+
+void GpuResources::render_stats() {
+  ImGui::Text("GPU memory: %.1f KB", static_cast<double>(get_total_bytes()) / 1024.0);
+  for (std::size_t i = 0; i < static_cast<std::size_t>(GpuResourceType::COUNT); ++i) {
+    const auto type = static_cast<GpuResourceType>(i);
+    const CategoryStats& stats = category(type);
+    ImGui::Text("  %s: %zu, %.1f KB", CATEGORY_LABELS[i], stats.count, static_cast<double>(stats.bytes) / 1024.0);
+  }
+
+  if (!ImGui::TreeNode("GL objects")) return;
+  std::vector<const GpuResourceInfo*> sorted;
+  sorted.reserve(state().resources.size());
+  for (const auto& [key, info] : state().resources) sorted.push_back(&info);
+  std::sort(sorted.begin(), sorted.end(), [](const GpuResourceInfo* a, const GpuResourceInfo* b) {
+    return a->type != b->type ? a->type < b->type : a->size > b->size;
+  });
+  for (const GpuResourceInfo* info : sorted) {
+    ImGui::Text("%s %u  %s  %zu B  %s", type_name(info->type), info->id, info->owner.c_str(), info->size,
+                usage_name(info->usage));
+  }
+  ImGui::TreePop();
+}
+
+const char* GpuResources::type_name(const GpuResourceType type) {
+  switch (type) {
+  case GpuResourceType::BUFFER: return "buffer";
+  case GpuResourceType::VERTEX_ARRAY: return "vertex array";
+  case GpuResourceType::PROGRAM: return "program";
+  case GpuResourceType::TEXTURE: return "texture";
+  case GpuResourceType::COUNT: break;
+  }
+  return "unknown";
+}
+
+const char* GpuResources::usage_name(const unsigned int usage) {
+  switch (usage) {
+  case 0: return "";
+  case GL_STATIC_DRAW: return "static draw";
+  case GL_DYNAMIC_DRAW: return "dynamic draw";
+  case GL_STREAM_DRAW: return "stream draw";
+  case GL_STATIC_READ: return "static read";
+  case GL_DYNAMIC_READ: return "dynamic read";
+  case GL_STREAM_READ: return "stream read";
+  case GL_STATIC_COPY: return "static copy";
+  case GL_DYNAMIC_COPY: return "dynamic copy";
+  case GL_STREAM_COPY: return "stream copy";
+  }
+  return "other";
+}
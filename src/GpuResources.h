@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+* GPU resource registry
+*
+* Every buffer, vertex array, program and texture is created and deleted
+* through here so the live set is known: type, owner, size and usage
+* hint of each object. Sizes are what the application asked for, not
+* what the driver actually reserved. Call report_leaks() after the last
+* owner is gone to list anything that was never deleted. With direct
+* state access, buffers and vertex arrays come from glCreate* so they
+* are usable without a first bind.
+* GL context thread only.
+*/
+enum class GpuResourceType {
+  BUFFER,
+  VERTEX_ARRAY,
+  PROGRAM,
+  TEXTURE,
+  COUNT
+};
+
+struct GpuResourceInfo {
+  GpuResourceType type;
+  unsigned int id;
+  std::size_t size;   // bytes, 0 for objects without storage
+  unsigned int usage; // GL usage hint of buffers, 0 otherwise
+  std::string owner;
+};
+
+class GpuResources {
+public:
+  struct CategoryStats {
+    std::size_t count;
+    std::size_t bytes;
+  };
+
+  [[nodiscard]] static unsigned int create_buffer(std::string_view owner);
+  // glBufferData on `buffer`, which must be bound to `target`; records the new size and usage.
+  static void buffer_data(unsigned int target, unsigned int buffer, std::size_t size, const void* data,
+                          unsigned int usage);
+  // Same without a binding: glNamedBufferData with DSA, otherwise through GL_COPY_WRITE_BUFFER.
+  static void buffer_data(unsigned int buffer, std::size_t size, const void* data, unsigned int usage);
+  static void delete_buffer(unsigned int& buffer);
+
+  [[nodiscard]] static unsigned int create_vertex_array(std::string_view owner);
+  static void delete_vertex_array(unsigned int& vertex_array);
+
+  [[nodiscard]] static unsigned int create_program(std::string_view owner);
+  static void delete_program(unsigned int& program);
+
+  [[nodiscard]] static unsigned int create_texture(std::string_view owner);
+  // Bytes of storage the caller allocated for the texture (all levels).
+  static void set_texture_size(unsigned int texture, std::size_t size);
+  static void delete_texture(unsigned int& texture);
+
+  // Recycled objects change hands (see BufferPool).
+  static void set_owner(GpuResourceType type, unsigned int id, std::string_view owner);
+
+  [[nodiscard]] static const GpuResourceInfo* find(GpuResourceType type, unsigned int id);
+  [[nodiscard]] static CategoryStats get_stats(GpuResourceType type);
+  [[nodiscard]] static std::size_t get_total_bytes();
+
+  // Prints every resource still alive, returns how many there were.
+  static std::size_t report_leaks();
+
+  // Live memory per category and the object list into the current ImGui window.
+  static void render_stats();
+
+  [[nodiscard]] static const char* type_name(GpuResourceType type);
+  [[nodiscard]] static const char* usage_name(unsigned int usage);
+};
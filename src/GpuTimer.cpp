@@ -0,0 +1,116 @@
+﻿#include "GpuTimer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory_resource>
+
+#include <imgui.h>
+
+#include "FrameArena.h"
+#include "Renderer.h"
+
+GpuTimer::GpuTimer() : m_slots{}, m_frame{0} {}
+
+GpuTimer::~GpuTimer() {
+  for (FrameSlot& slot : m_slots) {
+    if (!slot.queries.empty()) {
+      GLCall(glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data()));
+    }
+  }
+}
+
+void GpuTimer::new_frame() {
+  m_frame = (m_frame + 1) % BUFFERED_FRAMES;
+  FrameSlot& slot = m_slots[m_frame];
+  collect(slot);
+  slot.used_queries = 0;
+  slot.entries.clear();
+  m_open.clear();
+}
+
+void GpuTimer::begin(const char* pass) {
+  FrameSlot& slot = m_slots[m_frame];
+  const std::size_t query = next_query(slot);
+  GLCall(glQueryCounter(slot.queries[query], GL_TIMESTAMP));
+
+  m_open.push_back(slot.entries.size());
+  slot.entries.push_back({find_pass(pass), query, query});
+}
+
+void GpuTimer::end() {
+  if (m_open.empty()) return;
+
+  FrameSlot& slot = m_slots[m_frame];
+  const std::size_t query = next_query(slot);
+  GLCall(glQueryCounter(slot.queries[query], GL_TIMESTAMP));
+
+  slot.entries[m_open.back()].end_query = query;
+  m_open.pop_back();
+}
+
+const std::vector<GpuTimer::Pass>& GpuTimer::get_passes() const {
+  return m_passes;
+}
+
+void GpuTimer::render_stats() const {
+  for (const Pass& pass : m_passes) {
+    ImGui::Text("GPU %s: %.3f ms", pass.name, pass.last_ms);
+
+    float history[HISTORY];
+    const std::size_t start = (pass.head + HISTORY - pass.count) % HISTORY;
+    for (std::size_t i = 0; i < pass.count; ++i) {
+      history[i] = pass.history_ms[(start + i) % HISTORY];
+    }
+
+    char id[64];
+    std::snprintf(id, sizeof(id), "##gpu_%s", pass.name);
+    ImGui::PlotLines(id, history, static_cast<int>(pass.count), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+  }
+}
+
+std::size_t GpuTimer::find_pass(const char* name) {
+  for (std::size_t i = 0; i < m_passes.size(); ++i) {
+    if (m_passes[i].name == name || std::strcmp(m_passes[i].name, name) == 0) return i;
+  }
+  m_passes.push_back({name, {}, 0, 0, 0.0f});
+  return m_passes.size() - 1;
+}
+
+std::size_t GpuTimer::next_query(FrameSlot& slot) {
+  if (slot.used_queries == slot.queries.size()) {
+    const std::size_t grow = std::max<std::size_t>(slot.queries.size(), 8);
+    slot.queries.resize(slot.queries.size() + grow);
+    GLCall(glGenQueries(static_cast<GLsizei>(grow), slot.queries.data() + slot.used_queries));
+  }
+  return slot.used_queries++;
+}
+
+void GpuTimer::collect(FrameSlot& slot) {
+  if (slot.entries.empty()) return;
+
+  // Timestamps resolve in submission order, so the last query tells us about the whole frame.
+  GLint available = 0;
+  GLCall(glGetQueryObjectiv(slot.queries[slot.used_queries - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+  if (!available) return; // GPU is more than BUFFERED_FRAMES behind, drop the sample instead of stalling
+
+  std::pmr::vector<double> totals(m_passes.size(), 0.0, &FrameArena::get());
+  std::pmr::vector<bool> seen(m_passes.size(), false, &FrameArena::get());
+  for (const Entry& entry : slot.entries) {
+    if (entry.begin_query == entry.end_query) continue; // never closed
+
+    GLuint64 begin_ns = 0, end_ns = 0;
+    GLCall(glGetQueryObjectui64v(slot.queries[entry.begin_query], GL_QUERY_RESULT, &begin_ns));
+    GLCall(glGetQueryObjectui64v(slot.queries[entry.end_query], GL_QUERY_RESULT, &end_ns));
+    totals[entry.pass] += static_cast<double>(end_ns - begin_ns) / 1'000'000.0;
+    seen[entry.pass] = true;
+  }
+
+  for (std::size_t i = 0; i < m_passes.size(); ++i) {
+    if (!seen[i]) continue;
+    Pass& pass = m_passes[i];
+    pass.last_ms = static_cast<float>(totals[i]);
+    pass.history_ms[pass.head] = pass.last_ms;
+    pass.head = (pass.head + 1) % HISTORY;
+    pass.count = std::min(pass.count + 1, HISTORY);
+  }
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/*
+* GPU pass timer
+*
+* Brackets render passes with GL_TIMESTAMP queries. Every frame writes
+* into its own slot of a small ring and results are only read back
+* once the driver reports them available, so reading never stalls.
+*/
+class GpuTimer {
+public:
+  static constexpr std::size_t BUFFERED_FRAMES = 3;
+  static constexpr std::size_t HISTORY = 240;
+
+  struct Pass {
+    const char* name;
+    std::array<float, HISTORY> history_ms;
+    std::size_t head;
+    std::size_t count;
+    float last_ms;
+  };
+
+  GpuTimer();
+  ~GpuTimer();
+
+  GpuTimer(const GpuTimer&) = delete;
+  GpuTimer& operator=(const GpuTimer&) = delete;
+
+  // Collects finished results of the slot about to be reused. Call once per frame.
+  void new_frame();
+
+  void begin(const char* pass);
+  void end();
+
+  [[nodiscard]] const std::vector<Pass>& get_passes() const;
+
+  // Draws per-pass timings and history graphs into the current ImGui window.
+  void render_stats() const;
+
+private:
+  struct Entry {
+    std::size_t pass;
+    std::size_t begin_query;
+    std::size_t end_query;
+  };
+
+  struct FrameSlot {
+    std::vector<unsigned int> queries;
+    std::size_t used_queries = 0;
+    std::vector<Entry> entries;
+  };
+
+  std::array<FrameSlot, BUFFERED_FRAMES> m_slots;
+  std::size_t m_frame;
+  std::vector<Pass> m_passes;
+  std::vector<std::size_t> m_open;
+
+  std::size_t find_pass(const char* name);
+  std::size_t next_query(FrameSlot& slot);
+  void collect(FrameSlot& slot);
+};
+
+class GpuTimerScope {
+public:
+  GpuTimerScope(GpuTimer& timer, const char* pass) : m_timer{timer} { m_timer.begin(pass); }
+  ~GpuTimerScope() { m_timer.end(); }
+
+  GpuTimerScope(const GpuTimerScope&) = delete;
+  GpuTimerScope& operator=(const GpuTimerScope&) = delete;
+
+private:
+  GpuTimer& m_timer;
+};
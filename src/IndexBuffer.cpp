@@ -1,22 +1,59 @@
 ﻿#include "IndexBuffer.h"
 
+#include "BufferPool.h"
+#include "GLState.h"
+#include "GpuResources.h"
 #include "Renderer.h"
 
-IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count) : m_count{count} {
+IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count, std::string_view owner, unsigned int usage)
+  : m_buffer{BufferPool::get().acquire(count * sizeof(unsigned int), usage, owner)}, m_count{count},
+    m_capacity{BufferPool::get_capacity(count * sizeof(unsigned int))}, m_usage{usage} {
   ASSERT(sizeof(unsigned int) == sizeof(GLuint));
-
-  GLCall(glGenBuffers(1, &m_renderer_id));
-  GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_renderer_id));
-  GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW));
+  if (data && count > 0) set_sub_data(0, data, count);
 }
+
 IndexBuffer::~IndexBuffer() {
-  GLCall(glDeleteBuffers(1, &m_renderer_id));
+  release();
+}
+
+IndexBuffer& IndexBuffer::operator=(IndexBuffer&& other) noexcept {
+  if (this != &other) {
+    release();
+    m_buffer = std::move(other.m_buffer);
+    m_count = other.m_count;
+    m_capacity = other.m_capacity;
+    m_usage = other.m_usage;
+  }
+  return *this;
 }
 
 void IndexBuffer::bind() const {
-  GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_renderer_id));
+  GLState::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, m_buffer.get());
 }
 
 void IndexBuffer::unbind() const {
-  GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+  GLState::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void IndexBuffer::set_data(const unsigned int* data, std::size_t count) {
+  m_capacity = BufferPool::get_capacity(count * sizeof(unsigned int));
+  m_count = static_cast<unsigned int>(count);
+  GpuResources::buffer_data(m_buffer.get(), m_capacity, nullptr, m_usage);
+  if (data && count > 0) set_sub_data(0, data, count);
+}
+
+void IndexBuffer::set_sub_data(std::size_t first, const unsigned int* data, std::size_t count) const {
+  const auto offset = static_cast<GLintptr>(first * sizeof(unsigned int));
+  const auto size = static_cast<GLsizeiptr>(count * sizeof(unsigned int));
+  if (Renderer::has_direct_state_access()) {
+    GLCall(glNamedBufferSubData(m_buffer.get(), offset, size, data));
+    return;
+  }
+  // Not the element binding: that would modify whatever vertex array is bound.
+  GLState::bind_buffer(GL_COPY_WRITE_BUFFER, m_buffer.get());
+  GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data));
+}
+
+void IndexBuffer::release() {
+  BufferPool::get().release(std::move(m_buffer), m_capacity, m_usage);
 }
\ No newline at end of file
@@ -1,16 +1,40 @@
 ﻿#pragma once
 
+#include <cstddef>
+#include <string_view>
+
+#include <GL/glew.h>
+
+#include "GLHandle.h"
+
+// Storage comes from BufferPool. Move-only.
 class IndexBuffer {
 public:
-  IndexBuffer(const unsigned int* data, unsigned int count);
+  IndexBuffer(const unsigned int* data, unsigned int count, std::string_view owner = "IndexBuffer",
+              unsigned int usage = GL_STATIC_DRAW);
   ~IndexBuffer();
 
+  IndexBuffer(IndexBuffer&&) noexcept = default;
+  IndexBuffer& operator=(IndexBuffer&& other) noexcept;
+
   void bind() const;
   void unbind() const;
 
+  // Respecifies the storage for `count` indices; the buffer name stays valid.
+  void set_data(const unsigned int* data, std::size_t count);
+  // Overwrites `count` indices starting at index `first`.
+  void set_sub_data(std::size_t first, const unsigned int* data, std::size_t count) const;
+
+  inline unsigned int get_id() const { return m_buffer.get(); }
   inline unsigned int get_count() const { return m_count; }
+  // In indices.
+  inline std::size_t get_capacity() const { return m_capacity / sizeof(unsigned int); }
   
 private:
-    unsigned int m_renderer_id;
+    BufferHandle m_buffer;
     unsigned int m_count;
+    std::size_t m_capacity;
+    unsigned int m_usage;
+
+    void release();
 };
\ No newline at end of file
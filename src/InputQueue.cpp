@@ -0,0 +1,71 @@
+﻿#include "InputQueue.h"
+
+#include <GLFW/glfw3.h>
+
+static InputQueue* g_input_queue = nullptr;
+
+InputQueue::InputQueue() : m_window{nullptr}, m_raw_motion{false}, m_capturing{false}, m_events{} {
+  g_input_queue = this;
+}
+
+InputQueue::~InputQueue() {
+  if (g_input_queue == this) g_input_queue = nullptr;
+}
+
+void InputQueue::install(GLFWwindow* window) {
+  m_window = window;
+  glfwSetCursorPosCallback(window, cursor_position_callback);
+  glfwSetMouseButtonCallback(window, mouse_button_callback);
+}
+
+bool InputQueue::is_raw_motion_supported() {
+  return glfwRawMouseMotionSupported() == GLFW_TRUE;
+}
+
+void InputQueue::set_raw_motion(const bool enabled) {
+  m_raw_motion = enabled && is_raw_motion_supported();
+  if (m_window && m_capturing) {
+    glfwSetInputMode(m_window, GLFW_RAW_MOUSE_MOTION, m_raw_motion ? GLFW_TRUE : GLFW_FALSE);
+  }
+}
+
+bool InputQueue::is_raw_motion_enabled() const {
+  return m_raw_motion;
+}
+
+void InputQueue::begin_capture() {
+  // GLFW only delivers raw motion while the cursor is disabled.
+  if (!m_window || !m_raw_motion || m_capturing) return;
+  m_capturing = true;
+  glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+  glfwSetInputMode(m_window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+}
+
+void InputQueue::end_capture(const double release_x, const double release_y) {
+  if (!m_window || !m_capturing) return;
+  m_capturing = false;
+  glfwSetInputMode(m_window, GLFW_RAW_MOUSE_MOTION, GLFW_FALSE);
+  glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+  glfwSetCursorPos(m_window, release_x, release_y);
+}
+
+bool InputQueue::is_capturing() const {
+  return m_capturing;
+}
+
+std::int64_t InputQueue::now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+}
+
+void InputQueue::cursor_position_callback(GLFWwindow*, const double x, const double y) {
+  if (!g_input_queue) return;
+  g_input_queue->push({InputEvent::Type::CURSOR, 0, 0, x, y, now_ns()});
+}
+
+void InputQueue::mouse_button_callback(GLFWwindow* window, const int button, const int action, int) {
+  if (!g_input_queue) return;
+  double x, y;
+  glfwGetCursorPos(window, &x, &y);
+  g_input_queue->push({InputEvent::Type::BUTTON, static_cast<std::int8_t>(button), static_cast<std::int8_t>(action), x,
+                       y, now_ns()});
+}
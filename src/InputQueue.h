@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+struct GLFWwindow;
+
+struct InputEvent {
+  enum class Type : std::uint8_t {
+    CURSOR,
+    BUTTON
+  };
+
+  Type type;
+  std::int8_t button; // BUTTON only
+  std::int8_t action; // BUTTON only, GLFW_PRESS / GLFW_RELEASE
+  double x, y; // cursor position in window coordinates when the event arrived
+  std::int64_t time_ns; // steady_clock, stamped inside the GLFW callback
+};
+
+/*
+* Mouse input queue
+*
+* GLFW callbacks stamp every cursor move and button change and push it
+* into a lock-free single-producer ring, so the frame can replay all of
+* them in order instead of sampling one cursor position per frame.
+* Presses and releases shorter than a frame and intermediate motion are
+* no longer lost. With raw mouse motion the cursor is captured during a
+* drag and positions come unaccelerated from the device.
+*/
+class InputQueue {
+public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t CAPACITY = 1 << 12;
+
+  InputQueue();
+  ~InputQueue();
+
+  InputQueue(const InputQueue&) = delete;
+  InputQueue& operator=(const InputQueue&) = delete;
+
+  // Installs the cursor and mouse button callbacks. Call before ImGui installs its own,
+  // ImGui then chains to ours.
+  void install(GLFWwindow* window);
+
+  // Producer side, called from GLFW callbacks.
+  void push(const InputEvent& event) {
+    const std::size_t write = m_write.load(std::memory_order_relaxed);
+    if (write - m_read.load(std::memory_order_acquire) >= CAPACITY) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    m_events[write & (CAPACITY - 1)] = event;
+    m_write.store(write + 1, std::memory_order_release);
+  }
+
+  // Consumer side, hands every queued event to fn in arrival order.
+  template <typename Fn>
+  void drain(Fn&& fn) {
+    const std::size_t read = m_read.load(std::memory_order_relaxed);
+    const std::size_t write = m_write.load(std::memory_order_acquire);
+    for (std::size_t i = read; i != write; ++i) {
+      fn(m_events[i & (CAPACITY - 1)]);
+    }
+    m_read.store(write, std::memory_order_release);
+  }
+
+  [[nodiscard]] std::uint64_t get_dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] static bool is_raw_motion_supported();
+  void set_raw_motion(bool enabled);
+  [[nodiscard]] bool is_raw_motion_enabled() const;
+
+  // Captures the cursor for a drag (only with raw motion). Releasing moves the
+  // visible cursor back to `release_position`.
+  void begin_capture();
+  void end_capture(double release_x, double release_y);
+  [[nodiscard]] bool is_capturing() const;
+
+  static std::int64_t now_ns();
+
+private:
+  GLFWwindow* m_window;
+  bool m_raw_motion;
+  bool m_capturing;
+
+  InputEvent m_events[CAPACITY];
+  alignas(64) std::atomic<std::size_t> m_write{0};
+  alignas(64) std::atomic<std::size_t> m_read{0};
+  std::atomic<std::uint64_t> m_dropped{0};
+
+  static void cursor_position_callback(GLFWwindow* window, double x, double y);
+  static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+};
@@ -0,0 +1,194 @@
+﻿#include "LatencyTracker.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include <imgui.h>
+
+#include "FrameArena.h"
+#include "InputQueue.h"
+#include "Renderer.h"
+
+namespace {
+  constexpr std::uint64_t CALIBRATION_INTERVAL = 120;
+
+  double to_ms(const std::int64_t ns) {
+    return static_cast<double>(ns) / 1'000'000.0;
+  }
+
+  float percentile(const std::span<float> values, const double p) {
+    if (values.empty()) return 0.0f;
+    const auto nth = values.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+  }
+}
+
+LatencyTracker::LatencyTracker() : m_enabled{false}, m_gpu_timing{false}, m_mode{"unknown"}, m_frame{0},
+                                   m_current{}, m_queries{}, m_pending{}, m_gpu_offset_ns{0},
+                                   m_calibrated_frame{0} {}
+
+LatencyTracker::~LatencyTracker() {
+  if (m_queries[0] != 0) {
+    GLCall(glDeleteQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data()));
+  }
+}
+
+void LatencyTracker::set_enabled(const bool enabled) {
+  if (enabled == m_enabled) return;
+  m_enabled = enabled;
+  if (!enabled) {
+    for (Pending& pending : m_pending) pending.active = false;
+    return;
+  }
+
+  m_gpu_timing = is_gpu_timing_supported();
+  if (m_gpu_timing && m_queries[0] == 0) {
+    GLCall(glGenQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data()));
+  }
+  if (m_gpu_timing) calibrate();
+}
+
+bool LatencyTracker::is_enabled() const {
+  return m_enabled;
+}
+
+bool LatencyTracker::is_gpu_timing_supported() {
+  return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+void LatencyTracker::set_mode(std::string mode) {
+  m_mode = std::move(mode);
+}
+
+void LatencyTracker::begin_frame() {
+  ++m_frame;
+  m_current = {m_frame, -1, 0, 0, 0, -1, {}};
+  if (!m_enabled) return;
+
+  for (Pending& pending : m_pending) collect(pending, false);
+  if (m_gpu_timing && m_frame - m_calibrated_frame >= CALIBRATION_INTERVAL) calibrate();
+}
+
+void LatencyTracker::on_input(const std::int64_t event_ns) {
+  if (!m_enabled) return;
+  if (m_current.events == 0 || event_ns < m_current.input_ns) m_current.input_ns = event_ns;
+  if (m_current.events == 0) m_current.consume_ns = InputQueue::now_ns();
+  ++m_current.events;
+}
+
+void LatencyTracker::before_swap() {
+  if (!m_enabled || m_current.events == 0) return;
+
+  Pending& pending = m_pending[m_frame % BUFFERED_FRAMES];
+  collect(pending, true); // the GPU is BUFFERED_FRAMES behind; finish the old sample before reusing the query
+
+  pending.active = true;
+  pending.has_query = m_gpu_timing;
+  if (m_gpu_timing) {
+    GLCall(glQueryCounter(m_queries[m_frame % BUFFERED_FRAMES], GL_TIMESTAMP));
+  }
+}
+
+void LatencyTracker::after_swap() {
+  if (!m_enabled || m_current.events == 0) return;
+
+  m_current.swap_ns = InputQueue::now_ns();
+  m_current.mode = m_mode;
+  Pending& pending = m_pending[m_frame % BUFFERED_FRAMES];
+  if (pending.has_query) {
+    pending.sample = m_current;
+  }
+  else {
+    pending.active = false;
+    finish(m_current);
+  }
+}
+
+void LatencyTracker::clear() {
+  m_samples.clear();
+}
+
+bool LatencyTracker::export_csv(const std::string& filename) const {
+  std::ofstream file(filename);
+  if (!file) return false;
+
+  file << "frame,mode,events,input_ns,consume_ns,swap_ns,gpu_done_ns,input_to_consume_ms,input_to_swap_ms,"
+    "input_to_gpu_ms\n";
+  for (const Sample& sample : m_samples) {
+    file << sample.frame << ',' << sample.mode << ',' << sample.events << ',' << sample.input_ns << ','
+      << sample.consume_ns << ',' << sample.swap_ns << ',' << sample.gpu_done_ns << ','
+      << to_ms(sample.consume_ns - sample.input_ns) << ',' << to_ms(sample.swap_ns - sample.input_ns) << ',';
+    if (sample.gpu_done_ns >= 0) file << to_ms(sample.gpu_done_ns - sample.input_ns);
+    file << '\n';
+  }
+  return static_cast<bool>(file);
+}
+
+void LatencyTracker::render_stats() {
+  bool enabled = m_enabled;
+  if (ImGui::Checkbox("Measure input latency", &enabled)) set_enabled(enabled);
+  if (!m_enabled && m_samples.empty()) return;
+
+  // Prefer GPU completion, fall back to the swap when the query is unavailable.
+  std::pmr::vector<float> latencies{&FrameArena::get()};
+  latencies.reserve(m_samples.size());
+  std::array<float, HISTOGRAM_BINS> histogram{};
+  for (const Sample& sample : m_samples) {
+    const std::int64_t end = sample.gpu_done_ns >= 0 ? sample.gpu_done_ns : sample.swap_ns;
+    const auto ms = static_cast<float>(to_ms(end - sample.input_ns));
+    latencies.push_back(ms);
+    histogram[std::min(static_cast<std::size_t>(std::max(ms, 0.0f)), HISTOGRAM_BINS - 1)] += 1.0f;
+  }
+
+  ImGui::Text("Input latency (%s, %zu samples)", m_gpu_timing ? "to GPU done" : "to swap", latencies.size());
+  const float p50 = percentile(latencies, 0.50);
+  const float p95 = percentile(latencies, 0.95);
+  const float p99 = percentile(latencies, 0.99);
+  ImGui::Text("p50 %.2f ms  p95 %.2f ms  p99 %.2f ms", p50, p95, p99);
+  ImGui::PlotHistogram("##latency", histogram.data(), static_cast<int>(histogram.size()), 0, "0 - 50 ms", 0.0f,
+                       FLT_MAX, ImVec2(0, 60));
+
+  if (ImGui::Button("Dump CSV")) {
+    if (export_csv("latency.csv")) std::cout << "INFO: Saved " << m_samples.size() << " latency samples to latency.csv\n";
+    else std::cerr << "ERROR: Failed to write latency.csv\n";
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear")) clear();
+}
+
+void LatencyTracker::calibrate() {
+  // Bracket the GPU clock read with CPU reads and take the midpoint.
+  const std::int64_t cpu_before = InputQueue::now_ns();
+  GLint64 gpu_ns = 0;
+  GLCall(glGetInteger64v(GL_TIMESTAMP, &gpu_ns));
+  const std::int64_t cpu_after = InputQueue::now_ns();
+  m_gpu_offset_ns = cpu_before + (cpu_after - cpu_before) / 2 - gpu_ns;
+  m_calibrated_frame = m_frame;
+}
+
+void LatencyTracker::collect(Pending& pending, const bool wait) {
+  if (!pending.active || pending.sample.swap_ns == 0) return;
+
+  const unsigned int query = m_queries[&pending - m_pending.data()];
+  if (!wait) {
+    GLint available = 0;
+    GLCall(glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available));
+    if (!available) return;
+  }
+
+  GLuint64 gpu_ns = 0;
+  GLCall(glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu_ns));
+  pending.sample.gpu_done_ns = static_cast<std::int64_t>(gpu_ns) + m_gpu_offset_ns;
+  pending.active = false;
+  finish(std::move(pending.sample));
+}
+
+void LatencyTracker::finish(Sample sample) {
+  if (m_samples.size() == HISTORY) m_samples.pop_front();
+  m_samples.push_back(std::move(sample));
+}
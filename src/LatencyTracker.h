@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+/*
+* Input-to-photon latency tracker
+*
+* The frame that first consumes an input event records the event time,
+* the time the frame returned from SwapBuffers and, where timer queries
+* exist, when the GPU finished the frame (a GL_TIMESTAMP placed right
+* before the swap, mapped onto the CPU clock). Query results are read
+* back a few frames later without stalling. The display scan-out itself
+* is not visible to GL, so GPU completion is the closest photon estimate.
+*/
+class LatencyTracker {
+public:
+  static constexpr std::size_t BUFFERED_FRAMES = 4;
+  static constexpr std::size_t HISTORY = 4096;
+  static constexpr std::size_t HISTOGRAM_BINS = 50; // 1 ms each, the last bin collects everything above
+
+  struct Sample {
+    std::uint64_t frame;
+    std::int64_t input_ns; // oldest event consumed by the frame
+    std::uint32_t events;
+    std::int64_t consume_ns;
+    std::int64_t swap_ns;
+    std::int64_t gpu_done_ns; // -1 when unknown
+    std::string mode;
+  };
+
+  LatencyTracker();
+  ~LatencyTracker();
+
+  LatencyTracker(const LatencyTracker&) = delete;
+  LatencyTracker& operator=(const LatencyTracker&) = delete;
+
+  void set_enabled(bool enabled);
+  [[nodiscard]] bool is_enabled() const;
+  [[nodiscard]] static bool is_gpu_timing_supported();
+
+  // Pacing mode the next samples are tagged with, e.g. "vsync", "cap 60", "unlocked".
+  void set_mode(std::string mode);
+
+  void begin_frame();
+  // The current frame consumed an input event stamped at `event_ns` (steady_clock).
+  void on_input(std::int64_t event_ns);
+  // After the last draw call, before the swap.
+  void before_swap();
+  // Right after the swap returned.
+  void after_swap();
+
+  void clear();
+  bool export_csv(const std::string& filename) const;
+
+  // Histogram and percentiles into the current ImGui window.
+  void render_stats();
+
+private:
+  struct Pending {
+    bool active = false;
+    bool has_query = false;
+    Sample sample;
+  };
+
+  bool m_enabled;
+  bool m_gpu_timing;
+  std::string m_mode;
+  std::uint64_t m_frame;
+
+  Sample m_current;
+  std::array<unsigned int, BUFFERED_FRAMES> m_queries;
+  std::array<Pending, BUFFERED_FRAMES> m_pending;
+
+  std::int64_t m_gpu_offset_ns; // cpu_ns - gpu_ns
+  std::uint64_t m_calibrated_frame;
+
+  std::deque<Sample> m_samples;
+
+  void calibrate();
+  void collect(Pending& pending, bool wait);
+  void finish(Sample sample);
+};
@@ -0,0 +1,188 @@
+﻿#include "LooseQuadtree.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  int quadrant(const glm::vec2& center, const glm::vec2& point) {
+    return (point.x >= center.x ? 1 : 0) | (point.y >= center.y ? 2 : 0);
+  }
+
+  glm::vec2 quadrant_offset(const int quadrant) {
+    return {quadrant & 1 ? 1.0f : -1.0f, quadrant & 2 ? 1.0f : -1.0f};
+  }
+
+  // Written so that NaN fails too.
+  bool in_range(const glm::vec2& center, const float half_extent) {
+    constexpr float limit = LooseQuadtree::MAX_COORDINATE;
+    return std::abs(center.x) <= limit && std::abs(center.y) <= limit && half_extent <= limit;
+  }
+}
+
+bool LooseQuadtree::insert(const std::uint32_t item, const Bounds2D& bounds) {
+  const glm::vec2 center = (bounds.min + bounds.max) * 0.5f;
+  const float half_extent = std::max(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y) * 0.5f;
+  if (!in_range(center, half_extent)) return false;
+
+  if (m_root == NONE) {
+    m_root = create_node(glm::round(center), std::max(INITIAL_HALF_SIZE, half_extent), NONE);
+  }
+  while (!fits(m_root, center, half_extent)) grow_root(center);
+
+  // Deepest node along the center's path whose children would be too small for the item.
+  std::int32_t node = m_root;
+  while (true) {
+    const float child_half_size = m_nodes[node].half_size * 0.5f;
+    if (half_extent > child_half_size || child_half_size < MIN_HALF_SIZE) break;
+    const int q = quadrant(m_nodes[node].center, center);
+    std::int32_t child = m_nodes[node].children[q];
+    if (child == NONE) {
+      child = create_node(m_nodes[node].center + quadrant_offset(q) * child_half_size, child_half_size, node);
+      m_nodes[node].children[q] = child;
+    }
+    node = child;
+  }
+
+  if (item >= m_items.size()) m_items.resize(item + 1);
+  m_items[item] = {bounds, node, static_cast<std::uint32_t>(m_nodes[node].items.size())};
+  m_nodes[node].items.push_back(item);
+  for (std::int32_t n = node; n != NONE; n = m_nodes[n].parent) ++m_nodes[n].subtree_items;
+  ++m_size;
+  return true;
+}
+
+bool LooseQuadtree::update(const std::uint32_t item, const Bounds2D& bounds) {
+  if (item >= m_items.size() || m_items[item].node == NONE) return insert(item, bounds);
+
+  // Still in its node and too big for a child: only the bounds change.
+  const std::int32_t node = m_items[item].node;
+  const glm::vec2 center = (bounds.min + bounds.max) * 0.5f;
+  const float half_extent = std::max(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y) * 0.5f;
+  const float child_half_size = m_nodes[node].half_size * 0.5f;
+  if (fits(node, center, half_extent) && (half_extent > child_half_size || child_half_size < MIN_HALF_SIZE)) {
+    m_items[item].bounds = bounds;
+    return true;
+  }
+  remove(item);
+  return insert(item, bounds);
+}
+
+void LooseQuadtree::remove(const std::uint32_t item) {
+  if (item >= m_items.size() || m_items[item].node == NONE) return;
+  const std::int32_t node = m_items[item].node;
+  std::vector<std::uint32_t>& items = m_nodes[node].items;
+  const std::uint32_t slot = m_items[item].slot;
+  items[slot] = items.back();
+  m_items[items[slot]].slot = slot;
+  items.pop_back();
+  m_items[item].node = NONE;
+  --m_size;
+
+  // Detach the highest ancestor below the root that is now empty, with everything under it.
+  std::int32_t empty = NONE;
+  for (std::int32_t n = node; n != NONE; n = m_nodes[n].parent) {
+    if (--m_nodes[n].subtree_items == 0 && n != m_root) empty = n;
+  }
+  if (empty != NONE) {
+    std::array<std::int32_t, 4>& siblings = m_nodes[m_nodes[empty].parent].children;
+    std::replace(siblings.begin(), siblings.end(), empty, NONE);
+    release_subtree(empty);
+  }
+}
+
+void LooseQuadtree::clear() {
+  m_nodes.clear();
+  m_free_nodes.clear();
+  m_items.clear();
+  m_root = NONE;
+  m_size = 0;
+  m_node_count = 0;
+}
+
+void LooseQuadtree::query(const Bounds2D& view, std::vector<std::uint32_t>& out) const {
+  if (m_root == NONE) return;
+  m_stack.clear();
+  m_stack.emplace_back(m_root, false);
+  while (!m_stack.empty()) {
+    const auto [index, inside] = m_stack.back();
+    m_stack.pop_back();
+    const Node& node = m_nodes[index];
+    if (node.subtree_items == 0) continue;
+
+    bool contained = inside;
+    if (!contained) {
+      const float loose = node.half_size * 2.0f;
+      const Bounds2D bounds{node.center - glm::vec2{loose}, node.center + glm::vec2{loose}};
+      if (!view.overlaps(bounds)) continue;
+      contained = view.contains(bounds);
+    }
+
+    if (contained) {
+      out.insert(out.end(), node.items.begin(), node.items.end());
+    }
+    else {
+      for (const std::uint32_t item : node.items) {
+        if (view.overlaps(m_items[item].bounds)) out.push_back(item);
+      }
+    }
+    for (const std::int32_t child : node.children) {
+      if (child != NONE) m_stack.emplace_back(child, contained);
+    }
+  }
+}
+
+std::size_t LooseQuadtree::size() const {
+  return m_size;
+}
+
+std::size_t LooseQuadtree::get_node_count() const {
+  return m_node_count;
+}
+
+std::int32_t LooseQuadtree::create_node(const glm::vec2& center, const float half_size, const std::int32_t parent) {
+  std::int32_t index;
+  if (!m_free_nodes.empty()) {
+    index = m_free_nodes.back();
+    m_free_nodes.pop_back();
+  }
+  else {
+    index = static_cast<std::int32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+  }
+  Node& node = m_nodes[index];
+  node.center = center;
+  node.half_size = half_size;
+  node.parent = parent;
+  node.children.fill(NONE);
+  node.items.clear();
+  node.subtree_items = 0;
+  ++m_node_count;
+  return index;
+}
+
+void LooseQuadtree::grow_root(const glm::vec2& towards) {
+  // The old root becomes the quadrant of a twice as large root that faces away from `towards`.
+  const glm::vec2 old_center = m_nodes[m_root].center;
+  const float old_half_size = m_nodes[m_root].half_size;
+  const glm::vec2 direction{towards.x >= old_center.x ? 1.0f : -1.0f, towards.y >= old_center.y ? 1.0f : -1.0f};
+  const std::int32_t root = create_node(old_center + direction * old_half_size, old_half_size * 2.0f, NONE);
+  m_nodes[root].children[quadrant(m_nodes[root].center, old_center)] = m_root;
+  m_nodes[root].subtree_items = m_nodes[m_root].subtree_items;
+  m_nodes[m_root].parent = root;
+  m_root = root;
+}
+
+void LooseQuadtree::release_subtree(const std::int32_t node) {
+  for (const std::int32_t child : m_nodes[node].children) {
+    if (child != NONE) release_subtree(child);
+  }
+  m_nodes[node].items.clear();
+  m_free_nodes.push_back(node);
+  --m_node_count;
+}
+
+bool LooseQuadtree::fits(const std::int32_t node, const glm::vec2& center, const float half_extent) const {
+  const Node& n = m_nodes[node];
+  return half_extent <= n.half_size && std::abs(center.x - n.center.x) <= n.half_size &&
+    std::abs(center.y - n.center.y) <= n.half_size;
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct Bounds2D {
+  glm::vec2 min;
+  glm::vec2 max;
+
+  bool operator==(const Bounds2D&) const = default;
+
+  [[nodiscard]] bool overlaps(const Bounds2D& other) const {
+    return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+  }
+
+  [[nodiscard]] bool contains(const Bounds2D& other) const {
+    return min.x <= other.min.x && other.max.x <= max.x && min.y <= other.min.y && other.max.y <= max.y;
+  }
+};
+
+/*
+* Loose quadtree
+*
+* Spatial index over item bounding boxes. An item lives in the deepest
+* node whose half size still covers its half extent, chosen by its
+* center; node bounds are doubled ("loose"), so an item never straddles
+* nodes and moving it only relinks it when it leaves that node. The root
+* grows outwards when something lands outside it. Items are small dense
+* ids (Scene uses slot indices). Insert, update and remove are
+* O(depth); queries visit only nodes whose loose bounds meet the box and
+* take whole subtrees without per-item tests once they are inside it.
+*/
+class LooseQuadtree {
+public:
+  static constexpr float INITIAL_HALF_SIZE = 64.0f;
+  static constexpr float MIN_HALF_SIZE = 1.0f / 64.0f;
+  // Items whose center or half extent is larger than this (or not finite) are refused: the root could not grow
+  // to cover them without its own bounds overflowing.
+  static constexpr float MAX_COORDINATE = 1e30f;
+
+  // False, leaving the item out of the tree, when its bounds are out of range.
+  bool insert(std::uint32_t item, const Bounds2D& bounds);
+  // Inserts items that are not in the tree yet. Out of range bounds remove the item and return false.
+  bool update(std::uint32_t item, const Bounds2D& bounds);
+  void remove(std::uint32_t item);
+  void clear();
+
+  // Appends every item whose bounds overlap `view`, in no particular order.
+  void query(const Bounds2D& view, std::vector<std::uint32_t>& out) const;
+
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] std::size_t get_node_count() const;
+
+private:
+  static constexpr std::int32_t NONE = -1;
+
+  struct Node {
+    glm::vec2 center;
+    float half_size;
+    std::int32_t parent;
+    std::array<std::int32_t, 4> children;
+    std::vector<std::uint32_t> items;
+    std::size_t subtree_items;
+  };
+
+  struct Item {
+    Bounds2D bounds;
+    std::int32_t node = NONE;
+    std::uint32_t slot = 0;
+  };
+
+  std::vector<Node> m_nodes;
+  std::vector<std::int32_t> m_free_nodes;
+  std::vector<Item> m_items;
+  std::int32_t m_root = NONE;
+  std::size_t m_size = 0;
+  std::size_t m_node_count = 0;
+
+  // Traversal scratch: node and whether it lies entirely inside the query box.
+  mutable std::vector<std::pair<std::int32_t, bool>> m_stack;
+
+  std::int32_t create_node(const glm::vec2& center, float half_size, std::int32_t parent);
+  void grow_root(const glm::vec2& towards);
+  void release_subtree(std::int32_t node);
+  [[nodiscard]] bool fits(std::int32_t node, const glm::vec2& center, float half_extent) const;
+};
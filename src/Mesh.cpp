@@ -1 +1,65 @@
 ﻿#include "Mesh.h"
+
+#include <utility>
+
+#include "Renderer.h"
+
+Mesh::Mesh(const void* vertices, unsigned int size, const VertexBufferLayout& layout, unsigned int vertex_count,
+           unsigned int primitive, std::string_view owner)
+  : m_vertex_buffer{std::make_unique<VertexBuffer>(vertices, size, owner)},
+    m_vertex_array{std::make_unique<VertexArray>(owner)}, m_pool{nullptr}, m_primitive{primitive},
+    m_vertex_count{vertex_count} {
+  m_vertex_array->add_buffer(*m_vertex_buffer, layout);
+}
+
+Mesh::Mesh(const void* vertices, unsigned int size, const VertexBufferLayout& layout, const unsigned int* indices,
+           unsigned int index_count, unsigned int primitive, std::string_view owner)
+  : m_vertex_buffer{std::make_unique<VertexBuffer>(vertices, size, owner)},
+    m_index_buffer{std::make_unique<IndexBuffer>(indices, index_count, owner)},
+    m_vertex_array{std::make_unique<VertexArray>(owner)}, m_pool{nullptr}, m_primitive{primitive},
+    m_vertex_count{size / layout.get_stride()} {
+  m_vertex_array->add_buffer(*m_vertex_buffer, layout);
+  m_vertex_array->set_index_buffer(*m_index_buffer);
+}
+
+Mesh::Mesh(GeometryPool& pool, const void* vertices, unsigned int vertex_count, const unsigned int* indices,
+           unsigned int index_count, unsigned int primitive)
+  : m_pool{&pool}, m_geometry{pool.allocate(vertices, vertex_count, indices, index_count)}, m_primitive{primitive},
+    m_vertex_count{vertex_count} {}
+
+Mesh::~Mesh() {
+  if (m_pool) m_pool->release(m_geometry);
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+  : m_vertex_buffer{std::move(other.m_vertex_buffer)}, m_index_buffer{std::move(other.m_index_buffer)},
+    m_vertex_array{std::move(other.m_vertex_array)}, m_pool{std::exchange(other.m_pool, nullptr)},
+    m_geometry{other.m_geometry}, m_primitive{other.m_primitive}, m_vertex_count{other.m_vertex_count} {}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept {
+  if (this != &other) {
+    if (m_pool) m_pool->release(m_geometry);
+    m_vertex_buffer = std::move(other.m_vertex_buffer);
+    m_index_buffer = std::move(other.m_index_buffer);
+    m_vertex_array = std::move(other.m_vertex_array);
+    m_pool = std::exchange(other.m_pool, nullptr);
+    m_geometry = other.m_geometry;
+    m_primitive = other.m_primitive;
+    m_vertex_count = other.m_vertex_count;
+  }
+  return *this;
+}
+
+void Mesh::draw() const {
+  if (m_pool) {
+    m_pool->draw(m_geometry, m_primitive);
+    return;
+  }
+  m_vertex_array->bind();
+  if (m_index_buffer) {
+    GLCall(glDrawElements(m_primitive, static_cast<GLsizei>(m_index_buffer->get_count()), GL_UNSIGNED_INT, nullptr));
+  }
+  else {
+    GLCall(glDrawArrays(m_primitive, 0, static_cast<GLsizei>(m_vertex_count)));
+  }
+}
@@ -1,16 +1,55 @@
 ﻿#pragma once
 
-#include <vector>
+#include <memory>
+#include <string_view>
 
+#include "GeometryPool.h"
 #include "IndexBuffer.h"
+#include "VertexArray.h"
 #include "VertexBuffer.h"
 #include "VertexBufferLayout.h"
 
+/*
+* Mesh
+*
+* Static geometry uploaded once at construction: either its own vertex
+* buffer, optional index buffer and vertex array, or a range of a
+* GeometryPool shared with other meshes of the same layout. draw() is a
+* single vertex array bind plus the draw call; pooled meshes can also
+* be drawn together through GeometryPool::draw(ids, primitive).
+*/
 class Mesh {
 public:
-  Mesh();
+  // Non-indexed, draws `vertex_count` vertices.
+  Mesh(const void* vertices, unsigned int size, const VertexBufferLayout& layout, unsigned int vertex_count,
+       unsigned int primitive = GL_TRIANGLES, std::string_view owner = "Mesh");
+  // Indexed, draws all `index_count` indices.
+  Mesh(const void* vertices, unsigned int size, const VertexBufferLayout& layout, const unsigned int* indices,
+       unsigned int index_count, unsigned int primitive = GL_TRIANGLES, std::string_view owner = "Mesh");
+  // Indexed, stored in `pool` (which must outlive the mesh) using the pool's layout.
+  Mesh(GeometryPool& pool, const void* vertices, unsigned int vertex_count, const unsigned int* indices,
+       unsigned int index_count, unsigned int primitive = GL_TRIANGLES);
+  ~Mesh();
+
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
+
+  Mesh(Mesh&& other) noexcept;
+  Mesh& operator=(Mesh&& other) noexcept;
+
+  void draw() const;
+
+  inline bool is_pooled() const { return m_pool != nullptr; }
+  inline GeometryId get_geometry() const { return m_geometry; }
+  inline unsigned int get_primitive() const { return m_primitive; }
+  inline unsigned int get_vertex_count() const { return m_vertex_count; }
+
 private:
-  VertexBuffer m_vertex_buffer;
-  VertexBufferLayout m_vertex_buffer_layout;
-  IndexBuffer m_index_buffer;
+  std::unique_ptr<VertexBuffer> m_vertex_buffer;
+  std::unique_ptr<IndexBuffer> m_index_buffer;
+  std::unique_ptr<VertexArray> m_vertex_array;
+  GeometryPool* m_pool;
+  GeometryId m_geometry;
+  unsigned int m_primitive;
+  unsigned int m_vertex_count;
 };
@@ -0,0 +1,350 @@
+﻿#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <imgui.h>
+#include <nlohmann/json.hpp>
+
+#include "FrameArena.h"
+
+namespace {
+  struct OpenZone {
+    const char* name;
+    std::uint64_t ticks;
+  };
+
+  struct ZoneHistory {
+    std::array<float, Profiler::ZONE_HISTORY> durations_us{};
+    std::size_t head = 0;
+    std::size_t count = 0;
+    std::uint32_t calls_current = 0;
+    std::uint32_t calls_last = 0;
+  };
+
+  struct ProfilerState {
+    std::mutex registry_mutex;
+    std::vector<std::shared_ptr<ProfileThreadBuffer>> buffers;
+    std::unordered_map<std::uint32_t, std::vector<OpenZone>> open_zones;
+    std::uint32_t next_thread_index = 0;
+
+    std::mutex intern_mutex;
+    std::unordered_set<std::string> interned;
+
+    // The tick rate is measured against steady_clock over everything since the epoch: first when a duration is
+    // needed, then every frame. Until MIN_CALIBRATION has passed each use measures again, so startup never waits.
+    static constexpr std::chrono::milliseconds MIN_CALIBRATION{2};
+    std::uint64_t epoch_ticks;
+    std::chrono::steady_clock::time_point epoch_time;
+    // Written by whichever thread calibrates, read by every zone.
+    std::atomic<double> ns_per_tick{1.0};
+    std::atomic<bool> calibrated{false};
+
+    std::uint64_t frame_start_ns = 0;
+    std::uint64_t last_frame_start_ns = 0;
+    std::uint64_t last_frame_end_ns = 0;
+    std::vector<ProfileZone> current_frame;
+    std::vector<ProfileZone> last_frame;
+    std::vector<std::vector<ProfileZone>> capture; // ring, oldest frame at capture_next once full
+    std::size_t capture_next = 0;
+
+    std::unordered_map<std::string_view, ZoneHistory> history;
+    bool paused = false;
+
+    ProfilerState() {
+      epoch_time = std::chrono::steady_clock::now();
+      epoch_ticks = Profiler::now_ticks();
+#ifndef HERON_HAS_TSC
+      calibrated.store(true, std::memory_order_relaxed); // ticks are steady_clock nanoseconds already
+#endif
+    }
+
+    void calibrate() {
+#ifdef HERON_HAS_TSC
+      const auto elapsed = std::chrono::steady_clock::now() - epoch_time;
+      const auto elapsed_ticks = Profiler::now_ticks() - epoch_ticks;
+      if (elapsed_ticks == 0) return;
+      const double elapsed_ns = std::chrono::duration<double, std::nano>(elapsed).count();
+      ns_per_tick.store(elapsed_ns / static_cast<double>(elapsed_ticks), std::memory_order_relaxed);
+      if (elapsed >= MIN_CALIBRATION) calibrated.store(true, std::memory_order_relaxed);
+#endif
+    }
+
+    [[nodiscard]] double get_ns_per_tick() {
+      if (!calibrated.load(std::memory_order_relaxed)) calibrate();
+      return ns_per_tick.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t to_ns(const std::uint64_t ticks) const {
+      if (ticks <= epoch_ticks) return 0;
+      return static_cast<std::uint64_t>(static_cast<double>(ticks - epoch_ticks) *
+                                        ns_per_tick.load(std::memory_order_relaxed));
+    }
+  };
+
+  ProfilerState& state() {
+    static ProfilerState s;
+    return s;
+  }
+
+  struct ThreadRetirer {
+    std::shared_ptr<ProfileThreadBuffer> buffer;
+
+    ~ThreadRetirer() {
+      if (buffer) buffer->retired.store(true, std::memory_order_release);
+    }
+  };
+
+  double percentile(const std::span<float> values, const double p) {
+    const auto nth = values.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+  }
+
+  ImU32 zone_color(const char* name) {
+    const std::size_t hash = std::hash<std::string_view>{}(name);
+    const auto channel = [&](const int shift) { return 90 + static_cast<int>((hash >> shift) & 0x7F); };
+    return IM_COL32(channel(0), channel(8), channel(16), 255);
+  }
+}
+
+ProfileThreadBuffer* Profiler::register_thread() {
+  ProfilerState& s = state();
+  std::lock_guard lock{s.registry_mutex};
+
+  auto buffer = std::make_shared<ProfileThreadBuffer>(s.next_thread_index++);
+  s.buffers.push_back(buffer);
+
+  thread_local ThreadRetirer retirer;
+  retirer.buffer = buffer;
+  return buffer.get();
+}
+
+double Profiler::ticks_to_us(const std::uint64_t ticks) {
+  return static_cast<double>(ticks) * state().get_ns_per_tick() / 1000.0;
+}
+
+const char* Profiler::intern(const std::string& name) {
+  ProfilerState& s = state();
+  std::lock_guard lock{s.intern_mutex};
+  return s.interned.insert(name).first->c_str();
+}
+
+void Profiler::new_frame() {
+  ProfilerState& s = state();
+  s.calibrate();
+  const std::uint64_t frame_end_ns = s.to_ns(now_ticks());
+
+  {
+    std::lock_guard lock{s.registry_mutex};
+    for (auto it = s.buffers.begin(); it != s.buffers.end();) {
+      ProfileThreadBuffer& buffer = **it;
+      const bool retired = buffer.retired.load(std::memory_order_acquire);
+      auto& stack = s.open_zones[buffer.thread_index];
+
+      buffer.drain([&](const ProfileEvent& event) {
+        if (event.begin) {
+          stack.push_back({event.name, event.ticks});
+          return;
+        }
+        if (stack.empty()) return; // begin was dropped on overflow
+
+        const OpenZone open = stack.back();
+        stack.pop_back();
+
+        const std::uint64_t start_ns = s.to_ns(open.ticks);
+        const std::uint64_t end_ns = s.to_ns(event.ticks);
+        const std::uint64_t duration_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+        s.current_frame.push_back({
+          open.name, start_ns, duration_ns, static_cast<std::uint32_t>(stack.size()), buffer.thread_index
+        });
+
+        ZoneHistory& history = s.history[open.name];
+        history.durations_us[history.head] = static_cast<float>(duration_ns) / 1000.0f;
+        history.head = (history.head + 1) % ZONE_HISTORY;
+        history.count = std::min(history.count + 1, ZONE_HISTORY);
+        ++history.calls_current;
+      });
+
+      if (retired) {
+        s.open_zones.erase(buffer.thread_index);
+        it = s.buffers.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+  }
+
+  for (auto& [name, history] : s.history) {
+    history.calls_last = history.calls_current;
+    history.calls_current = 0;
+  }
+
+  if (!s.paused) {
+    s.last_frame_start_ns = s.frame_start_ns;
+    s.last_frame_end_ns = frame_end_ns;
+    // Overwrite the oldest frame in place so its capacity is reused instead of reallocated.
+    if (s.capture.size() < CAPTURE_FRAMES) s.capture.push_back(s.current_frame);
+    else s.capture[s.capture_next].assign(s.current_frame.begin(), s.current_frame.end());
+    s.capture_next = (s.capture_next + 1) % CAPTURE_FRAMES;
+    s.last_frame.swap(s.current_frame);
+  }
+  s.current_frame.clear();
+  s.frame_start_ns = frame_end_ns;
+}
+
+const std::vector<ProfileZone>& Profiler::get_last_frame() {
+  return state().last_frame;
+}
+
+std::pmr::vector<Profiler::ZoneStats> Profiler::get_zone_stats(std::pmr::memory_resource* resource) {
+  ProfilerState& s = state();
+  std::pmr::vector<ZoneStats> result{resource};
+  result.reserve(s.history.size());
+
+  std::pmr::vector<float> scratch{resource};
+  scratch.reserve(ZONE_HISTORY);
+  for (const auto& [name, history] : s.history) {
+    if (history.count == 0) continue;
+    scratch.assign(history.durations_us.begin(), history.durations_us.begin() + static_cast<std::ptrdiff_t>(history.count));
+
+    ZoneStats stats{};
+    stats.name = name.data();
+    stats.calls_last_frame = history.calls_last;
+    stats.max_us = *std::max_element(scratch.begin(), scratch.end());
+    stats.p50_us = percentile(scratch, 0.50);
+    stats.p95_us = percentile(scratch, 0.95);
+    stats.p99_us = percentile(scratch, 0.99);
+    result.push_back(stats);
+  }
+
+  std::sort(result.begin(), result.end(), [](const ZoneStats& a, const ZoneStats& b) { return a.p50_us > b.p50_us; });
+  return result;
+}
+
+bool Profiler::export_chrome_trace(const std::string& filename) {
+  nlohmann::json events = nlohmann::json::array();
+  const ProfilerState& s = state();
+  for (std::size_t i = 0; i < s.capture.size(); ++i) {
+    for (const ProfileZone& zone : s.capture[(s.capture_next + i) % s.capture.size()]) {
+      events.push_back({
+        {"name", zone.name},
+        {"cat", "heron"},
+        {"ph", "X"},
+        {"ts", static_cast<double>(zone.start_ns) / 1000.0},
+        {"dur", static_cast<double>(zone.duration_ns) / 1000.0},
+        {"pid", 1},
+        {"tid", zone.thread}
+      });
+    }
+  }
+
+  std::ofstream file(filename);
+  if (!file) return false;
+  file << nlohmann::json{{"traceEvents", events}, {"displayTimeUnit", "ms"}}.dump();
+  return static_cast<bool>(file);
+}
+
+void Profiler::render_panel() {
+  ProfilerState& s = state();
+
+  ImGui::Begin("Profiler");
+  ImGui::Checkbox("Pause", &s.paused);
+  ImGui::SameLine();
+  if (ImGui::Button("Export Chrome trace")) {
+    if (export_chrome_trace("trace.json")) {
+      std::cout << "INFO: Saved Chrome trace to trace.json\n";
+    }
+    else {
+      std::cerr << "ERROR: Failed to write trace.json\n";
+    }
+  }
+
+  std::uint64_t dropped = 0;
+  {
+    std::lock_guard lock{s.registry_mutex};
+    for (const auto& buffer : s.buffers) dropped += buffer->get_dropped();
+  }
+  if (dropped > 0) {
+    ImGui::SameLine();
+    ImGui::Text("Dropped events: %llu", static_cast<unsigned long long>(dropped));
+  }
+
+  // Flame graph of the last completed frame, one band per thread.
+  const std::uint64_t frame_start = s.last_frame_start_ns;
+  const std::uint64_t frame_span = std::max<std::uint64_t>(s.last_frame_end_ns - frame_start, 1);
+  ImGui::Text("Frame: %.3f ms", static_cast<double>(frame_span) / 1'000'000.0);
+
+  std::uint32_t max_thread = 0;
+  std::uint32_t max_depth = 0;
+  for (const ProfileZone& zone : s.last_frame) {
+    max_thread = std::max(max_thread, zone.thread);
+    max_depth = std::max(max_depth, zone.depth);
+  }
+
+  const float row_height = ImGui::GetTextLineHeight() + 4.0f;
+  const float band_height = row_height * static_cast<float>(max_depth + 1);
+  const ImVec2 origin = ImGui::GetCursorScreenPos();
+  const float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+  const float height = (band_height + 4.0f) * static_cast<float>(max_thread + 1);
+  ImGui::Dummy(ImVec2(width, height));
+
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+  draw_list->PushClipRect(origin, ImVec2(origin.x + width, origin.y + height), true);
+  for (const ProfileZone& zone : s.last_frame) {
+    const double begin = zone.start_ns > frame_start ? static_cast<double>(zone.start_ns - frame_start) : 0.0;
+    const float x0 = origin.x + static_cast<float>(begin / static_cast<double>(frame_span)) * width;
+    const float x1 = std::max(x0 + 1.0f, x0 + static_cast<float>(static_cast<double>(zone.duration_ns) / static_cast<double>(frame_span)) * width);
+    const float y0 = origin.y + static_cast<float>(zone.thread) * (band_height + 4.0f) + static_cast<float>(zone.depth) * row_height;
+    const ImVec2 min{x0, y0};
+    const ImVec2 max{x1, y0 + row_height - 1.0f};
+
+    draw_list->AddRectFilled(min, max, zone_color(zone.name), 2.0f);
+    if (x1 - x0 > 40.0f) {
+      draw_list->AddText(ImVec2(x0 + 3.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), zone.name);
+    }
+    if (ImGui::IsMouseHoveringRect(min, max)) {
+      ImGui::SetTooltip("%s\n%.3f ms (thread %u)", zone.name, static_cast<double>(zone.duration_ns) / 1'000'000.0, zone.thread);
+    }
+  }
+  draw_list->PopClipRect();
+
+  ImGui::Separator();
+
+  if (ImGui::BeginTable("zones", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Zone");
+    ImGui::TableSetupColumn("Calls");
+    ImGui::TableSetupColumn("p50 (us)");
+    ImGui::TableSetupColumn("p95 (us)");
+    ImGui::TableSetupColumn("p99 (us)");
+    ImGui::TableSetupColumn("max (us)");
+    ImGui::TableHeadersRow();
+
+    for (const ZoneStats& stats : get_zone_stats(&FrameArena::get())) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(stats.name);
+      ImGui::TableNextColumn();
+      ImGui::Text("%u", stats.calls_last_frame);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", stats.p50_us);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", stats.p95_us);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", stats.p99_us);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f", stats.max_us);
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HERON_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HERON_HAS_TSC 1
+#endif
+
+/*
+* In-app profiler
+*
+* Zones (HG_SCOPED_TIMER) push begin/end events into a per-thread
+* lock-free ring buffer. Once per frame the main thread drains every
+* buffer, rebuilds the zone tree and keeps rolling statistics.
+*/
+
+struct ProfileEvent {
+  const char* name;
+  std::uint64_t ticks;
+  bool begin;
+};
+
+struct ProfileZone {
+  const char* name;
+  std::uint64_t start_ns; // relative to the profiler epoch
+  std::uint64_t duration_ns;
+  std::uint32_t depth;
+  std::uint32_t thread;
+};
+
+class ProfileThreadBuffer {
+public:
+  static constexpr std::size_t CAPACITY = 1 << 14;
+
+  explicit ProfileThreadBuffer(std::uint32_t thread_index) : thread_index{thread_index} {}
+
+  // Producer side, only called from the owning thread.
+  void push(const char* name, const std::uint64_t ticks, const bool begin) {
+    const std::size_t write = m_write.load(std::memory_order_relaxed);
+    if (write - m_read.load(std::memory_order_acquire) >= CAPACITY) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    m_events[write & (CAPACITY - 1)] = {name, ticks, begin};
+    m_write.store(write + 1, std::memory_order_release);
+  }
+
+  // Consumer side, only called from the thread that runs Profiler::new_frame.
+  template <typename Fn>
+  void drain(Fn&& fn) {
+    const std::size_t read = m_read.load(std::memory_order_relaxed);
+    const std::size_t write = m_write.load(std::memory_order_acquire);
+    for (std::size_t i = read; i != write; ++i) {
+      fn(m_events[i & (CAPACITY - 1)]);
+    }
+    m_read.store(write, std::memory_order_release);
+  }
+
+  [[nodiscard]] std::uint64_t get_dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+  const std::uint32_t thread_index;
+  std::atomic<bool> retired{false};
+
+private:
+  ProfileEvent m_events[CAPACITY];
+  alignas(64) std::atomic<std::size_t> m_write{0};
+  alignas(64) std::atomic<std::size_t> m_read{0};
+  std::atomic<std::uint64_t> m_dropped{0};
+};
+
+class Profiler {
+public:
+  static constexpr std::size_t ZONE_HISTORY = 256;
+  static constexpr std::size_t CAPTURE_FRAMES = 120;
+
+  struct ZoneStats {
+    const char* name;
+    std::uint32_t calls_last_frame;
+    double p50_us, p95_us, p99_us, max_us;
+  };
+
+  static std::uint64_t now_ticks() {
+#ifdef HERON_HAS_TSC
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+  }
+
+  static void begin_zone(const char* name) {
+    thread_buffer().push(name, now_ticks(), true);
+  }
+
+  static void end_zone(const char* name) {
+    thread_buffer().push(name, now_ticks(), false);
+  }
+
+  static double ticks_to_us(std::uint64_t ticks);
+
+  // Returns a pointer that stays valid for the lifetime of the program.
+  static const char* intern(const std::string& name);
+
+  // Drains every thread buffer and closes the previous frame. Call at the top of the main loop.
+  static void new_frame();
+
+  [[nodiscard]] static const std::vector<ProfileZone>& get_last_frame();
+  [[nodiscard]] static std::pmr::vector<ZoneStats> get_zone_stats(
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+  static bool export_chrome_trace(const std::string& filename);
+  static void render_panel();
+
+private:
+  static ProfileThreadBuffer& thread_buffer() {
+    thread_local ProfileThreadBuffer* buffer = register_thread();
+    return *buffer;
+  }
+
+  static ProfileThreadBuffer* register_thread();
+};
@@ -5,29 +5,97 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <span>
 #include <vector>
 
 #include <glm/glm.hpp>
 
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
+#include "GLState.h"
+#include "GpuResources.h"
+#include "scoped_timer.h"
+#include "util.h"
+#include "vertex_formats.h"
+
+namespace {
+  // Root of the triangle's area: its typical edge length, whatever its shape.
+  float triangle_size(const glm::vec2* corners) {
+    const glm::vec2 ab = corners[1] - corners[0];
+    const glm::vec2 ac = corners[2] - corners[0];
+    return std::sqrt(std::abs(ab.x * ac.y - ab.y * ac.x) * 0.5f);
+  }
 
-Renderer::Renderer() : gridVAO(0), gridVBO(0), triangleVAO(0), triangleVBO(0), circleVAO(0), circleVBO(0),
-                       shaderProgram(0) {}
+  // Returns the bytes uploaded.
+  std::size_t upload_dynamic(VertexBuffer& buffer, const void* data, const std::size_t size) {
+    if (size > buffer.get_capacity()) {
+      // Grow geometrically so a scene that keeps growing does not reallocate every frame.
+      buffer.set_data(nullptr, std::max(size, buffer.get_capacity() * 2), GL_DYNAMIC_DRAW);
+    }
+    if (size > 0) {
+      buffer.set_sub_data(0, data, size);
+    }
+    return size;
+  }
 
-Renderer::~Renderer() {
-  GLCall(glDeleteVertexArrays(1, &gridVAO));
-  GLCall(glDeleteBuffers(1, &gridVBO));
-  GLCall(glDeleteVertexArrays(1, &triangleVAO));
-  GLCall(glDeleteBuffers(1, &triangleVBO));
-  GLCall(glDeleteProgram(shaderProgram));
+  // Coalesces `ranges` and writes them, or all of `data` once they cover more than a quarter of it, where one
+  // big copy is cheaper than many small ones. Returns the bytes uploaded.
+  std::size_t upload_changes(const VertexBuffer& buffer, DirtyRanges& ranges, const void* data,
+                             const std::size_t element_size, const std::size_t element_count) {
+    // Rewriting this many clean bytes is cheaper than another range.
+    constexpr std::size_t MERGE_GAP_BYTES = 256;
+    if (ranges.empty()) return 0;
+    ranges.coalesce(MERGE_GAP_BYTES / element_size);
+    if (ranges.get_total() * 4 > element_count) {
+      buffer.set_sub_data(0, data, element_count * element_size);
+      return element_count * element_size;
+    }
+    return buffer.upload_ranges(ranges, data, element_size);
+  }
+
+  // The texture keeps referring to the buffer name when upload_dynamic() grows its storage.
+  unsigned int create_buffer_texture(const VertexBuffer& buffer, const unsigned int format,
+                                     const std::string_view owner) {
+    const unsigned int texture = GpuResources::create_texture(owner);
+    GLCall(glBindTexture(GL_TEXTURE_BUFFER, texture));
+    GLCall(glTexBuffer(GL_TEXTURE_BUFFER, format, buffer.get_id()));
+    GLCall(glBindTexture(GL_TEXTURE_BUFFER, 0));
+    return texture;
+  }
 }
 
+Renderer::Renderer()
+  : scene_index_count(0), uploaded_scene(nullptr), uploaded_version(0), culled_scene(nullptr), culled_view{},
+    culled(false), scene_quantization_error(0.0f), scene_triangle_size(0.0),
+    weld_epsilon(VertexWelder::DEFAULT_EPSILON),
+    raster_image{0, 0, 0, {}, {}}, raster_scene(nullptr), raster_requested_version(0), raster_requested(false),
+    raster_valid(false), raster_texture_width(0), raster_texture_height(0), lod_blend(0.0f), lod_enabled(true),
+    stats{0, 0} {}
+
+Renderer::~Renderer() = default;
+
 void Renderer::init() {
   load_shaders();
+  VertexBufferLayout shape_layout;
+  shape_layout.push<float>(2);
+  shapePool = std::make_unique<GeometryPool>(shape_layout, "Renderer shapes", 1024, 1024);
   setup_grid();
-  setup_triangle();
   setup_circle();
+  setup_lines();
+  setup_scene();
+  setup_density_raster();
+}
+
+void Renderer::begin_frame() {
+  gpu_timer.new_frame();
+  GLState::new_frame();
+  stats = {0, 0};
 }
 
 void Renderer::load_shaders() {
@@ -62,13 +130,75 @@ void Renderer::load_shaders() {
   GLCall(glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr));
   GLCall(glCompileShader(fragmentShader));
 
-  GLCall(shaderProgram = glCreateProgram());
-  GLCall(glAttachShader(shaderProgram, vertexShader));
-  GLCall(glAttachShader(shaderProgram, fragmentShader));
-  GLCall(glLinkProgram(shaderProgram));
+  shaderProgram.reset(GpuResources::create_program("Renderer shapes"));
+  GLCall(glAttachShader(shaderProgram.get(), vertexShader));
+  GLCall(glAttachShader(shaderProgram.get(), fragmentShader));
+  GLCall(glLinkProgram(shaderProgram.get()));
 
   GLCall(glDeleteShader(vertexShader));
   GLCall(glDeleteShader(fragmentShader));
+
+  const char* sceneVertexShaderSource = R"(
+        #version 330 core
+        layout (location = 0) in vec2 aPos; // snorm16, relative to the chunk
+        uniform samplerBuffer u_chunks; // origin.xy, scale.zw
+        uniform int u_chunk_vertices;
+        uniform mat4 projection;
+        uniform mat4 view;
+        uniform mat4 model;
+        void main() {
+            vec4 chunk = texelFetch(u_chunks, gl_VertexID / u_chunk_vertices);
+            vec2 position = chunk.xy + aPos * chunk.zw;
+            gl_Position = projection * view * model * vec4(position, 0.0, 1.0);
+        }
+    )";
+
+  const char* sceneFragmentShaderSource = R"(
+        #version 330 core
+        
+        uniform samplerBuffer u_colors; // RGBA8 per triangle
+        uniform usamplerBuffer u_triangles; // scene triangle of each culled draw primitive
+        uniform int u_culled;
+        
+        out vec4 FragColor;
+        
+        void main() {
+            int triangle = u_culled != 0 ? int(texelFetch(u_triangles, gl_PrimitiveID).r) : gl_PrimitiveID;
+            FragColor = texelFetch(u_colors, triangle);
+        }
+    )";
+
+  sceneShader = std::make_unique<Shader>("scene", sceneVertexShaderSource, sceneFragmentShaderSource);
+
+  const char* rasterVertexShaderSource = R"(
+        #version 330 core
+        layout (location = 0) in vec2 aPos; // unit square
+        uniform vec4 u_bounds; // min.xy, max.zw
+        uniform mat4 projection;
+        uniform mat4 view;
+        uniform mat4 model;
+        out vec2 v_uv;
+        void main() {
+            v_uv = aPos;
+            gl_Position = projection * view * model * vec4(mix(u_bounds.xy, u_bounds.zw, aPos), 0.0, 1.0);
+        }
+    )";
+
+  const char* rasterFragmentShaderSource = R"(
+        #version 330 core
+        
+        uniform sampler2D u_raster; // premultiplied alpha
+        uniform float u_opacity;
+        
+        in vec2 v_uv;
+        out vec4 FragColor;
+        
+        void main() {
+            FragColor = texture(u_raster, v_uv) * u_opacity;
+        }
+    )";
+
+  rasterShader = std::make_unique<Shader>("density raster", rasterVertexShaderSource, rasterFragmentShaderSource);
 }
 
 void Renderer::setup_grid() {
@@ -86,34 +216,10 @@ void Renderer::setup_grid() {
     grid_lines.push_back(i); // y2
   }
 
-  GLCall(glGenVertexArrays(1, &gridVAO));
-  GLCall(glGenBuffers(1, &gridVBO));
-
-  GLCall(glBindVertexArray(gridVAO));
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, gridVBO));
-  GLCall(glBufferData(GL_ARRAY_BUFFER, grid_lines.size() * sizeof(float), grid_lines.data(), GL_STATIC_DRAW));
-
-  GLCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0));
-  GLCall(glEnableVertexAttribArray(0));
-
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
-  GLCall(glBindVertexArray(0));
-}
-
-void Renderer::setup_triangle() {
-  GLCall(glGenVertexArrays(1, &triangleVAO));
-  GLCall(glGenBuffers(1, &triangleVBO));
-
-  GLCall(glBindVertexArray(triangleVAO));
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, triangleVBO));
-
-  GLCall(glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(float), nullptr, GL_DYNAMIC_DRAW));
-
-  GLCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0));
-  GLCall(glEnableVertexAttribArray(0));
-
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
-  GLCall(glBindVertexArray(0));
+  std::vector<unsigned int> grid_indices(grid_lines.size() / 2);
+  std::iota(grid_indices.begin(), grid_indices.end(), 0u);
+  gridMesh = std::make_unique<Mesh>(*shapePool, grid_lines.data(), static_cast<unsigned int>(grid_lines.size() / 2),
+                                    grid_indices.data(), static_cast<unsigned int>(grid_indices.size()), GL_LINES);
 }
 
 void Renderer::setup_circle() {
@@ -124,89 +230,483 @@ void Renderer::setup_circle() {
     circle_vertices.emplace_back(cos(theta), sin(theta));
   }
 
-  GLCall(glGenVertexArrays(1, &circleVAO));
-  GLCall(glGenBuffers(1, &circleVBO));
+  std::vector<unsigned int> circle_indices(circle_vertices.size());
+  std::iota(circle_indices.begin(), circle_indices.end(), 0u);
+  circleMesh = std::make_unique<Mesh>(*shapePool, circle_vertices.data(),
+                                      static_cast<unsigned int>(circle_vertices.size()), circle_indices.data(),
+                                      static_cast<unsigned int>(circle_indices.size()), GL_TRIANGLE_FAN);
+}
+
+void Renderer::setup_lines() {
+  VertexBufferLayout layout;
+  layout.push<float>(2);
 
-  GLCall(glBindVertexArray(circleVAO));
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, circleVBO));
-  GLCall(glBufferData(GL_ARRAY_BUFFER, circle_vertices.size() * sizeof(glm::vec2), circle_vertices.data(), GL_STATIC_DRAW));
+  // Storage is allocated by the first draw_lines().
+  linesBuffer = std::make_unique<VertexBuffer>(nullptr, 0, "Renderer lines", GL_DYNAMIC_DRAW);
+  linesVertexArray = std::make_unique<VertexArray>("Renderer lines");
+  linesVertexArray->add_buffer(*linesBuffer, layout);
+}
 
-  GLCall(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0));
-  GLCall(glEnableVertexAttribArray(0));
+void Renderer::setup_scene() {
+  static_assert(sizeof(SceneVertex) == 2 * sizeof(std::int16_t));
+  VertexBufferLayout layout;
+  layout.push<glm::i16vec2>(1); // position, normalized
+
+  // Storage is allocated by the first upload_scene().
+  sceneBuffer = std::make_unique<VertexBuffer>(nullptr, 0, "Renderer scene", GL_DYNAMIC_DRAW);
+  sceneIndexBuffer = std::make_unique<IndexBuffer>(nullptr, 0, "Renderer scene", GL_DYNAMIC_DRAW);
+  sceneVertexArray = std::make_unique<VertexArray>("Renderer scene");
+  sceneVertexArray->add_buffer(*sceneBuffer, layout);
+  sceneVertexArray->set_index_buffer(*sceneIndexBuffer);
+
+  sceneChunkBuffer = std::make_unique<VertexBuffer>(nullptr, 0, "Renderer scene chunks", GL_DYNAMIC_DRAW);
+  sceneChunkTexture.reset(create_buffer_texture(*sceneChunkBuffer, GL_RGBA32F, "Renderer scene chunks"));
+  sceneColorBuffer = std::make_unique<VertexBuffer>(nullptr, 0, "Renderer scene colors", GL_DYNAMIC_DRAW);
+  sceneColorTexture.reset(create_buffer_texture(*sceneColorBuffer, GL_RGBA8, "Renderer scene colors"));
+
+  visibleIndexBuffer = std::make_unique<IndexBuffer>(nullptr, 0, "Renderer visible triangles", GL_DYNAMIC_DRAW);
+  visibleVertexArray = std::make_unique<VertexArray>("Renderer visible triangles");
+  visibleVertexArray->add_buffer(*sceneBuffer, layout);
+  visibleVertexArray->set_index_buffer(*visibleIndexBuffer);
+  visibleTriangleBuffer = std::make_unique<VertexBuffer>(nullptr, 0, "Renderer visible triangles", GL_DYNAMIC_DRAW);
+  visibleTriangleTexture.reset(create_buffer_texture(*visibleTriangleBuffer, GL_R32UI, "Renderer visible triangles"));
+}
 
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
-  GLCall(glBindVertexArray(0));
+void Renderer::setup_density_raster() {
+  constexpr glm::vec2 quad_vertices[] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+  constexpr unsigned int quad_indices[] = {0, 1, 2, 3};
+  quadMesh = std::make_unique<Mesh>(*shapePool, quad_vertices, 4, quad_indices, 4, GL_TRIANGLE_FAN);
+
+  // Storage is allocated by the first upload_density_raster().
+  rasterTexture.reset(GpuResources::create_texture("Renderer density raster"));
+  GLCall(glBindTexture(GL_TEXTURE_2D, rasterTexture.get()));
+  GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+  GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+  GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+  GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+  GLCall(glBindTexture(GL_TEXTURE_2D, 0));
 }
 
 void Renderer::draw_grid(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model) const {
-  GLCall(glUseProgram(shaderProgram));
+  HG_SCOPED_TIMER("Renderer::draw_grid");
+  GpuTimerScope gpu_scope{gpu_timer, "Grid"};
+  GLState::use_program(shaderProgram.get());
   GLCall(glUniformMatrix4fv(get_uniform_location("projection"), 1, GL_FALSE, &projection[0][0]));
   GLCall(glUniformMatrix4fv(get_uniform_location("view"), 1, GL_FALSE, &view[0][0]));
   GLCall(glUniformMatrix4fv(get_uniform_location("model"), 1, GL_FALSE, glm::value_ptr(model)));
 
-
-  GLCall(glBindVertexArray(gridVAO));
-  GLCall(glDrawArrays(GL_LINES, 0, (20 - (-20) + 1) * 4));
-  GLCall(glBindVertexArray(0));
+  gridMesh->draw();
+  ++stats.draw_calls;
 }
 
 void Renderer::draw_circle(const glm::vec2& position, const float radius, const glm::mat4& projection,
                            const glm::mat4& view) const {
+  HG_SCOPED_TIMER("Renderer::draw_circle");
+  GpuTimerScope gpu_scope{gpu_timer, "Markers"};
   auto model = glm::mat4(1.0f);
   model = glm::translate(model, glm::vec3(position, 0.0f));
   model = glm::scale(model, glm::vec3(radius, radius, 1.0f));
 
-  GLCall(glUseProgram(shaderProgram));
+  GLState::use_program(shaderProgram.get());
   GLCall(glUniformMatrix4fv(get_uniform_location("projection"), 1, GL_FALSE, glm::value_ptr(projection)));
   GLCall(glUniformMatrix4fv(get_uniform_location("view"), 1, GL_FALSE, glm::value_ptr(view)));
   GLCall(glUniformMatrix4fv(get_uniform_location("model"), 1, GL_FALSE, glm::value_ptr(model)));
 
-  GLCall(glBindVertexArray(circleVAO));
-  GLCall(glDrawArrays(GL_TRIANGLE_FAN, 0, 32));
-  GLCall(glBindVertexArray(0));
+  circleMesh->draw();
+  ++stats.draw_calls;
 }
 
-void Renderer::draw_triangle(const Triangle& triangle, const glm::mat4& projection, const glm::mat4& view,
-                             const glm::mat4& model) const {
-  GLCall(glUseProgram(shaderProgram));
+void Renderer::draw_lines(const std::span<const glm::vec2> endpoints, const glm::mat4& projection,
+                          const glm::mat4& view) const {
+  HG_SCOPED_TIMER("Renderer::draw_lines");
+  if (endpoints.size() < 2) return;
+  GpuTimerScope gpu_scope{gpu_timer, "Lines"};
+  stats.bytes_uploaded += upload_dynamic(*linesBuffer, endpoints.data(), endpoints.size_bytes());
 
-  GLCall(glUniformMatrix4fv(get_uniform_location("projection"), 1, GL_FALSE, &projection[0][0]));
-  GLCall(glUniformMatrix4fv(get_uniform_location("view"), 1, GL_FALSE, &view[0][0]));
+  const auto model = glm::mat4(1.0f);
+  GLState::use_program(shaderProgram.get());
+  GLCall(glUniformMatrix4fv(get_uniform_location("projection"), 1, GL_FALSE, glm::value_ptr(projection)));
+  GLCall(glUniformMatrix4fv(get_uniform_location("view"), 1, GL_FALSE, glm::value_ptr(view)));
   GLCall(glUniformMatrix4fv(get_uniform_location("model"), 1, GL_FALSE, glm::value_ptr(model)));
 
-  if (triangle.is_update_needed()) {
-    update_triangle_buffer(triangle);
+  linesVertexArray->bind();
+  GLCall(glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(endpoints.size() & ~std::size_t{1})));
+  ++stats.draw_calls;
+}
+
+void Renderer::upload_scene(const Scene& scene) const {
+  if (uploaded_scene == &scene && uploaded_version == scene.get_version()) return;
+  culled_scene = nullptr;
+  if (patch_scene(scene)) return;
+  HG_SCOPED_TIMER("Renderer::upload_scene");
+
+  const SlotMap<SceneObject>& objects = scene.get_objects();
+  scene_corners.resize(objects.size() * 3);
+  scene_colors.resize(objects.size());
+  scene_triangle_size = 0.0;
+  for (std::size_t i = 0; i < objects.size(); ++i) {
+    const auto& vertices = objects[i].triangle.get_vertices();
+    std::copy(vertices.begin(), vertices.end(), scene_corners.begin() + static_cast<std::ptrdiff_t>(i * 3));
+    scene_colors[i] = pack_rgba8(objects[i].color);
+    scene_triangle_size += triangle_size(scene_corners.data() + i * 3);
   }
 
-  GLCall(glBindVertexArray(triangleVAO));
-  GLCall(glDrawArrays(GL_TRIANGLES, 0, 3));
-  GLCall(glBindVertexArray(0));
+  welder.weld(scene_corners, weld_epsilon);
+  const std::vector<std::uint32_t>& indices = welder.get_indices();
+  scene_positions.assign(welder.get_positions().begin(), welder.get_positions().end());
+  weld_counts.assign(scene_positions.size(), 0);
+  for (const std::uint32_t index : indices) ++weld_counts[index];
+
+  scene_vertices.resize(scene_positions.size());
+  scene_chunks.resize((scene_positions.size() + SCENE_CHUNK_VERTICES - 1) / SCENE_CHUNK_VERTICES);
+  scene_quantization_error = 0.0f;
+  for (std::size_t chunk = 0; chunk < scene_chunks.size(); ++chunk) quantize_chunk(chunk);
+
+  stats.bytes_uploaded += upload_dynamic(*sceneBuffer, scene_vertices.data(),
+                                         scene_vertices.size() * sizeof(SceneVertex));
+  stats.bytes_uploaded += upload_dynamic(*sceneChunkBuffer, scene_chunks.data(),
+                                         scene_chunks.size() * sizeof(glm::vec4));
+  stats.bytes_uploaded += upload_dynamic(*sceneColorBuffer, scene_colors.data(),
+                                         scene_colors.size() * sizeof(std::uint32_t));
+  if (indices.size() > sceneIndexBuffer->get_capacity()) {
+    sceneIndexBuffer->set_data(nullptr, std::max(indices.size(), sceneIndexBuffer->get_capacity() * 2));
+  }
+  if (!indices.empty()) {
+    sceneIndexBuffer->set_sub_data(0, indices.data(), indices.size());
+  }
+  stats.bytes_uploaded += indices.size() * sizeof(std::uint32_t);
+
+  scene_index_count = indices.size();
+  uploaded_scene = &scene;
+  uploaded_version = scene.get_version();
+}
+
+bool Renderer::patch_scene(const Scene& scene) const {
+  std::span<const ObjectId> changes;
+  if (uploaded_scene != &scene || !scene.get_changes_since(uploaded_version, changes)) return false;
+  HG_SCOPED_TIMER("Renderer::patch_scene");
+
+  const SlotMap<SceneObject>& objects = scene.get_objects();
+  const std::vector<std::uint32_t>& indices = welder.get_indices();
+  moved_corners.clear();
+  dirty_vertices.clear();
+  dirty_chunks.clear();
+  dirty_colors.clear();
+
+  // Repeated entries find nothing left to do: the mirrors are updated on the first one.
+  for (const ObjectId id : changes) {
+    if (!objects.contains(id)) continue;
+    const std::size_t dense = objects.dense_index(id);
+    const SceneObject& object = objects[dense];
+    if (const std::uint32_t color = pack_rgba8(object.color); scene_colors[dense] != color) {
+      scene_colors[dense] = color;
+      dirty_colors.add(dense);
+    }
+    const double old_size = triangle_size(scene_corners.data() + dense * 3);
+    for (std::size_t corner = 0; corner < 3; ++corner) {
+      const std::size_t index = dense * 3 + corner;
+      const glm::vec2& position = object.triangle.get_vertices()[corner];
+      if (scene_corners[index] == position) continue;
+      scene_corners[index] = position;
+      moved_corners.emplace_back(indices[index], static_cast<std::uint32_t>(index));
+    }
+    scene_triangle_size += triangle_size(scene_corners.data() + dense * 3) - old_size;
+  }
+
+  // A welded vertex can only move as a whole: every corner sharing it moved, and to the same place.
+  std::sort(moved_corners.begin(), moved_corners.end());
+  for (std::size_t first = 0; first < moved_corners.size();) {
+    const std::uint32_t vertex = moved_corners[first].first;
+    std::size_t last = first + 1;
+    while (last < moved_corners.size() && moved_corners[last].first == vertex) ++last;
+    const glm::vec2 position = scene_corners[moved_corners[first].second];
+    if (last - first != weld_counts[vertex]) return false;
+    for (std::size_t i = first + 1; i < last; ++i) {
+      if (scene_corners[moved_corners[i].second] != position) return false;
+    }
+    first = last;
+
+    scene_positions[vertex] = position;
+    const std::size_t chunk = vertex / SCENE_CHUNK_VERTICES;
+    const glm::vec4& frame = scene_chunks[chunk];
+    if (std::abs(position.x - frame.x) <= frame.z && std::abs(position.y - frame.y) <= frame.w) {
+      scene_vertices[vertex] = {PositionQuantizer{{frame.x, frame.y}, {frame.z, frame.w}}.quantize(position)};
+      dirty_vertices.add(vertex);
+    }
+    else {
+      // Left its chunk's bounds: requantize the whole chunk against the new ones.
+      dirty_chunks.add(chunk);
+    }
+  }
+
+  dirty_chunks.coalesce();
+  for (const DirtyRanges::Range& range : dirty_chunks.get_ranges()) {
+    for (std::size_t chunk = range.first; chunk < range.first + range.count; ++chunk) {
+      quantize_chunk(chunk);
+      const std::size_t first = chunk * SCENE_CHUNK_VERTICES;
+      dirty_vertices.add(first, std::min(first + SCENE_CHUNK_VERTICES, scene_vertices.size()) - first);
+    }
+  }
+
+  stats.bytes_uploaded += upload_changes(*sceneBuffer, dirty_vertices, scene_vertices.data(), sizeof(SceneVertex),
+                                         scene_vertices.size());
+  stats.bytes_uploaded += upload_changes(*sceneChunkBuffer, dirty_chunks, scene_chunks.data(), sizeof(glm::vec4),
+                                         scene_chunks.size());
+  stats.bytes_uploaded += upload_changes(*sceneColorBuffer, dirty_colors, scene_colors.data(),
+                                         sizeof(std::uint32_t), scene_colors.size());
+  uploaded_version = scene.get_version();
+  return true;
+}
+
+void Renderer::quantize_chunk(const std::size_t chunk) const {
+  const std::size_t first = chunk * SCENE_CHUNK_VERTICES;
+  const std::size_t last = std::min(first + SCENE_CHUNK_VERTICES, scene_positions.size());
+
+  glm::vec2 min{std::numeric_limits<float>::max()};
+  glm::vec2 max{std::numeric_limits<float>::lowest()};
+  for (std::size_t i = first; i < last; ++i) {
+    min = glm::min(min, scene_positions[i]);
+    max = glm::max(max, scene_positions[i]);
+  }
+  const PositionQuantizer quantizer = PositionQuantizer::from_bounds(min, max);
+  scene_chunks[chunk] = {quantizer.origin.x, quantizer.origin.y, quantizer.scale.x, quantizer.scale.y};
+  scene_quantization_error = std::max(scene_quantization_error, quantizer.get_max_error());
+  for (std::size_t i = first; i < last; ++i) scene_vertices[i] = {quantizer.quantize(scene_positions[i])};
+}
+
+void Renderer::draw_scene(const Scene& scene, const glm::mat4& projection, const glm::mat4& view,
+                          const glm::mat4& model) const {
+  HG_SCOPED_TIMER("Renderer::draw_scene");
+  {
+    GpuTimerScope gpu_scope{gpu_timer, "Triangles"};
+    upload_scene(scene);
+    lod_blend = update_density_raster(scene, projection * view * model);
+    if (lod_blend < 1.0f) draw_triangles(scene, projection, view, model);
+  }
+  if (lod_blend > 0.0f) draw_density_raster(projection, view, model);
+}
+
+void Renderer::draw_triangles(const Scene& scene, const glm::mat4& projection, const glm::mat4& view,
+                              const glm::mat4& model) const {
+  if (scene_index_count == 0) return;
+
+  sceneShader->bind();
+  sceneShader->set_uniform_mat4f("projection", projection);
+  sceneShader->set_uniform_mat4f("view", view);
+  sceneShader->set_uniform_mat4f("model", model);
+  sceneShader->set_uniform_1i("u_chunks", 0);
+  sceneShader->set_uniform_1i("u_colors", 1);
+  sceneShader->set_uniform_1i("u_chunk_vertices", static_cast<int>(SCENE_CHUNK_VERTICES));
+  sceneShader->set_uniform_1i("u_triangles", 2);
+
+  const bool use_visible = cull_scene(scene, projection * view * model);
+  if (use_visible && visible_indices.empty()) return;
+  sceneShader->set_uniform_1i("u_culled", use_visible ? 1 : 0);
+
+  GLCall(glActiveTexture(GL_TEXTURE0));
+  GLCall(glBindTexture(GL_TEXTURE_BUFFER, sceneChunkTexture.get()));
+  GLCall(glActiveTexture(GL_TEXTURE1));
+  GLCall(glBindTexture(GL_TEXTURE_BUFFER, sceneColorTexture.get()));
+  if (use_visible) {
+    GLCall(glActiveTexture(GL_TEXTURE2));
+    GLCall(glBindTexture(GL_TEXTURE_BUFFER, visibleTriangleTexture.get()));
+  }
+  GLCall(glActiveTexture(GL_TEXTURE0));
+
+  if (use_visible) {
+    visibleVertexArray->bind();
+    GLCall(glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(visible_indices.size()), GL_UNSIGNED_INT, nullptr));
+  }
+  else {
+    sceneVertexArray->bind();
+    GLCall(glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(scene_index_count), GL_UNSIGNED_INT, nullptr));
+  }
+  ++stats.draw_calls;
+}
+
+bool Renderer::cull_scene(const Scene& scene, const glm::mat4& model_view_projection) const {
+  // The world rectangle behind the NDC square; exact for the editor's orthographic camera.
+  const glm::mat4 inverse = glm::inverse(model_view_projection);
+  Bounds2D view{glm::vec2{std::numeric_limits<float>::max()}, glm::vec2{std::numeric_limits<float>::lowest()}};
+  for (const glm::vec2 corner : {glm::vec2{-1, -1}, glm::vec2{1, -1}, glm::vec2{-1, 1}, glm::vec2{1, 1}}) {
+    const glm::vec4 world = inverse * glm::vec4{corner.x, corner.y, 0.0f, 1.0f};
+    const glm::vec2 position = glm::vec2{world.x, world.y} / world.w;
+    view.min = glm::min(view.min, position);
+    view.max = glm::max(view.max, position);
+  }
+  if (culled_scene == &scene && culled_view == view) return culled;
+  HG_SCOPED_TIMER("Renderer::cull_scene");
+  culled_scene = &scene;
+  culled_view = view;
+
+  scene.query_box(view, visible_triangles);
+  // Past half the scene the list costs more to upload than drawing everything.
+  culled = visible_triangles.size() * 2 <= scene.size();
+  if (!culled) return false;
+
+  const std::vector<std::uint32_t>& indices = welder.get_indices();
+  visible_indices.resize(visible_triangles.size() * 3);
+  for (std::size_t i = 0; i < visible_triangles.size(); ++i) {
+    const std::size_t first = static_cast<std::size_t>(visible_triangles[i]) * 3;
+    std::copy_n(indices.begin() + static_cast<std::ptrdiff_t>(first), 3,
+                visible_indices.begin() + static_cast<std::ptrdiff_t>(i * 3));
+  }
+
+  if (visible_indices.size() > visibleIndexBuffer->get_capacity()) {
+    visibleIndexBuffer->set_data(nullptr, std::max(visible_indices.size(), visibleIndexBuffer->get_capacity() * 2));
+  }
+  if (!visible_indices.empty()) {
+    visibleIndexBuffer->set_sub_data(0, visible_indices.data(), visible_indices.size());
+  }
+  stats.bytes_uploaded += visible_indices.size() * sizeof(std::uint32_t);
+  stats.bytes_uploaded += upload_dynamic(*visibleTriangleBuffer, visible_triangles.data(),
+                                         visible_triangles.size() * sizeof(std::uint32_t));
+  return true;
+}
+
+float Renderer::update_density_raster(const Scene& scene, const glm::mat4& model_view_projection) const {
+  if (!lod_enabled || scene_index_count == 0) return 0.0f;
+  if (raster_scene != &scene) {
+    raster_scene = &scene;
+    raster_requested = false;
+    raster_valid = false;
+  }
+
+  // World units to pixels along x; the editor's camera scales both axes alike.
+  const std::array<int, 4> viewport = GLState::get_viewport();
+  const float pixels_per_unit = glm::length(glm::vec2{model_view_projection[0][0], model_view_projection[0][1]}) *
+                                0.5f * static_cast<float>(viewport[2]);
+  const double triangle_count = static_cast<double>(scene_index_count / 3);
+  const float triangle_pixels = static_cast<float>(scene_triangle_size / triangle_count) * pixels_per_unit;
+  if (triangle_pixels >= LOD_PREPARE_PIXELS) return 0.0f;
+
+  // One build at a time: while the scene keeps changing, each finished build starts the next from a new snapshot.
+  const bool outdated = !raster_requested || raster_requested_version != scene.get_version();
+  if (outdated && !density_raster.is_busy()) {
+    density_raster.submit(scene.make_snapshot(), scene.get_version());
+    raster_requested = true;
+    raster_requested_version = scene.get_version();
+  }
+  if (density_raster.take(raster_image)) upload_density_raster();
+  if (!raster_valid) return 0.0f;
+
+  return std::clamp((LOD_TRIANGLE_PIXELS - triangle_pixels) / (LOD_TRIANGLE_PIXELS - LOD_RASTER_PIXELS), 0.0f, 1.0f);
+}
+
+void Renderer::upload_density_raster() const {
+  HG_SCOPED_TIMER("Renderer::upload_density_raster");
+  raster_valid = !raster_image.texels.empty();
+  if (!raster_valid) return;
+
+  GLCall(glBindTexture(GL_TEXTURE_2D, rasterTexture.get()));
+  if (raster_image.width == raster_texture_width && raster_image.height == raster_texture_height) {
+    GLCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, raster_image.width, raster_image.height, GL_RGBA,
+                           GL_UNSIGNED_BYTE, raster_image.texels.data()));
+  }
+  else {
+    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, raster_image.width, raster_image.height, 0, GL_RGBA,
+                        GL_UNSIGNED_BYTE, raster_image.texels.data()));
+    raster_texture_width = raster_image.width;
+    raster_texture_height = raster_image.height;
+  }
+  GLCall(glGenerateMipmap(GL_TEXTURE_2D));
+  GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+  stats.bytes_uploaded += raster_image.texels.size() * sizeof(std::uint32_t);
 }
 
-void Renderer::update_triangle_buffer(const Triangle& triangle) const {
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, triangleVBO));
-  GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, 6 * sizeof(float), triangle.get_vertices().data()));
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+void Renderer::draw_density_raster(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model) const {
+  HG_SCOPED_TIMER("Renderer::draw_density_raster");
+  GpuTimerScope gpu_scope{gpu_timer, "Density raster"};
+  const Bounds2D& bounds = raster_image.bounds;
+  rasterShader->bind();
+  rasterShader->set_uniform_mat4f("projection", projection);
+  rasterShader->set_uniform_mat4f("view", view);
+  rasterShader->set_uniform_mat4f("model", model);
+  rasterShader->set_uniform_4f("u_bounds", bounds.min.x, bounds.min.y, bounds.max.x, bounds.max.y);
+  rasterShader->set_uniform_1i("u_raster", 0);
+  rasterShader->set_uniform_1f("u_opacity", lod_blend);
+
+  GLCall(glActiveTexture(GL_TEXTURE0));
+  GLCall(glBindTexture(GL_TEXTURE_2D, rasterTexture.get()));
+  GLState::set_blend(true);
+  GLState::blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  quadMesh->draw();
+  GLState::set_blend(false);
+  GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+  ++stats.draw_calls;
 }
 
 void Renderer::set_color(const glm::vec4& color) const {
-  glUseProgram(shaderProgram);
+  GLState::use_program(shaderProgram.get());
   GLCall(const int color_location = get_uniform_location("u_color"));
   glUniform4f(color_location, color[0], color[1], color[2], color[3]);
 }
 
-int Renderer::get_uniform_location(const std::string& name) const {
-  if (uniform_cache.contains(name)) {
-    return uniform_cache[name];
+GpuTimer& Renderer::get_gpu_timer() const {
+  return gpu_timer;
+}
+
+const RenderStats& Renderer::get_stats() const {
+  return stats;
+}
+
+float Renderer::get_quantization_error() const {
+  return scene_quantization_error;
+}
+
+std::size_t Renderer::get_scene_vertex_count() const {
+  return scene_vertices.size();
+}
+
+std::size_t Renderer::get_visible_triangle_count() const {
+  if (lod_blend >= 1.0f) return 0;
+  return culled ? visible_triangles.size() : scene_index_count / 3;
+}
+
+float Renderer::get_lod_blend() const {
+  return lod_blend;
+}
+
+const DensityRaster& Renderer::get_density_raster() const {
+  return density_raster;
+}
+
+void Renderer::set_lod_enabled(const bool enabled) {
+  lod_enabled = enabled;
+}
+
+bool Renderer::is_lod_enabled() const {
+  return lod_enabled;
+}
+
+void Renderer::set_weld_epsilon(const float epsilon) {
+  if (epsilon == weld_epsilon) return;
+  weld_epsilon = epsilon;
+  uploaded_scene = nullptr;
+}
+
+float Renderer::get_weld_epsilon() const {
+  return weld_epsilon;
+}
+
+int Renderer::get_uniform_location(const std::string_view name) const {
+  if (const auto it = uniform_cache.find(name); it != uniform_cache.end()) {
+    return it->second;
   }
-  GLCall(const int location = glGetUniformLocation(shaderProgram, name.c_str()));
+  const std::string key{name};
+  GLCall(const int location = glGetUniformLocation(shaderProgram.get(), key.c_str()));
   if (location == -1) {
     std::cerr << "WARNING: Uniform '" << name << "' not found in shader program!\n";
   }
-  uniform_cache[name] = location;
+  uniform_cache.emplace(key, location);
   return location;
 }
 
+bool Renderer::has_direct_state_access() {
+  static const bool supported = GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access;
+  return supported;
+}
+
 void Renderer::GLClearErrors() {
   while (glGetError() != GL_NO_ERROR);
 }
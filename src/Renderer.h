@@ -2,9 +2,25 @@
 
 #include "platform.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
-#include "Triangle.h"
+#include "DensityRaster.h"
+#include "DirtyRanges.h"
+#include "GLHandle.h"
+#include "GeometryPool.h"
+#include "GpuTimer.h"
+#include "Mesh.h"
+#include "Scene.h"
+#include "Shader.h"
+#include "VertexWelder.h"
+#include "string_map.h"
 
 #include <glm/glm.hpp>
 #include <GL/glew.h>
@@ -24,38 +40,165 @@ x;\
 ASSERT(Renderer::GLCheckError(#x, __FILE__, __LINE__))\
 
 
+// Welded scene vertex: position quantized to snorm16 inside its chunk (see Renderer::upload_scene). Colors are per
+// triangle, in a buffer texture.
+struct SceneVertex {
+  glm::i16vec2 position;
+};
+
+struct RenderStats {
+  unsigned int draw_calls;
+  std::size_t bytes_uploaded;
+};
+
 class Renderer {
 public:
+  // Welded scene vertices sharing one quantization origin and scale.
+  static constexpr std::size_t SCENE_CHUNK_VERTICES = 1024;
+  // Typical projected triangle size, in pixels, below which the density raster fades in over the triangles, and
+  // below which it replaces them.
+  static constexpr float LOD_TRIANGLE_PIXELS = 4.0f;
+  static constexpr float LOD_RASTER_PIXELS = 2.0f;
+  // The raster is built from here on, so it is ready by the time it fades in.
+  static constexpr float LOD_PREPARE_PIXELS = 8.0f;
+
   Renderer();
   ~Renderer();
   
   void init();
+  void begin_frame();
   void draw_grid(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model) const;
   void draw_circle(const glm::vec2& position, float radius, const glm::mat4& projection, const glm::mat4& view) const;
-  void draw_triangle(const Triangle& triangle, const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model) const;
-  
-  void update_triangle_buffer(const Triangle& triangle) const;
+  // Line segments between consecutive pairs of `endpoints`, in world space, in one draw call with the current color.
+  void draw_lines(std::span<const glm::vec2> endpoints, const glm::mat4& projection, const glm::mat4& view) const;
+
+  // All scene objects in one indexed draw call. The buffers are only rebuilt when the scene version changed.
+  // Corners closer than the weld epsilon become one vertex. Positions are quantized per chunk of
+  // SCENE_CHUNK_VERTICES against the chunk's bounds; the vertex shader looks the chunk's origin and scale up in a
+  // buffer texture by gl_VertexID, the fragment shader the triangle color by gl_PrimitiveID.
+  // In-place edits logged by the scene are patched instead: only the changed vertices, chunks and colors go out,
+  // unless a welded vertex has to split or a large part of a buffer changed.
+  void upload_scene(const Scene& scene) const;
+  // Triangles outside the view (found with the scene's quadtree) are skipped by drawing through a list of the
+  // visible ones, rebuilt when the view or the scene changes. Mostly visible scenes are drawn whole.
+  // Zoomed out until the typical triangle (root of the mean area) covers a few pixels, the scene becomes one quad
+  // textured with its DensityRaster, crossfaded over the triangles between LOD_TRIANGLE_PIXELS and
+  // LOD_RASTER_PIXELS. The raster is rebuilt in the background after edits and lags them by one build.
+  void draw_scene(const Scene& scene, const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model) const;
   
   void set_color(const glm::vec4& color) const;
   
-  int get_uniform_location(const std::string& name) const;
+  int get_uniform_location(std::string_view name) const;
+
+  [[nodiscard]] GpuTimer& get_gpu_timer() const;
+  [[nodiscard]] const RenderStats& get_stats() const;
+  // Largest position error introduced by quantizing the uploaded scene, in world units.
+  [[nodiscard]] float get_quantization_error() const;
+  // Unique vertices of the uploaded scene after welding.
+  [[nodiscard]] std::size_t get_scene_vertex_count() const;
+  // Triangles submitted by the last draw_scene().
+  [[nodiscard]] std::size_t get_visible_triangle_count() const;
+  // Opacity of the density raster in the last draw_scene(): 0 triangles only, 1 raster only.
+  [[nodiscard]] float get_lod_blend() const;
+  [[nodiscard]] const DensityRaster& get_density_raster() const;
+
+  void set_lod_enabled(bool enabled);
+  [[nodiscard]] bool is_lod_enabled() const;
+
+  // Takes effect on the next upload.
+  void set_weld_epsilon(float epsilon);
+  [[nodiscard]] float get_weld_epsilon() const;
   
+  // GL 4.5 or ARB_direct_state_access: buffers and vertex arrays are set up without binding.
+  [[nodiscard]] static bool has_direct_state_access();
+
   static void GLClearErrors();
   static bool GLCheckError(const char* function, const char* file, int line);
   
 private:
-  mutable std::unordered_map<std::string, int> uniform_cache;
+  mutable StringMap<int> uniform_cache;
 
-  unsigned int gridVAO, gridVBO;
-  unsigned int triangleVAO, triangleVBO;
-  unsigned int circleVAO, circleVBO;
+  // Grid and marker share one vertex array; declared first so it outlives the meshes.
+  std::unique_ptr<GeometryPool> shapePool;
+  std::unique_ptr<Mesh> gridMesh;
+  std::unique_ptr<Mesh> circleMesh;
+  std::unique_ptr<Mesh> quadMesh;
+  // draw_lines() streams its endpoints through here every call.
+  std::unique_ptr<VertexBuffer> linesBuffer;
+  std::unique_ptr<VertexArray> linesVertexArray;
+  std::unique_ptr<VertexBuffer> sceneBuffer;
+  std::unique_ptr<VertexArray> sceneVertexArray;
+  std::unique_ptr<IndexBuffer> sceneIndexBuffer;
+  std::unique_ptr<VertexBuffer> sceneChunkBuffer;
+  TextureHandle sceneChunkTexture;
+  std::unique_ptr<VertexBuffer> sceneColorBuffer;
+  TextureHandle sceneColorTexture;
+  // Culled draws: indices of the visible triangles and their scene positions, for the color lookup.
+  std::unique_ptr<IndexBuffer> visibleIndexBuffer;
+  std::unique_ptr<VertexArray> visibleVertexArray;
+  std::unique_ptr<VertexBuffer> visibleTriangleBuffer;
+  TextureHandle visibleTriangleTexture;
+  mutable std::size_t scene_index_count;
+  mutable const Scene* uploaded_scene;
+  mutable std::uint64_t uploaded_version;
+  mutable std::vector<glm::vec2> scene_corners;
+  mutable std::vector<glm::vec2> scene_positions;
+  mutable std::vector<std::uint32_t> weld_counts;
+  mutable std::vector<SceneVertex> scene_vertices;
+  mutable std::vector<glm::vec4> scene_chunks;
+  mutable std::vector<std::uint32_t> scene_colors;
+  mutable VertexWelder welder;
+  // Patch scratch: (welded vertex, corner) pairs and what to upload.
+  mutable std::vector<std::pair<std::uint32_t, std::uint32_t>> moved_corners;
+  mutable DirtyRanges dirty_vertices;
+  mutable DirtyRanges dirty_chunks;
+  mutable DirtyRanges dirty_colors;
+  mutable std::vector<std::uint32_t> visible_triangles;
+  mutable std::vector<std::uint32_t> visible_indices;
+  mutable const Scene* culled_scene;
+  mutable Bounds2D culled_view;
+  mutable bool culled;
+  mutable float scene_quantization_error;
+  // Sum over triangles of the root of their area, for the typical projected size.
+  mutable double scene_triangle_size;
+  float weld_epsilon;
+  // Zoomed-out LOD: rasterTexture holds raster_image once raster_valid.
+  TextureHandle rasterTexture;
+  mutable DensityRaster density_raster;
+  mutable DensityRaster::Image raster_image;
+  mutable const Scene* raster_scene;
+  mutable std::uint64_t raster_requested_version;
+  mutable bool raster_requested;
+  mutable bool raster_valid;
+  mutable int raster_texture_width;
+  mutable int raster_texture_height;
+  mutable float lod_blend;
+  bool lod_enabled;
   
-  unsigned int shaderProgram;
+  ProgramHandle shaderProgram;
+  std::unique_ptr<Shader> sceneShader;
+  std::unique_ptr<Shader> rasterShader;
   
   mutable glm::vec4 last_color;
+
+  mutable GpuTimer gpu_timer;
+  mutable RenderStats stats;
   
   void setup_grid();
-  void setup_triangle();
   void setup_circle();
+  void setup_lines();
+  void setup_scene();
+  void setup_density_raster();
+  // False when the scene has to be rebuilt instead.
+  bool patch_scene(const Scene& scene) const;
+  void quantize_chunk(std::size_t chunk) const;
+  // True when draw_scene() should go through the visible list.
+  bool cull_scene(const Scene& scene, const glm::mat4& model_view_projection) const;
+  void draw_triangles(const Scene& scene, const glm::mat4& projection, const glm::mat4& view,
+                      const glm::mat4& model) const;
+  // Requests and picks up rasters as needed; returns the raster's opacity for this view.
+  float update_density_raster(const Scene& scene, const glm::mat4& model_view_projection) const;
+  void upload_density_raster() const;
+  void draw_density_raster(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model) const;
   void load_shaders();
 };
@@ -0,0 +1,246 @@
+﻿#include "Scene.h"
+
+#include <algorithm>
+
+#include "geometry.h"
+
+namespace {
+  Bounds2D triangle_bounds(const Triangle& triangle) {
+    const auto& vertices = triangle.get_vertices();
+    return {glm::min(glm::min(vertices[0], vertices[1]), vertices[2]),
+            glm::max(glm::max(vertices[0], vertices[1]), vertices[2])};
+  }
+
+  bool is_ignored(const std::span<const ObjectId> ignored, const ObjectId id) {
+    return std::find(ignored.begin(), ignored.end(), id) != ignored.end();
+  }
+}
+
+ObjectId Scene::add_triangle(const std::array<glm::vec2, 3>& vertices, const glm::vec4& color) {
+  ++m_version;
+  restart_changes();
+  const ObjectId id = m_objects.insert({Triangle{vertices}, color});
+  index_object(id);
+  return id;
+}
+
+bool Scene::remove(const ObjectId id) {
+  if (!m_objects.erase(id)) return false;
+  m_bounds_tree.remove(id.index);
+  for (std::uint32_t corner = 0; corner < 3; ++corner) m_vertex_hash.remove(id.index * 3 + corner);
+  ++m_version;
+  restart_changes();
+  return true;
+}
+
+void Scene::clear() {
+  m_objects.clear();
+  m_bounds_tree.clear();
+  m_vertex_hash.clear();
+  ++m_version;
+  restart_changes();
+}
+
+void Scene::reserve(const std::size_t count) {
+  m_objects.reserve(count);
+}
+
+bool Scene::move_vertex(const ObjectId id, const int index, const glm::vec2& position) {
+  SceneObject* object = m_objects.get(id);
+  if (!object || index < 0 || index >= 3 || object->triangle.get_vertices()[index] == position) return false;
+
+  object->triangle.move_vertex(index, position);
+  m_bounds_tree.update(id.index, triangle_bounds(object->triangle));
+  m_vertex_hash.update(id.index * 3 + static_cast<std::uint32_t>(index), position);
+  record_change(id);
+  return true;
+}
+
+bool Scene::set_color(const ObjectId id, const glm::vec4& color) {
+  SceneObject* object = m_objects.get(id);
+  if (!object || object->color == color) return false;
+
+  object->color = color;
+  record_change(id);
+  return true;
+}
+
+const SceneObject* Scene::get(const ObjectId id) const {
+  return m_objects.get(id);
+}
+
+bool Scene::contains(const ObjectId id) const {
+  return m_objects.contains(id);
+}
+
+VertexRef Scene::pick_vertex(const glm::vec2& position) const {
+  return find_nearest_vertex(position, pick_radius);
+}
+
+ObjectId Scene::pick_object(const glm::vec2& position) const {
+  const std::uint32_t dense = sync_bvh().find_topmost(position);
+  return dense == TriangleBvh::NONE ? ObjectId{} : m_objects.id_at(dense);
+}
+
+void Scene::query_triangles(const Bounds2D& box, std::vector<std::uint32_t>& out) const {
+  sync_bvh().query_box(box, out);
+}
+
+void Scene::classify_points(const std::span<const glm::vec2> points, const std::span<std::uint32_t> out) const {
+  sync_bvh().classify(points, out);
+}
+
+void Scene::query_box(const Bounds2D& box, std::vector<std::uint32_t>& out) const {
+  out.clear();
+  m_bounds_tree.query(box, out);
+  for (std::uint32_t& item : out) item = static_cast<std::uint32_t>(m_objects.dense_index(item));
+  std::sort(out.begin(), out.end());
+}
+
+void Scene::find_coincident(const VertexRef& vertex, const float epsilon, std::vector<VertexRef>& out) const {
+  const SceneObject* object = m_objects.get(vertex.object);
+  if (!object || vertex.vertex == -1) return;
+  const glm::vec2 position = object->triangle.get_vertices()[vertex.vertex];
+  m_vertex_hash.for_each_near(position, epsilon, [&](const std::uint32_t item, float) {
+    out.push_back({m_objects.id_at(m_objects.dense_index(item / 3)), static_cast<int>(item % 3)});
+  });
+}
+
+VertexRef Scene::find_nearest_vertex(const glm::vec2& position, const float radius,
+                                     const std::span<const ObjectId> ignored) const {
+  VertexRef nearest;
+  std::size_t nearest_dense = 0;
+  float nearest_distance = 0.0f;
+  m_vertex_hash.for_each_near(position, radius, [&](const std::uint32_t item, const float distance) {
+    const std::size_t dense = m_objects.dense_index(item / 3);
+    const int corner = static_cast<int>(item % 3);
+    // Closest first, then topmost, then the lowest corner.
+    if (nearest.is_valid() &&
+        (distance > nearest_distance ||
+         (distance == nearest_distance &&
+          (dense < nearest_dense || (dense == nearest_dense && corner > nearest.vertex))))) {
+      return;
+    }
+    const ObjectId id = m_objects.id_at(dense);
+    if (is_ignored(ignored, id)) return;
+    nearest = {id, corner};
+    nearest_dense = dense;
+    nearest_distance = distance;
+  });
+  return nearest;
+}
+
+bool Scene::find_nearest_edge_point(const glm::vec2& position, const float radius,
+                                    const std::span<const ObjectId> ignored, glm::vec2& out) const {
+  m_query_items.clear();
+  m_bounds_tree.query({position - glm::vec2{radius}, position + glm::vec2{radius}}, m_query_items);
+  bool found = false;
+  float nearest_distance = radius * radius;
+  for (const std::uint32_t slot : m_query_items) {
+    const std::size_t dense = m_objects.dense_index(slot);
+    if (is_ignored(ignored, m_objects.id_at(dense))) continue;
+    const auto& vertices = m_objects[dense].triangle.get_vertices();
+    for (std::size_t edge = 0; edge < 3; ++edge) {
+      const glm::vec2 point = closest_point_on_segment(vertices[edge], vertices[(edge + 1) % 3], position);
+      if (const float distance = distance_squared(point, position); distance <= nearest_distance) {
+        out = point;
+        nearest_distance = distance;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+std::size_t Scene::size() const {
+  return m_objects.size();
+}
+
+bool Scene::empty() const {
+  return m_objects.empty();
+}
+
+const SlotMap<SceneObject>& Scene::get_objects() const {
+  return m_objects;
+}
+
+std::uint64_t Scene::get_version() const {
+  return m_version;
+}
+
+bool Scene::get_changes_since(const std::uint64_t version, std::span<const ObjectId>& changes) const {
+  if (version < m_changes_base || version > m_version) return false;
+  changes = std::span<const ObjectId>{m_changes}.subspan(static_cast<std::size_t>(version - m_changes_base));
+  return true;
+}
+
+std::shared_ptr<const SceneSnapshot> Scene::make_snapshot() const {
+  auto snapshot = std::make_shared<SceneSnapshot>();
+  snapshot->vertices.reserve(m_objects.size() * 3);
+  snapshot->colors.reserve(m_objects.size());
+  for (const SceneObject& object : m_objects) {
+    const auto& vertices = object.triangle.get_vertices();
+    snapshot->vertices.insert(snapshot->vertices.end(), vertices.begin(), vertices.end());
+    snapshot->colors.push_back(object.color);
+  }
+  return snapshot;
+}
+
+void Scene::load_snapshot(const SceneSnapshot& snapshot) {
+  m_objects.clear();
+  m_bounds_tree.clear();
+  m_vertex_hash.clear();
+  m_objects.reserve(snapshot.colors.size());
+  for (std::size_t i = 0; i < snapshot.colors.size(); ++i) {
+    const ObjectId id = m_objects.insert(
+      {Triangle{{snapshot.vertices[i * 3], snapshot.vertices[i * 3 + 1], snapshot.vertices[i * 3 + 2]}},
+       snapshot.colors[i]});
+    index_object(id);
+  }
+  ++m_version;
+  restart_changes();
+}
+
+void Scene::index_object(const ObjectId id) {
+  const Triangle& triangle = m_objects.get(id)->triangle;
+  m_bounds_tree.insert(id.index, triangle_bounds(triangle));
+  for (std::uint32_t corner = 0; corner < 3; ++corner) {
+    m_vertex_hash.insert(id.index * 3 + corner, triangle.get_vertices()[corner]);
+  }
+}
+
+const TriangleBvh& Scene::sync_bvh() const {
+  if (m_bvh_valid && m_bvh_version == m_version) return m_bvh;
+  std::span<const ObjectId> changes;
+  if (m_bvh_valid && get_changes_since(m_bvh_version, changes)) {
+    for (const ObjectId id : changes) {
+      if (!m_objects.contains(id)) continue;
+      m_bvh.update(static_cast<std::uint32_t>(m_objects.dense_index(id)), m_objects.get(id)->triangle.get_vertices());
+    }
+  }
+  else {
+    m_bvh_corners.resize(m_objects.size() * 3);
+    for (std::size_t i = 0; i < m_objects.size(); ++i) {
+      const auto& vertices = m_objects[i].triangle.get_vertices();
+      std::copy(vertices.begin(), vertices.end(), m_bvh_corners.begin() + static_cast<std::ptrdiff_t>(i * 3));
+    }
+    m_bvh.build(m_bvh_corners);
+  }
+  m_bvh_valid = true;
+  m_bvh_version = m_version;
+  return m_bvh;
+}
+
+void Scene::record_change(const ObjectId id) {
+  ++m_version;
+  if (m_changes.size() >= MAX_CHANGE_LOG) {
+    restart_changes();
+    return;
+  }
+  m_changes.push_back(id);
+}
+
+void Scene::restart_changes() {
+  m_changes.clear();
+  m_changes_base = m_version;
+}
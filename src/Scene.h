@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "LooseQuadtree.h"
+#include "SceneSnapshot.h"
+#include "SlotMap.h"
+#include "Triangle.h"
+#include "TriangleBvh.h"
+#include "VertexHash.h"
+
+using ObjectId = SlotId;
+
+struct SceneObject {
+  Triangle triangle;
+  glm::vec4 color;
+};
+
+struct VertexRef {
+  ObjectId object;
+  int vertex = -1;
+
+  [[nodiscard]] bool is_valid() const { return object.is_valid() && vertex != -1; }
+};
+
+/*
+* Scene
+*
+* Every triangle in the editor with its own color. Objects are kept
+* contiguously in a slot map, so drawing and saving walk one array while
+* the editor holds on to stable ObjectIds. Any change bumps the version,
+* which the renderer uses to decide when the GPU copy is stale. In-place
+* edits (moved vertices, new colors) are also logged, one entry per
+* version, so a consumer can patch just those objects; adding, removing
+* or reloading objects starts a new log. A loose quadtree over the
+* triangle bounds and a spatial hash over the corners, both kept current
+* by every edit, answer box, edge and nearest-vertex queries without
+* walking all objects. Exact point and triangle-box queries go through a
+* BVH over the triangles in draw order, synced lazily by the first query
+* after an edit: refitted after in-place edits, rebuilt otherwise.
+*/
+class Scene {
+public:
+  static constexpr glm::vec4 DEFAULT_COLOR{0.0f, 0.16f, 1.0f, 1.0f};
+  // Longer runs of in-place edits start a new log; consumers then rebuild.
+  static constexpr std::size_t MAX_CHANGE_LOG = 64 * 1024;
+
+  ObjectId add_triangle(const std::array<glm::vec2, 3>& vertices, const glm::vec4& color = DEFAULT_COLOR);
+  bool remove(ObjectId id);
+  void clear();
+  void reserve(std::size_t count);
+
+  // Returns false for stale ids or when nothing changed.
+  bool move_vertex(ObjectId id, int index, const glm::vec2& position);
+  bool set_color(ObjectId id, const glm::vec4& color);
+
+  [[nodiscard]] const SceneObject* get(ObjectId id) const;
+  [[nodiscard]] bool contains(ObjectId id) const;
+
+  // Nearest corner within the pick radius; of coincident corners the topmost (last drawn) wins.
+  [[nodiscard]] VertexRef pick_vertex(const glm::vec2& position) const;
+  // Topmost (last drawn) hit wins.
+  [[nodiscard]] ObjectId pick_object(const glm::vec2& position) const;
+  // Dense indices (draw order) of objects whose triangle overlaps the box, ascending. Replaces `out`.
+  void query_triangles(const Bounds2D& box, std::vector<std::uint32_t>& out) const;
+  // Dense index of the topmost object containing each point, or TriangleBvh::NONE. `out` holds one per point.
+  void classify_points(std::span<const glm::vec2> points, std::span<std::uint32_t> out) const;
+  // Dense indices (draw order) of objects whose bounds overlap the box, ascending. Replaces `out`.
+  void query_box(const Bounds2D& box, std::vector<std::uint32_t>& out) const;
+  // Appends every corner within `epsilon` of `vertex`, `vertex` itself included.
+  void find_coincident(const VertexRef& vertex, float epsilon, std::vector<VertexRef>& out) const;
+  // Like pick_vertex(), but within `radius` and skipping the corners of the `ignored` objects.
+  [[nodiscard]] VertexRef find_nearest_vertex(const glm::vec2& position, float radius,
+                                              std::span<const ObjectId> ignored = {}) const;
+  // Closest point within `radius` on an edge of an object not in `ignored`. False when there is none.
+  bool find_nearest_edge_point(const glm::vec2& position, float radius, std::span<const ObjectId> ignored,
+                               glm::vec2& out) const;
+
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] bool empty() const;
+  [[nodiscard]] const SlotMap<SceneObject>& get_objects() const;
+  [[nodiscard]] std::uint64_t get_version() const;
+  // Objects edited in place after `version`, possibly repeated. False when the log does not reach back that far.
+  [[nodiscard]] bool get_changes_since(std::uint64_t version, std::span<const ObjectId>& changes) const;
+
+  // A full O(n) copy on the calling thread, not shared storage: about 30 ms per million triangles once the
+  // allocator has the memory at hand, several times that on the first call.
+  [[nodiscard]] std::shared_ptr<const SceneSnapshot> make_snapshot() const;
+  void load_snapshot(const SceneSnapshot& snapshot);
+
+private:
+  SlotMap<SceneObject> m_objects;
+  std::uint64_t m_version = 0;
+  LooseQuadtree m_bounds_tree;
+  // Items are slot index * 3 + corner.
+  VertexHash m_vertex_hash;
+  std::vector<ObjectId> m_changes;
+  std::uint64_t m_changes_base = 0;
+  // find_nearest_edge_point() scratch.
+  mutable std::vector<std::uint32_t> m_query_items;
+  // Triangles by dense index, current as of m_bvh_version.
+  mutable TriangleBvh m_bvh;
+  mutable std::uint64_t m_bvh_version = 0;
+  mutable bool m_bvh_valid = false;
+  mutable std::vector<glm::vec2> m_bvh_corners;
+
+  void index_object(ObjectId id);
+  const TriangleBvh& sync_bvh() const;
+  void record_change(ObjectId id);
+  void restart_changes();
+};
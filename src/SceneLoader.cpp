@@ -0,0 +1,282 @@
+﻿#include "SceneLoader.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <istream>
+#include <limits>
+#include <streambuf>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "Scene.h"
+
+namespace {
+  // Reads the file in large chunks and reports how far the parser got.
+  class ProgressStreambuf : public std::streambuf {
+  public:
+    ProgressStreambuf(std::FILE* file, const std::uintmax_t size, std::atomic<float>* progress,
+                      const std::atomic<bool>* cancel) : m_file{file}, m_size{size}, m_read{0},
+                                                         m_progress{progress}, m_cancel{cancel} {}
+
+  protected:
+    int_type underflow() override {
+      if (m_cancel && m_cancel->load(std::memory_order_relaxed)) return traits_type::eof();
+
+      const std::size_t count = std::fread(m_buffer.data(), 1, m_buffer.size(), m_file);
+      if (count == 0) return traits_type::eof();
+
+      m_read += count;
+      if (m_progress && m_size > 0) {
+        m_progress->store(static_cast<float>(static_cast<double>(m_read) / static_cast<double>(m_size)),
+                          std::memory_order_relaxed);
+      }
+
+      setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + count);
+      return traits_type::to_int_type(*gptr());
+    }
+
+  private:
+    std::FILE* m_file;
+    std::uintmax_t m_size;
+    std::uintmax_t m_read;
+    std::atomic<float>* m_progress;
+    const std::atomic<bool>* m_cancel;
+    std::array<char, 1 << 16> m_buffer{};
+  };
+
+  // Walks the scene schema as events arrive and writes values straight into the snapshot:
+  // { "count": N, "triangles": [{ "vertices": [[x, y], ...], "color": [r, g, b, a] }, ...] }
+  // The single-triangle files written before multi-object scenes ({ "triangle": { ... } }) load as one object.
+  class SceneSaxHandler : public nlohmann::json_sax<nlohmann::json> {
+  public:
+    SceneSaxHandler(SceneSnapshot& snapshot, const std::uintmax_t file_size, const std::atomic<bool>* cancel)
+      : m_snapshot{snapshot}, m_file_size{file_size}, m_cancel{cancel} {
+      m_snapshot.vertices.clear();
+      m_snapshot.colors.clear();
+    }
+
+    bool null() override { return next_element(); }
+    bool boolean(bool) override { return next_element(); }
+    bool number_integer(number_integer_t value) override { return number(static_cast<double>(value)); }
+    bool number_unsigned(number_unsigned_t value) override {
+      if (m_stack.size() == 1 && m_key == "count") reserve(value);
+      return number(static_cast<double>(value));
+    }
+    bool number_float(number_float_t value, const string_t&) override { return number(static_cast<double>(value)); }
+    bool string(string_t&) override { return next_element(); }
+    bool binary(binary_t&) override { return next_element(); }
+
+    bool start_object(std::size_t) override {
+      const bool triangle = m_triangle_depth == 0 && starts_triangle();
+      m_stack.push_back({false, take_key(), 0});
+      if (triangle) begin_triangle();
+      return !cancelled();
+    }
+
+    bool key(string_t& value) override {
+      m_key = value;
+      return true;
+    }
+
+    bool end_object() override {
+      if (m_triangle_depth != 0 && m_stack.size() == m_triangle_depth + 1 && !end_triangle()) return false;
+      m_stack.pop_back();
+      return next_element();
+    }
+
+    bool start_array(std::size_t) override {
+      if (m_stack.size() == 1 && m_key == "triangles") m_found = true;
+      m_stack.push_back({true, take_key(), 0});
+      return !cancelled();
+    }
+
+    bool end_array() override {
+      m_stack.pop_back();
+      return next_element();
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override {
+      m_error = cancelled() ? "cancelled" : ex.what();
+      return false;
+    }
+
+    [[nodiscard]] const std::string& get_error() const { return m_error; }
+    [[nodiscard]] bool cancelled() const { return m_cancel && m_cancel->load(std::memory_order_relaxed); }
+    [[nodiscard]] bool found_triangles() const { return m_found; }
+
+  private:
+    struct Frame {
+      bool array;
+      std::string key;
+      std::size_t index;
+    };
+
+    SceneSnapshot& m_snapshot;
+    std::uintmax_t m_file_size;
+    const std::atomic<bool>* m_cancel;
+    std::vector<Frame> m_stack;
+    std::string m_key;
+    std::string m_error;
+    bool m_found = false;
+
+    // Stack index of the triangle object being parsed, 0 outside of one.
+    std::size_t m_triangle_depth = 0;
+    int m_vertex_components = 0;
+
+    std::string take_key() {
+      if (m_stack.empty() || m_stack.back().array) return {};
+      return std::move(m_key);
+    }
+
+    bool next_element() {
+      if (!m_stack.empty() && m_stack.back().array) ++m_stack.back().index;
+      return true;
+    }
+
+    bool starts_triangle() const {
+      if (m_stack.size() == 1) return m_key == "triangle";
+      return m_stack.size() == 2 && m_stack[1].array && m_stack[1].key == "triangles";
+    }
+
+    void reserve(const std::uintmax_t count) {
+      // A triangle takes well over 16 bytes of JSON, so a bogus count cannot make us reserve gigabytes.
+      const auto capped = static_cast<std::size_t>(std::min<std::uintmax_t>(count, m_file_size / 16));
+      m_snapshot.vertices.reserve(capped * 3);
+      m_snapshot.colors.reserve(capped);
+    }
+
+    void begin_triangle() {
+      m_found = true;
+      m_triangle_depth = m_stack.size() - 1;
+      m_vertex_components = 0;
+      m_snapshot.vertices.resize(m_snapshot.vertices.size() + 3);
+      m_snapshot.colors.push_back(Scene::DEFAULT_COLOR);
+    }
+
+    bool end_triangle() {
+      m_triangle_depth = 0;
+      if (m_vertex_components == 6) return true;
+      m_error = "triangle " + std::to_string(m_snapshot.colors.size() - 1) + " does not have 3 vertices";
+      return false;
+    }
+
+    bool number(const double value) {
+      if (m_triangle_depth == 0) return next_element();
+
+      const std::size_t depth = m_triangle_depth;
+      if (m_stack.size() == depth + 3 && m_stack[depth + 1].key == "vertices" && m_stack[depth + 1].index < 3 &&
+          m_stack[depth + 2].index < 2) {
+        if (!fits_float(value)) return non_finite("coordinate");
+        const std::size_t vertex = m_snapshot.vertices.size() - 3 + m_stack[depth + 1].index;
+        m_snapshot.vertices[vertex][static_cast<int>(m_stack[depth + 2].index)] = static_cast<float>(value);
+        ++m_vertex_components;
+      }
+      else if (m_stack.size() == depth + 2 && m_stack[depth + 1].key == "color" && m_stack[depth + 1].index < 4) {
+        if (!fits_float(value)) return non_finite("color");
+        m_snapshot.colors.back()[static_cast<int>(m_stack[depth + 1].index)] = static_cast<float>(value);
+      }
+      return next_element();
+    }
+
+    // Overflowing literals such as 1e39 or 1e400 would turn into inf, which the spatial index cannot place.
+    static bool fits_float(const double value) {
+      return std::abs(value) <= static_cast<double>(std::numeric_limits<float>::max());
+    }
+
+    bool non_finite(const char* what) {
+      m_error = "triangle " + std::to_string(m_snapshot.colors.size() - 1) + " has a non-finite " + what;
+      return false;
+    }
+  };
+}
+
+bool load_scene_snapshot(const std::string& filename, SceneSnapshot& snapshot, std::string* error,
+                         std::atomic<float>* progress, const std::atomic<bool>* cancel) {
+  const auto fail = [&](const std::string& message) {
+    if (error) *error = message;
+    return false;
+  };
+
+  std::error_code ec;
+  const std::uintmax_t size = std::filesystem::file_size(filename, ec);
+  if (ec) return fail("cannot stat " + filename + ": " + ec.message());
+
+  std::FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) return fail("cannot open " + filename);
+
+  ProgressStreambuf buffer{file, size, progress, cancel};
+  std::istream stream{&buffer};
+  SceneSaxHandler handler{snapshot, size, cancel};
+  const bool parsed = nlohmann::json::sax_parse(stream, &handler);
+  std::fclose(file);
+
+  if (handler.cancelled()) return fail("cancelled");
+  if (!parsed) return fail(handler.get_error());
+  if (!handler.found_triangles()) return fail("no triangles in " + filename);
+
+  if (progress) progress->store(1.0f, std::memory_order_relaxed);
+  return true;
+}
+
+SceneLoader::SceneLoader() : m_state{State::IDLE}, m_progress{0.0f}, m_cancel{false} {}
+
+SceneLoader::~SceneLoader() {
+  cancel();
+  join();
+}
+
+bool SceneLoader::start(const std::string& filename) {
+  if (is_loading()) return false;
+  join();
+
+  m_progress = 0.0f;
+  m_cancel = false;
+  m_error.clear();
+  m_result = std::make_shared<SceneSnapshot>();
+  m_state = State::LOADING;
+
+  m_worker = std::thread([this, filename] {
+    std::string error;
+    const bool loaded = load_scene_snapshot(filename, *m_result, &error, &m_progress, &m_cancel);
+    m_error = std::move(error);
+    m_state.store(loaded ? State::DONE : (m_cancel ? State::CANCELLED : State::FAILED), std::memory_order_release);
+  });
+  return true;
+}
+
+void SceneLoader::cancel() {
+  m_cancel = true;
+}
+
+SceneLoader::State SceneLoader::poll() {
+  const State state = m_state.load(std::memory_order_acquire);
+  if (state == State::IDLE || state == State::LOADING) return state;
+
+  join();
+  m_state = State::IDLE;
+  return state;
+}
+
+bool SceneLoader::is_loading() const {
+  return m_state.load(std::memory_order_acquire) == State::LOADING;
+}
+
+float SceneLoader::get_progress() const {
+  return m_progress.load(std::memory_order_relaxed);
+}
+
+const std::string& SceneLoader::get_error() const {
+  return m_error;
+}
+
+std::shared_ptr<const SceneSnapshot> SceneLoader::take_result() {
+  return std::move(m_result);
+}
+
+void SceneLoader::join() {
+  if (m_worker.joinable()) m_worker.join();
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "SceneSnapshot.h"
+
+// Streams a scene file through nlohmann::json::sax_parse straight into `snapshot`,
+// without building a DOM. `progress` (0..1) and `cancel` may be null.
+bool load_scene_snapshot(const std::string& filename, SceneSnapshot& snapshot, std::string* error = nullptr,
+                         std::atomic<float>* progress = nullptr, const std::atomic<bool>* cancel = nullptr);
+
+/*
+* Background scene loader
+*
+* Runs load_scene_snapshot on a worker thread. The render thread polls
+* for the result once per frame and can show progress or cancel.
+*/
+class SceneLoader {
+public:
+  enum class State {
+    IDLE,
+    LOADING,
+    DONE,
+    FAILED,
+    CANCELLED
+  };
+
+  SceneLoader();
+  ~SceneLoader();
+
+  SceneLoader(const SceneLoader&) = delete;
+  SceneLoader& operator=(const SceneLoader&) = delete;
+
+  // Starts loading `filename`. Returns false when a load is already running.
+  bool start(const std::string& filename);
+  void cancel();
+
+  // Returns the finished state once (DONE/FAILED/CANCELLED) and resets to IDLE.
+  State poll();
+
+  [[nodiscard]] bool is_loading() const;
+  [[nodiscard]] float get_progress() const;
+  [[nodiscard]] const std::string& get_error() const;
+
+  // Valid after poll() returned DONE.
+  [[nodiscard]] std::shared_ptr<const SceneSnapshot> take_result();
+
+private:
+  std::thread m_worker;
+  std::atomic<State> m_state;
+  std::atomic<float> m_progress;
+  std::atomic<bool> m_cancel;
+
+  std::shared_ptr<SceneSnapshot> m_result;
+  std::string m_error;
+
+  void join();
+};
@@ -0,0 +1,12 @@
+﻿#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Immutable copy of everything that gets saved, safe to hand to another thread.
+// Triangle i owns vertices [3 * i, 3 * i + 3) and colors[i].
+struct SceneSnapshot {
+  std::vector<glm::vec2> vertices;
+  std::vector<glm::vec4> colors;
+};
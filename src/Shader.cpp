@@ -4,6 +4,8 @@
 #include <fstream>
 #include <sstream>
 
+#include "GLState.h"
+#include "GpuResources.h"
 #include "Renderer.h"
 
 ShaderProgramSource Shader::parse_shader(const std::string& filepath) {
@@ -46,41 +48,41 @@ ShaderProgramSource Shader::parse_shader(const std::string& filepath) {
 }
 
 
-Shader::Shader(const std::string& filepath) {
+Shader::Shader(const std::string& filepath) : m_filepath{filepath} {
   const ShaderProgramSource source = parse_shader(filepath);
-  m_renderer_id = create_shader(source.vertex, source.fragment);
+  m_renderer_id.reset(create_shader(source.vertex, source.fragment));
 }
 
 Shader::Shader(const std::string& name, const std::string& vertexSrc, const std::string& fragmentSrc) {
   m_filepath = name;
-  m_renderer_id = create_shader(vertexSrc, fragmentSrc);
-}
-
-Shader::~Shader() {
-  GLCall(glDeleteProgram(m_renderer_id));
+  m_renderer_id.reset(create_shader(vertexSrc, fragmentSrc));
 }
 
 void Shader::bind() const {
-GLCall(glUseProgram(m_renderer_id));
+  GLState::use_program(m_renderer_id.get());
 }
 
 void Shader::unbind() const {
-GLCall(glUseProgram(0));
+  GLState::use_program(0);
 }
 
-void Shader::set_uniform_1i(const std::string& name, int v0) const {
+void Shader::set_uniform_1i(const std::string_view name, int v0) const {
   GLCall(glUniform1i(get_uniform_location(name), v0));
 }
 
-void Shader::set_uniform_4f(const std::string& name, const glm::vec4& value) const {
+void Shader::set_uniform_1f(const std::string_view name, const float v0) const {
+  GLCall(glUniform1f(get_uniform_location(name), v0));
+}
+
+void Shader::set_uniform_4f(const std::string_view name, const glm::vec4& value) const {
   GLCall(glUniform4f(get_uniform_location(name), value.x, value.y, value.z, value.w));
 }
 
-void Shader::set_uniform_4f(const std::string& name, float v0, float v1, float v2, float v3) const {
+void Shader::set_uniform_4f(const std::string_view name, float v0, float v1, float v2, float v3) const {
   GLCall(glUniform4f(get_uniform_location(name), v0, v1, v2, v3));
 }
 
-void Shader::set_uniform_mat4f(const std::string& name, const glm::mat4& matrix) const {
+void Shader::set_uniform_mat4f(const std::string_view name, const glm::mat4& matrix) const {
   GLCall(glUniformMatrix4fv(get_uniform_location(name), 1, GL_FALSE, &matrix[0][0]));
 }
 
@@ -108,7 +110,7 @@ unsigned int Shader::compile_shader(unsigned int type, const std::string& source
 
 
 unsigned int Shader::create_shader(const std::string& vertex, const std::string& fragment) {
-  GLCall(const unsigned int program = glCreateProgram());
+  const unsigned int program = GpuResources::create_program("Shader " + m_filepath);
   const unsigned int vs = compile_shader(GL_VERTEX_SHADER, vertex);
   //assert(vs != 0);
   const unsigned int fs = compile_shader(GL_FRAGMENT_SHADER, fragment);
@@ -123,12 +125,13 @@ unsigned int Shader::create_shader(const std::string& vertex, const std::string&
   return program;
 }
 
-int Shader::get_uniform_location(const std::string& name) const {
-  if (m_uniform_location_cache.contains(name))
-    return m_uniform_location_cache[name];
-  GLCall(const int location = glGetUniformLocation(m_renderer_id, name.c_str()));
+int Shader::get_uniform_location(const std::string_view name) const {
+  if (const auto it = m_uniform_location_cache.find(name); it != m_uniform_location_cache.end())
+    return it->second;
+  const std::string key{name};
+  GLCall(const int location = glGetUniformLocation(m_renderer_id.get(), key.c_str()));
   if (location == -1)
     std::cout << "[Shader] " << m_filepath << " Warning: cannot find uniform " << name << '\n';
-  m_uniform_location_cache[name] = location;
+  m_uniform_location_cache.emplace(key, location);
   return location;
 }
@@ -1,10 +1,13 @@
 ﻿#pragma once
 
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 #include <glm/glm.hpp>
 
+#include "GLHandle.h"
+#include "string_map.h"
+
 struct ShaderProgramSource {
   std::string vertex;
   std::string fragment;
@@ -14,27 +17,30 @@ class Shader {
 public:
   Shader(const std::string& filepath);
   Shader(const std::string& name, const std::string& vertexSrc, const std::string& fragmentSrc);
-  ~Shader();
+
+  Shader(Shader&&) noexcept = default;
+  Shader& operator=(Shader&&) noexcept = default;
   
   void bind() const;
   void unbind() const;
   
-  void set_uniform_1i(const std::string& name, int v0) const;
+  void set_uniform_1i(std::string_view name, int v0) const;
+  void set_uniform_1f(std::string_view name, float v0) const;
   
-  void set_uniform_4f(const std::string& name, const glm::vec4& value) const;
-  void set_uniform_4f(const std::string& name, float v0, float v1, float v2, float v3) const;
+  void set_uniform_4f(std::string_view name, const glm::vec4& value) const;
+  void set_uniform_4f(std::string_view name, float v0, float v1, float v2, float v3) const;
   
-  void set_uniform_mat4f(const std::string& name, const glm::mat4& matrix) const;
+  void set_uniform_mat4f(std::string_view name, const glm::mat4& matrix) const;
   
   static ShaderProgramSource parse_shader(const std::string& filepath);
 private:
-  unsigned int m_renderer_id;
+  ProgramHandle m_renderer_id;
   
   std::string m_filepath;
-  mutable std::unordered_map<std::string, int> m_uniform_location_cache;
+  mutable StringMap<int> m_uniform_location_cache;
 
   unsigned int compile_shader(unsigned int type, const std::string& source);
   unsigned int create_shader(const std::string& vertex, const std::string& fragment);
   
-  int get_uniform_location(const std::string& name) const;
+  int get_uniform_location(std::string_view name) const;
 };
@@ -0,0 +1,135 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct SlotId {
+  std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+  std::uint32_t generation = 0;
+
+  [[nodiscard]] bool is_valid() const { return index != std::numeric_limits<std::uint32_t>::max(); }
+  bool operator==(const SlotId&) const = default;
+};
+
+/*
+* Slot map
+*
+* Values live contiguously in a dense array (iterate that), handles stay
+* stable across other insertions and removals. Removing swaps the last
+* value into the hole; generation counters make stale handles fail to
+* resolve instead of aliasing a newer value. Insert, erase and lookup are O(1).
+*/
+template <typename T>
+class SlotMap {
+public:
+  SlotId insert(T value) {
+    std::uint32_t slot_index;
+    if (m_free_head != NONE) {
+      slot_index = m_free_head;
+      m_free_head = m_slots[slot_index].target;
+    }
+    else {
+      slot_index = static_cast<std::uint32_t>(m_slots.size());
+      m_slots.push_back({NONE, 0});
+    }
+
+    Slot& slot = m_slots[slot_index];
+    slot.target = static_cast<std::uint32_t>(m_values.size());
+    m_values.push_back(std::move(value));
+    m_dense_to_slot.push_back(slot_index);
+    return {slot_index, slot.generation};
+  }
+
+  bool erase(const SlotId id) {
+    if (!contains(id)) return false;
+
+    Slot& slot = m_slots[id.index];
+    const std::uint32_t dense = slot.target;
+    const std::uint32_t last = static_cast<std::uint32_t>(m_values.size() - 1);
+    if (dense != last) {
+      m_values[dense] = std::move(m_values[last]);
+      m_dense_to_slot[dense] = m_dense_to_slot[last];
+      m_slots[m_dense_to_slot[dense]].target = dense;
+    }
+    m_values.pop_back();
+    m_dense_to_slot.pop_back();
+
+    ++slot.generation;
+    slot.target = m_free_head;
+    m_free_head = id.index;
+    return true;
+  }
+
+  void clear() {
+    for (std::uint32_t dense = 0; dense < m_values.size(); ++dense) {
+      const std::uint32_t slot_index = m_dense_to_slot[dense];
+      ++m_slots[slot_index].generation;
+      m_slots[slot_index].target = m_free_head;
+      m_free_head = slot_index;
+    }
+    m_values.clear();
+    m_dense_to_slot.clear();
+  }
+
+  void reserve(const std::size_t count) {
+    m_values.reserve(count);
+    m_dense_to_slot.reserve(count);
+    m_slots.reserve(count);
+  }
+
+  [[nodiscard]] bool contains(const SlotId id) const {
+    // Freeing a slot bumps its generation, so a matching generation means the slot is alive.
+    return id.index < m_slots.size() && m_slots[id.index].generation == id.generation;
+  }
+
+  [[nodiscard]] T* get(const SlotId id) {
+    return contains(id) ? &m_values[m_slots[id.index].target] : nullptr;
+  }
+
+  [[nodiscard]] const T* get(const SlotId id) const {
+    return contains(id) ? &m_values[m_slots[id.index].target] : nullptr;
+  }
+
+  // Position of the value in the dense array, only valid until the next erase.
+  [[nodiscard]] std::size_t dense_index(const SlotId id) const {
+    return m_slots[id.index].target;
+  }
+
+  // Same for a live slot index (SlotId::index) stored elsewhere, e.g. in a spatial index.
+  [[nodiscard]] std::size_t dense_index(const std::uint32_t slot_index) const {
+    return m_slots[slot_index].target;
+  }
+
+  [[nodiscard]] SlotId id_at(const std::size_t dense) const {
+    const std::uint32_t slot_index = m_dense_to_slot[dense];
+    return {slot_index, m_slots[slot_index].generation};
+  }
+
+  [[nodiscard]] std::size_t size() const { return m_values.size(); }
+  [[nodiscard]] bool empty() const { return m_values.empty(); }
+
+  [[nodiscard]] T* data() { return m_values.data(); }
+  [[nodiscard]] const T* data() const { return m_values.data(); }
+
+  auto begin() { return m_values.begin(); }
+  auto end() { return m_values.end(); }
+  auto begin() const { return m_values.begin(); }
+  auto end() const { return m_values.end(); }
+
+  T& operator[](const std::size_t dense) { return m_values[dense]; }
+  const T& operator[](const std::size_t dense) const { return m_values[dense]; }
+
+private:
+  static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+
+  struct Slot {
+    std::uint32_t target; // dense index while alive, next free slot otherwise
+    std::uint32_t generation;
+  };
+
+  std::vector<T> m_values;
+  std::vector<std::uint32_t> m_dense_to_slot;
+  std::vector<Slot> m_slots;
+  std::uint32_t m_free_head = NONE;
+};
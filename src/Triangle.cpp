@@ -1,13 +1,20 @@
 ﻿#include "Triangle.h"
 
-#include "Renderer.h"
+#include <cmath>
 
-Triangle::Triangle(const float a, const float b, const float c) : a(a), b(b), c(c), needs_update(true) {
-  vertices.resize(3);
-  sides.resize(3);
+Triangle::Triangle(const float a, const float b, const float c) : a(a), b(b), c(c), vertices{}, sides{},
+                                                                  needs_update(true) {
   update_vertices();
 }
 
+Triangle::Triangle(const std::array<glm::vec2, 3>& vertices) : a(0), b(0), c(0), vertices(vertices), sides{},
+                                                               needs_update(true) {
+  update_sides();
+  a = sides[0];
+  b = sides[1];
+  c = sides[2];
+}
+
 void Triangle::update_vertices() {
   if (!is_valid()) return;
 
@@ -31,15 +38,17 @@ bool Triangle::is_valid() const {
   return (a + b > c) && (a + c > b) && (b + c > a);
 }
 
-void Triangle::set_vertices(const std::vector<glm::vec2>& vertices) {
+void Triangle::set_vertices(const std::array<glm::vec2, 3>& vertices) {
   this->vertices = vertices;
+  needs_update = true;
+  update_sides();
 }
 
-const std::vector<glm::vec2>& Triangle::get_vertices() const {
+const std::array<glm::vec2, 3>& Triangle::get_vertices() const {
   return vertices;
 }
 
-const std::vector<float>& Triangle::get_sides() const {
+const std::array<float, 3>& Triangle::get_sides() const {
   return sides;
 }
 
@@ -1,20 +1,23 @@
 ﻿#pragma once
 
+#include <array>
+
 #include <glm/glm.hpp>
 
 class Triangle {
 public:
   Triangle(float a, float b, float c);
+  explicit Triangle(const std::array<glm::vec2, 3>& vertices);
   
   void update_vertices();
   void move_vertex(int index, glm::vec2 pos);
   
   [[nodiscard]] bool is_valid() const;
   
-  void set_vertices(const std::vector<glm::vec2>& vertices);
+  void set_vertices(const std::array<glm::vec2, 3>& vertices);
   
-  [[nodiscard]] const std::vector<glm::vec2>& get_vertices() const;
-  [[nodiscard]] const std::vector<float>& get_sides() const;
+  [[nodiscard]] const std::array<glm::vec2, 3>& get_vertices() const;
+  [[nodiscard]] const std::array<float, 3>& get_sides() const;
   [[nodiscard]] float get_area() const;
   [[nodisacrd]] bool is_update_needed() const;
   void reset_update_flag();
@@ -22,8 +25,8 @@ public:
 private:
   float a, b, c;
   float area = 0;
-  std::vector<glm::vec2> vertices;
-  std::vector<float> sides;
+  std::array<glm::vec2, 3> vertices;
+  std::array<float, 3> sides;
   
   bool needs_update;
   
@@ -0,0 +1,461 @@
+﻿#include "TriangleBvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HERON_BVH_SSE 1
+#endif
+
+#include "scoped_timer.h"
+#include "util.h"
+
+namespace {
+  // Trees deeper than this split at the median, which bounds the depth by about this plus log2(triangles).
+  constexpr std::size_t MEDIAN_DEPTH = 24;
+  // Triangles per thread when preparing a build.
+  constexpr std::size_t PREPARE_CHUNK = 16 * 1024;
+
+  constexpr Bounds2D EMPTY_BOUNDS{glm::vec2{std::numeric_limits<float>::max()},
+                                  glm::vec2{std::numeric_limits<float>::lowest()}};
+
+  void grow(Bounds2D& bounds, const Bounds2D& other) {
+    bounds.min = glm::min(bounds.min, other.min);
+    bounds.max = glm::max(bounds.max, other.max);
+  }
+
+  void grow(Bounds2D& bounds, const glm::vec2& point) {
+    bounds.min = glm::min(bounds.min, point);
+    bounds.max = glm::max(bounds.max, point);
+  }
+
+  float half_perimeter(const Bounds2D& bounds) {
+    const glm::vec2 extent = bounds.max - bounds.min;
+    return extent.x + extent.y;
+  }
+
+  bool contains_point(const Bounds2D& bounds, const glm::vec2& point) {
+    return bounds.min.x <= point.x && point.x <= bounds.max.x && bounds.min.y <= point.y && point.y <= bounds.max.y;
+  }
+
+  // Separating axis test against the box axes and the triangle's edge normals.
+  bool triangle_overlaps_box(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const Bounds2D& box) {
+    const Bounds2D bounds{glm::min(glm::min(a, b), c), glm::max(glm::max(a, b), c)};
+    if (!bounds.overlaps(box)) return false;
+    const glm::vec2 corners[3] = {a, b, c};
+    for (int edge = 0; edge < 3; ++edge) {
+      const glm::vec2 direction = corners[(edge + 1) % 3] - corners[edge];
+      const glm::vec2 normal{-direction.y, direction.x};
+      const auto project = [&](const glm::vec2& point) { return normal.x * point.x + normal.y * point.y; };
+      const float low = std::min({project(a), project(b), project(c)});
+      const float high = std::max({project(a), project(b), project(c)});
+      // The box corners themselves are projected, not its center and radius, so a triangle touching the box at a
+      // shared point rounds the same way on both sides.
+      const glm::vec2 low_corner{normal.x >= 0.0f ? box.min.x : box.max.x, normal.y >= 0.0f ? box.min.y : box.max.y};
+      const glm::vec2 high_corner{normal.x >= 0.0f ? box.max.x : box.min.x, normal.y >= 0.0f ? box.max.y : box.min.y};
+      const float box_low = project(low_corner);
+      const float box_high = project(high_corner);
+      if (high < box_low || low > box_high) return false;
+    }
+    return true;
+  }
+}
+
+struct TriangleBvh::BuildContext {
+  std::span<const glm::vec2> corners;
+  std::atomic<std::uint32_t> node_count;
+  std::atomic<std::uint32_t> packet_count;
+  // Builds this shallow may hand a child to a new thread.
+  std::size_t spawn_depth;
+};
+
+namespace {
+  // Bit i is set when lane i's triangle contains the point; the same test as point_in_triangle() in geometry.h.
+  template <typename Packet>
+  unsigned int contains_mask(const Packet& packet, const glm::vec2& point) {
+#ifdef HERON_BVH_SSE
+    const __m128 px = _mm_set1_ps(point.x);
+    const __m128 py = _mm_set1_ps(point.y);
+    const __m128 ax = _mm_load_ps(packet.ax);
+    const __m128 ay = _mm_load_ps(packet.ay);
+    const __m128 bx = _mm_load_ps(packet.bx);
+    const __m128 by = _mm_load_ps(packet.by);
+    const __m128 cx = _mm_load_ps(packet.cx);
+    const __m128 cy = _mm_load_ps(packet.cy);
+    const auto edge = [&](const __m128 from_x, const __m128 from_y, const __m128 to_x, const __m128 to_y) {
+      return _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(to_x, from_x), _mm_sub_ps(py, from_y)),
+                        _mm_mul_ps(_mm_sub_ps(to_y, from_y), _mm_sub_ps(px, from_x)));
+    };
+    const __m128 d0 = edge(ax, ay, bx, by);
+    const __m128 d1 = edge(bx, by, cx, cy);
+    const __m128 d2 = edge(cx, cy, ax, ay);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 negative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(d0, zero), _mm_cmplt_ps(d1, zero)),
+                                      _mm_cmplt_ps(d2, zero));
+    const __m128 positive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(d0, zero), _mm_cmpgt_ps(d1, zero)),
+                                      _mm_cmpgt_ps(d2, zero));
+    return ~static_cast<unsigned int>(_mm_movemask_ps(_mm_and_ps(negative, positive))) & 0xFu;
+#else
+    unsigned int mask = 0;
+    for (std::size_t lane = 0; lane < std::size(packet.ax); ++lane) {
+      const auto edge = [&](const float from_x, const float from_y, const float to_x, const float to_y) {
+        return (to_x - from_x) * (point.y - from_y) - (to_y - from_y) * (point.x - from_x);
+      };
+      const float d0 = edge(packet.ax[lane], packet.ay[lane], packet.bx[lane], packet.by[lane]);
+      const float d1 = edge(packet.bx[lane], packet.by[lane], packet.cx[lane], packet.cy[lane]);
+      const float d2 = edge(packet.cx[lane], packet.cy[lane], packet.ax[lane], packet.ay[lane]);
+      const bool has_negative = d0 < 0.0f || d1 < 0.0f || d2 < 0.0f;
+      const bool has_positive = d0 > 0.0f || d1 > 0.0f || d2 > 0.0f;
+      if (!(has_negative && has_positive)) mask |= 1u << lane;
+    }
+    return mask;
+#endif
+  }
+}
+
+void TriangleBvh::build(const std::span<const glm::vec2> corners) {
+  HG_SCOPED_TIMER("TriangleBvh::build");
+  const std::size_t count = corners.size() / 3;
+  clear();
+  if (count == 0) return;
+
+  m_triangle_bounds.resize(count);
+  m_centroids.resize(count);
+  const std::size_t chunks = (count + PREPARE_CHUNK - 1) / PREPARE_CHUNK;
+  const std::size_t workers = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, chunks);
+  run_parallel(workers, [&](const std::size_t worker) {
+    for (std::size_t chunk = worker; chunk < chunks; chunk += workers) {
+      for (std::size_t i = chunk * PREPARE_CHUNK; i < std::min(count, (chunk + 1) * PREPARE_CHUNK); ++i) {
+        const glm::vec2* triangle = corners.data() + i * 3;
+        m_triangle_bounds[i] = {glm::min(glm::min(triangle[0], triangle[1]), triangle[2]),
+                                glm::max(glm::max(triangle[0], triangle[1]), triangle[2])};
+        m_centroids[i] = (triangle[0] + triangle[1] + triangle[2]) / 3.0f;
+      }
+    }
+  });
+
+  m_order.resize(count);
+  std::iota(m_order.begin(), m_order.end(), 0u);
+  m_leaf_of.resize(count);
+  // A binary tree with non-empty leaves has fewer than twice as many nodes as triangles.
+  m_nodes.resize(count * 2);
+  m_packets.resize(count);
+  m_nodes[0] = {EMPTY_BOUNDS, 0, static_cast<std::uint32_t>(count), NONE, NONE, 0, NONE};
+
+  BuildContext context{corners, 1, 0,
+                       static_cast<std::size_t>(std::bit_width(std::max(std::thread::hardware_concurrency(), 1u)) - 1)};
+  build_node(context, 0, 0);
+  m_nodes.resize(context.node_count.load());
+  m_packets.resize(context.packet_count.load());
+
+  // Children are allocated after their parent, so walking backwards sees them first.
+  for (std::size_t i = m_nodes.size(); i-- > 0;) {
+    Node& node = m_nodes[i];
+    if (node.left == NONE) {
+      node.max_triangle = *std::max_element(m_order.begin() + node.first, m_order.begin() + node.first + node.count);
+    }
+    else {
+      node.max_triangle = std::max(m_nodes[node.left].max_triangle, m_nodes[node.left + 1].max_triangle);
+    }
+  }
+}
+
+void TriangleBvh::build_node(BuildContext& context, const std::uint32_t index, const std::size_t depth) {
+  Node& node = m_nodes[index];
+  const auto first = m_order.begin() + node.first;
+  const auto last = first + node.count;
+
+  Bounds2D centroid_bounds = EMPTY_BOUNDS;
+  node.bounds = EMPTY_BOUNDS;
+  for (auto it = first; it != last; ++it) {
+    grow(node.bounds, m_triangle_bounds[*it]);
+    grow(centroid_bounds, m_centroids[*it]);
+  }
+
+  if (node.count <= LEAF_SIZE) {
+    node.packet = context.packet_count.fetch_add(1);
+    Packet& packet = m_packets[node.packet];
+    for (std::uint32_t lane = 0; lane < LEAF_SIZE; ++lane) {
+      // Spare lanes repeat the first triangle; queries mask them off by count.
+      const std::uint32_t triangle = m_order[node.first + std::min(lane, node.count - 1)];
+      write_lane(packet, lane, context.corners.data() + static_cast<std::size_t>(triangle) * 3);
+      packet.triangles[lane] = triangle;
+      if (lane < node.count) m_leaf_of[triangle] = index;
+    }
+    return;
+  }
+
+  const glm::vec2 extent = centroid_bounds.max - centroid_bounds.min;
+  const int axis = extent.x >= extent.y ? 0 : 1;
+  const float axis_extent = extent[axis];
+  auto middle = first;
+  if (axis_extent > 0.0f && depth < MEDIAN_DEPTH) {
+    struct Bin {
+      Bounds2D bounds = EMPTY_BOUNDS;
+      std::uint32_t count = 0;
+    };
+    Bin bins[BIN_COUNT];
+    const float origin = centroid_bounds.min[axis];
+    const float scale = static_cast<float>(BIN_COUNT) / axis_extent;
+    const auto bin_of = [&](const std::uint32_t triangle) {
+      return std::min(static_cast<std::size_t>((m_centroids[triangle][axis] - origin) * scale), BIN_COUNT - 1);
+    };
+    for (auto it = first; it != last; ++it) {
+      Bin& bin = bins[bin_of(*it)];
+      grow(bin.bounds, m_triangle_bounds[*it]);
+      ++bin.count;
+    }
+
+    // Split k puts bins [0, k) left. Cost: triangles times half perimeter on either side.
+    float right_area[BIN_COUNT];
+    std::uint32_t right_count[BIN_COUNT];
+    Bounds2D accumulated = EMPTY_BOUNDS;
+    std::uint32_t accumulated_count = 0;
+    for (std::size_t split = BIN_COUNT - 1; split > 0; --split) {
+      grow(accumulated, bins[split].bounds);
+      accumulated_count += bins[split].count;
+      right_area[split] = half_perimeter(accumulated);
+      right_count[split] = accumulated_count;
+    }
+    std::size_t best_split = 0;
+    float best_cost = std::numeric_limits<float>::max();
+    accumulated = EMPTY_BOUNDS;
+    accumulated_count = 0;
+    for (std::size_t split = 1; split < BIN_COUNT; ++split) {
+      grow(accumulated, bins[split - 1].bounds);
+      accumulated_count += bins[split - 1].count;
+      if (accumulated_count == 0 || right_count[split] == 0) continue;
+      const float cost = static_cast<float>(accumulated_count) * half_perimeter(accumulated) +
+                         static_cast<float>(right_count[split]) * right_area[split];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_split = split;
+      }
+    }
+    if (best_split != 0) {
+      middle = std::partition(first, last, [&](const std::uint32_t triangle) { return bin_of(triangle) < best_split; });
+    }
+  }
+  if (middle == first || middle == last) {
+    middle = first + node.count / 2;
+    std::nth_element(first, middle, last, [&](const std::uint32_t a, const std::uint32_t b) {
+      return m_centroids[a][axis] < m_centroids[b][axis];
+    });
+  }
+
+  const std::uint32_t left = context.node_count.fetch_add(2);
+  const std::uint32_t left_count = static_cast<std::uint32_t>(middle - first);
+  m_nodes[left] = {EMPTY_BOUNDS, node.first, left_count, NONE, index, 0, NONE};
+  m_nodes[left + 1] = {EMPTY_BOUNDS, node.first + left_count, node.count - left_count, NONE, index, 0, NONE};
+  node.left = left;
+
+  if (node.count >= PARALLEL_THRESHOLD && depth < context.spawn_depth) {
+    std::thread left_builder([&] { build_node(context, left, depth + 1); });
+    build_node(context, left + 1, depth + 1);
+    left_builder.join();
+  }
+  else {
+    build_node(context, left, depth + 1);
+    build_node(context, left + 1, depth + 1);
+  }
+}
+
+void TriangleBvh::clear() {
+  m_nodes.clear();
+  m_packets.clear();
+  m_order.clear();
+  m_leaf_of.clear();
+}
+
+void TriangleBvh::update(const std::uint32_t triangle, const std::span<const glm::vec2, 3> corners) {
+  if (triangle >= m_leaf_of.size()) return;
+  const std::uint32_t leaf = m_leaf_of[triangle];
+  Node& node = m_nodes[leaf];
+  Packet& packet = m_packets[node.packet];
+  for (std::size_t lane = 0; lane < LEAF_SIZE; ++lane) {
+    // Spare lanes hold a copy of the first triangle.
+    if (packet.triangles[lane] == triangle) write_lane(packet, lane, corners.data());
+  }
+  node.bounds = leaf_bounds(node);
+
+  // An ancestor whose bounds come out unchanged leaves everything above it unchanged too.
+  for (std::uint32_t index = node.parent; index != NONE; index = m_nodes[index].parent) {
+    Node& parent = m_nodes[index];
+    Bounds2D bounds = m_nodes[parent.left].bounds;
+    grow(bounds, m_nodes[parent.left + 1].bounds);
+    if (bounds == parent.bounds) break;
+    parent.bounds = bounds;
+  }
+}
+
+void TriangleBvh::refit(const std::span<const glm::vec2> corners) {
+  HG_SCOPED_TIMER("TriangleBvh::refit");
+  if (corners.size() / 3 != m_leaf_of.size()) return;
+  for (std::size_t i = m_nodes.size(); i-- > 0;) {
+    Node& node = m_nodes[i];
+    if (node.left == NONE) {
+      Packet& packet = m_packets[node.packet];
+      for (std::size_t lane = 0; lane < LEAF_SIZE; ++lane) {
+        write_lane(packet, lane, corners.data() + static_cast<std::size_t>(packet.triangles[lane]) * 3);
+      }
+      node.bounds = leaf_bounds(node);
+    }
+    else {
+      node.bounds = m_nodes[node.left].bounds;
+      grow(node.bounds, m_nodes[node.left + 1].bounds);
+    }
+  }
+}
+
+std::uint32_t TriangleBvh::find_topmost(const glm::vec2& point) const {
+  if (m_nodes.empty()) return NONE;
+  std::uint32_t best = NONE;
+  std::uint32_t stack[MAX_STACK];
+  std::size_t stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    const Node& node = m_nodes[stack[--stack_size]];
+    if ((best != NONE && node.max_triangle <= best) || !contains_point(node.bounds, point)) continue;
+    if (node.left == NONE) {
+      const Packet& packet = m_packets[node.packet];
+      const unsigned int mask = contains_mask(packet, point) & ((1u << node.count) - 1u);
+      for (std::uint32_t lane = 0; lane < node.count; ++lane) {
+        if ((mask >> lane & 1u) && (best == NONE || packet.triangles[lane] > best)) best = packet.triangles[lane];
+      }
+      continue;
+    }
+    // The child that may hold higher triangles goes on top, so it is searched first.
+    const bool left_first = m_nodes[node.left].max_triangle > m_nodes[node.left + 1].max_triangle;
+    stack[stack_size++] = left_first ? node.left + 1 : node.left;
+    stack[stack_size++] = left_first ? node.left : node.left + 1;
+  }
+  return best;
+}
+
+void TriangleBvh::query_point(const glm::vec2& point, std::vector<std::uint32_t>& out) const {
+  out.clear();
+  if (m_nodes.empty()) return;
+  std::uint32_t stack[MAX_STACK];
+  std::size_t stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    const Node& node = m_nodes[stack[--stack_size]];
+    if (!contains_point(node.bounds, point)) continue;
+    if (node.left == NONE) {
+      const Packet& packet = m_packets[node.packet];
+      const unsigned int mask = contains_mask(packet, point);
+      for (std::uint32_t lane = 0; lane < node.count; ++lane) {
+        if (mask >> lane & 1u) out.push_back(packet.triangles[lane]);
+      }
+      continue;
+    }
+    stack[stack_size++] = node.left;
+    stack[stack_size++] = node.left + 1;
+  }
+  std::sort(out.begin(), out.end());
+}
+
+void TriangleBvh::query_box(const Bounds2D& box, std::vector<std::uint32_t>& out) const {
+  out.clear();
+  if (m_nodes.empty()) return;
+  std::uint32_t stack[MAX_STACK];
+  std::size_t stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    const Node& node = m_nodes[stack[--stack_size]];
+    if (!box.overlaps(node.bounds)) continue;
+    if (box.contains(node.bounds)) {
+      out.insert(out.end(), m_order.begin() + node.first, m_order.begin() + node.first + node.count);
+      continue;
+    }
+    if (node.left == NONE) {
+      const Packet& packet = m_packets[node.packet];
+      for (std::uint32_t lane = 0; lane < node.count; ++lane) {
+        if (triangle_overlaps_box({packet.ax[lane], packet.ay[lane]}, {packet.bx[lane], packet.by[lane]},
+                                  {packet.cx[lane], packet.cy[lane]}, box)) {
+          out.push_back(packet.triangles[lane]);
+        }
+      }
+      continue;
+    }
+    stack[stack_size++] = node.left;
+    stack[stack_size++] = node.left + 1;
+  }
+  std::sort(out.begin(), out.end());
+}
+
+void TriangleBvh::classify(const std::span<const glm::vec2> points, const std::span<std::uint32_t> out) const {
+  HG_SCOPED_TIMER("TriangleBvh::classify");
+  const std::size_t count = std::min(points.size(), out.size());
+  const std::size_t workers = count < PARALLEL_POINTS
+    ? 1
+    : std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, count / PARALLEL_POINTS);
+  if (m_nodes.empty()) {
+    std::fill_n(out.begin(), count, NONE);
+    return;
+  }
+
+  // Queries in Morton order over the root bounds walk mostly the same nodes one after another, which keeps them
+  // in cache; in input order every point starts from cold nodes.
+  const Bounds2D& root = m_nodes[0].bounds;
+  const glm::vec2 extent = glm::max(root.max - root.min, glm::vec2{std::numeric_limits<float>::min()});
+  const glm::vec2 scale = glm::vec2{65535.0f} / extent;
+  const auto morton_key = [&](const glm::vec2& point) {
+    const auto spread = [](std::uint32_t value) {
+      value = (value | value << 8) & 0x00FF00FFu;
+      value = (value | value << 4) & 0x0F0F0F0Fu;
+      value = (value | value << 2) & 0x33333333u;
+      return (value | value << 1) & 0x55555555u;
+    };
+    const glm::vec2 cell = glm::clamp((point - root.min) * scale, 0.0f, 65535.0f);
+    return spread(static_cast<std::uint32_t>(cell.x)) | spread(static_cast<std::uint32_t>(cell.y)) << 1;
+  };
+
+  std::vector<std::uint64_t> order(count);
+  run_parallel(workers, [&](const std::size_t worker) {
+    const auto first = order.begin() + static_cast<std::ptrdiff_t>(count * worker / workers);
+    const auto last = order.begin() + static_cast<std::ptrdiff_t>(count * (worker + 1) / workers);
+    for (auto it = first; it != last; ++it) {
+      const auto index = static_cast<std::uint64_t>(it - order.begin());
+      *it = static_cast<std::uint64_t>(morton_key(points[index])) << 32 | index;
+    }
+    std::sort(first, last);
+    for (auto it = first; it != last; ++it) {
+      const std::size_t index = *it & 0xFFFFFFFFu;
+      out[index] = find_topmost(points[index]);
+    }
+  });
+}
+
+std::size_t TriangleBvh::size() const {
+  return m_leaf_of.size();
+}
+
+std::size_t TriangleBvh::get_node_count() const {
+  return m_nodes.size();
+}
+
+void TriangleBvh::write_lane(Packet& packet, const std::size_t lane, const glm::vec2* corners) {
+  packet.ax[lane] = corners[0].x;
+  packet.ay[lane] = corners[0].y;
+  packet.bx[lane] = corners[1].x;
+  packet.by[lane] = corners[1].y;
+  packet.cx[lane] = corners[2].x;
+  packet.cy[lane] = corners[2].y;
+}
+
+Bounds2D TriangleBvh::leaf_bounds(const Node& leaf) const {
+  const Packet& packet = m_packets[leaf.packet];
+  Bounds2D bounds = EMPTY_BOUNDS;
+  for (std::uint32_t lane = 0; lane < leaf.count; ++lane) {
+    grow(bounds, glm::vec2{packet.ax[lane], packet.ay[lane]});
+    grow(bounds, glm::vec2{packet.bx[lane], packet.by[lane]});
+    grow(bounds, glm::vec2{packet.cx[lane], packet.cy[lane]});
+  }
+  return bounds;
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "LooseQuadtree.h"
+
+/*
+* Triangle BVH
+*
+* Bounding volume hierarchy over a triangle list for point and box
+* queries. Built top-down, splitting each node where a binned surface
+* area heuristic (the half perimeter, in 2D) says; subtrees above
+* PARALLEL_THRESHOLD triangles are built on threads of their own. Each
+* leaf keeps its triangles in one structure-of-arrays packet, so a point
+* is tested against all of them at once with SSE edge functions, the
+* unnormalized barycentric coordinates. Every node also records the
+* highest triangle index below it, which lets topmost-hit queries skip
+* subtrees that cannot beat the hit they already have.
+*
+* Moved triangles are refitted: their leaf and the bounds above it are
+* updated in O(depth), the shape of the tree is not, so heavy editing
+* slowly degrades it until the next build.
+*/
+class TriangleBvh {
+public:
+  static constexpr std::uint32_t NONE = 0xFFFFFFFFu;
+  static constexpr std::size_t LEAF_SIZE = 4;
+  static constexpr std::size_t BIN_COUNT = 16;
+  // Subtrees with at least this many triangles are built on a thread of their own.
+  static constexpr std::size_t PARALLEL_THRESHOLD = 16 * 1024;
+  // classify() splits batches of at least this many points across threads.
+  static constexpr std::size_t PARALLEL_POINTS = 16 * 1024;
+
+  // Triangle i has the corners [3 * i, 3 * i + 3).
+  void build(std::span<const glm::vec2> corners);
+  void clear();
+  // Moves one triangle and refits the bounds above it.
+  void update(std::uint32_t triangle, std::span<const glm::vec2, 3> corners);
+  // Moves every triangle; the count must match the last build.
+  void refit(std::span<const glm::vec2> corners);
+
+  // Highest-indexed triangle containing `point` (edges included), or NONE.
+  [[nodiscard]] std::uint32_t find_topmost(const glm::vec2& point) const;
+  // Every triangle containing `point`, ascending. Replaces `out`.
+  void query_point(const glm::vec2& point, std::vector<std::uint32_t>& out) const;
+  // Every triangle overlapping `box`, ascending. Replaces `out`.
+  void query_box(const Bounds2D& box, std::vector<std::uint32_t>& out) const;
+  // find_topmost() for every point, on worker threads for large batches. Points are taken in Morton order, so
+  // nearby queries share the nodes they visit. At most 2^32 points per call; `out` must hold one per point.
+  void classify(std::span<const glm::vec2> points, std::span<std::uint32_t> out) const;
+
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] std::size_t get_node_count() const;
+
+private:
+  // Traversal stacks are fixed arrays; builds fall back to median splits well before this depth.
+  static constexpr std::size_t MAX_STACK = 64;
+
+  struct Node {
+    Bounds2D bounds;
+    // The subtree's triangles are m_order[first, first + count).
+    std::uint32_t first;
+    std::uint32_t count;
+    // The right child is left + 1; NONE for leaves.
+    std::uint32_t left;
+    std::uint32_t parent;
+    std::uint32_t max_triangle;
+    // Leaves only.
+    std::uint32_t packet;
+  };
+
+  // Up to LEAF_SIZE triangles, lane by lane.
+  struct alignas(16) Packet {
+    float ax[LEAF_SIZE], ay[LEAF_SIZE];
+    float bx[LEAF_SIZE], by[LEAF_SIZE];
+    float cx[LEAF_SIZE], cy[LEAF_SIZE];
+    std::uint32_t triangles[LEAF_SIZE];
+  };
+
+  struct BuildContext;
+
+  std::vector<Node> m_nodes;
+  std::vector<Packet> m_packets;
+  std::vector<std::uint32_t> m_order;
+  // Leaf node of each triangle.
+  std::vector<std::uint32_t> m_leaf_of;
+  // Build scratch.
+  std::vector<Bounds2D> m_triangle_bounds;
+  std::vector<glm::vec2> m_centroids;
+
+  void build_node(BuildContext& context, std::uint32_t node, std::size_t depth);
+  static void write_lane(Packet& packet, std::size_t lane, const glm::vec2* corners);
+  [[nodiscard]] Bounds2D leaf_bounds(const Node& leaf) const;
+};
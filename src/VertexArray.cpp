@@ -1 +1,58 @@
 ﻿#include "VertexArray.h"
+
+#include <cstdint>
+
+#include "GLState.h"
+#include "GpuResources.h"
+#include "Renderer.h"
+
+VertexArray::VertexArray(std::string_view owner)
+  : m_renderer_id{GpuResources::create_vertex_array(owner)}, m_next_attribute{0}, m_next_binding{0} {}
+
+void VertexArray::add_buffer(const VertexBuffer& buffer, const VertexBufferLayout& layout) {
+  const bool dsa = Renderer::has_direct_state_access();
+  if (dsa) {
+    GLCall(glVertexArrayVertexBuffer(m_renderer_id.get(), m_next_binding, buffer.get_id(), 0,
+                                     static_cast<GLsizei>(layout.get_stride())));
+  }
+  else {
+    bind();
+    buffer.bind();
+  }
+
+  std::uintptr_t offset = 0;
+  for (const VertexBufferElement& element : layout.get_elements()) {
+    if (dsa) {
+      GLCall(glEnableVertexArrayAttrib(m_renderer_id.get(), m_next_attribute));
+      GLCall(glVertexArrayAttribFormat(m_renderer_id.get(), m_next_attribute, static_cast<GLint>(element.count),
+                                       element.type, element.normalized, static_cast<GLuint>(offset)));
+      GLCall(glVertexArrayAttribBinding(m_renderer_id.get(), m_next_attribute, m_next_binding));
+    }
+    else {
+      GLCall(glEnableVertexAttribArray(m_next_attribute));
+      GLCall(glVertexAttribPointer(m_next_attribute, static_cast<GLint>(element.count), element.type,
+                                   element.normalized, static_cast<GLsizei>(layout.get_stride()),
+                                   reinterpret_cast<const void*>(offset)));
+    }
+    offset += element.get_size();
+    ++m_next_attribute;
+  }
+  ++m_next_binding;
+}
+
+void VertexArray::set_index_buffer(const IndexBuffer& buffer) {
+  if (Renderer::has_direct_state_access()) {
+    GLCall(glVertexArrayElementBuffer(m_renderer_id.get(), buffer.get_id()));
+    return;
+  }
+  bind();
+  buffer.bind();
+}
+
+void VertexArray::bind() const {
+  GLState::bind_vertex_array(m_renderer_id.get());
+}
+
+void VertexArray::unbind() const {
+  GLState::bind_vertex_array(0);
+}
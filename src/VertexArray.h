@@ -1,6 +1,39 @@
 ﻿#pragma once
 
+#include <string_view>
+
+#include "GLHandle.h"
+#include "IndexBuffer.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+
+/*
+* Vertex array
+*
+* Applies VertexBufferLayouts to vertex buffers. On GL 4.5 (or with
+* ARB_direct_state_access) the format is set up with the glVertexArray*
+* functions and every buffer gets its own binding point; on 3.3 the
+* array is bound and described with glVertexAttribPointer. Either way
+* drawing only needs bind().
+*/
 class VertexArray {
 public:
-  
-};
+  explicit VertexArray(std::string_view owner = "VertexArray");
+
+  VertexArray(VertexArray&&) noexcept = default;
+  VertexArray& operator=(VertexArray&&) noexcept = default;
+
+  // Attributes continue where the previous buffer's left off.
+  void add_buffer(const VertexBuffer& buffer, const VertexBufferLayout& layout);
+  void set_index_buffer(const IndexBuffer& buffer);
+
+  void bind() const;
+  void unbind() const;
+
+  inline unsigned int get_id() const { return m_renderer_id.get(); }
+
+private:
+  VertexArrayHandle m_renderer_id;
+  unsigned int m_next_attribute;
+  unsigned int m_next_binding;
+};
\ No newline at end of file
@@ -1,21 +1,118 @@
 ﻿#include "VertexBuffer.h"
 
+#include <cstring>
+#include <iostream>
+
+#include "BufferPool.h"
+#include "GLState.h"
+#include "GpuResources.h"
 #include "Renderer.h"
 
-VertexBuffer::VertexBuffer(const void* data, unsigned int size) {
-  GLCall(glGenBuffers(1, &m_renderer_id));
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_renderer_id));
-  GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+VertexBuffer::VertexBuffer(const void* data, unsigned int size, std::string_view owner, unsigned int usage)
+  : m_buffer{BufferPool::get().acquire(size, usage, owner)}, m_size{size},
+    m_capacity{BufferPool::get_capacity(size)}, m_usage{usage} {
+  if (data && size > 0) set_sub_data(0, data, size);
 }
 
 VertexBuffer::~VertexBuffer() {
-  GLCall(glDeleteBuffers(1, &m_renderer_id));
+  release();
+}
+
+VertexBuffer& VertexBuffer::operator=(VertexBuffer&& other) noexcept {
+  if (this != &other) {
+    release();
+    m_buffer = std::move(other.m_buffer);
+    m_size = other.m_size;
+    m_capacity = other.m_capacity;
+    m_usage = other.m_usage;
+  }
+  return *this;
 }
 
 void VertexBuffer::bind() const {
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_renderer_id));
+  GLState::bind_buffer(GL_ARRAY_BUFFER, m_buffer.get());
 }
 
 void VertexBuffer::unbind() const {
-  GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  GLState::bind_buffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexBuffer::set_data(const void* data, std::size_t size, unsigned int usage) {
+  m_capacity = BufferPool::get_capacity(size);
+  m_size = size;
+  m_usage = usage;
+  GpuResources::buffer_data(m_buffer.get(), m_capacity, nullptr, usage);
+  if (data && size > 0) set_sub_data(0, data, size);
+}
+
+void VertexBuffer::set_sub_data(std::size_t offset, const void* data, std::size_t size) const {
+  if (Renderer::has_direct_state_access()) {
+    GLCall(glNamedBufferSubData(m_buffer.get(), static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data));
+    return;
+  }
+  GLState::bind_buffer(GL_ARRAY_BUFFER, m_buffer.get());
+  GLCall(glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data));
+}
+
+std::size_t VertexBuffer::upload_ranges(const DirtyRanges& ranges, const void* data,
+                                       const std::size_t element_size) const {
+  // Past this many ranges one map beats a driver round trip per range.
+  constexpr std::size_t MAX_SUB_DATA_CALLS = 8;
+
+  const std::span<const DirtyRanges::Range> dirty = ranges.get_ranges();
+  if (dirty.empty()) return 0;
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  std::size_t written = 0;
+
+  if (dirty.size() > MAX_SUB_DATA_CALLS) {
+    const std::size_t span_offset = dirty.front().first * element_size;
+    const std::size_t span_size = (dirty.back().first + dirty.back().count) * element_size - span_offset;
+    constexpr GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+    const bool dsa = Renderer::has_direct_state_access();
+    void* mapped = nullptr;
+    if (dsa) {
+      GLCall(mapped = glMapNamedBufferRange(m_buffer.get(), static_cast<GLintptr>(span_offset),
+                                            static_cast<GLsizeiptr>(span_size), access));
+    }
+    else {
+      GLState::bind_buffer(GL_COPY_WRITE_BUFFER, m_buffer.get());
+      GLCall(mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(span_offset),
+                                       static_cast<GLsizeiptr>(span_size), access));
+    }
+
+    if (mapped) {
+      for (const DirtyRanges::Range& range : dirty) {
+        const std::size_t offset = range.first * element_size;
+        const std::size_t size = range.count * element_size;
+        std::memcpy(static_cast<unsigned char*>(mapped) + (offset - span_offset), bytes + offset, size);
+        if (dsa) {
+          GLCall(glFlushMappedNamedBufferRange(m_buffer.get(), static_cast<GLintptr>(offset - span_offset),
+                                               static_cast<GLsizeiptr>(size)));
+        }
+        else {
+          GLCall(glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset - span_offset),
+                                          static_cast<GLsizeiptr>(size)));
+        }
+        written += size;
+      }
+      if (dsa) {
+        GLCall(glUnmapNamedBuffer(m_buffer.get()));
+      }
+      else {
+        GLCall(glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+      }
+      return written;
+    }
+    std::cerr << "WARNING: Mapping vertex buffer " << m_buffer.get() << " failed, uploading ranges one by one\n";
+  }
+
+  for (const DirtyRanges::Range& range : dirty) {
+    set_sub_data(range.first * element_size, bytes + range.first * element_size, range.count * element_size);
+    written += range.count * element_size;
+  }
+  return written;
+}
+
+void VertexBuffer::release() {
+  BufferPool::get().release(std::move(m_buffer), m_capacity, m_usage);
 }
\ No newline at end of file
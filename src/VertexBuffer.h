@@ -1,13 +1,42 @@
 ﻿#pragma once
 
+#include <cstddef>
+#include <string_view>
+
+#include <GL/glew.h>
+
+#include "DirtyRanges.h"
+#include "GLHandle.h"
+
+// Storage comes from BufferPool, so the capacity may exceed the requested size. Move-only.
 class VertexBuffer {
 public:
-  VertexBuffer(const void* data, unsigned int size);
+  VertexBuffer(const void* data, unsigned int size, std::string_view owner = "VertexBuffer",
+               unsigned int usage = GL_STATIC_DRAW);
   ~VertexBuffer();
 
+  VertexBuffer(VertexBuffer&&) noexcept = default;
+  VertexBuffer& operator=(VertexBuffer&& other) noexcept;
+
   void bind() const;
   void unbind() const;
+
+  // Respecifies the storage; the buffer name, and vertex arrays referencing it, stay valid.
+  void set_data(const void* data, std::size_t size, unsigned int usage);
+  void set_sub_data(std::size_t offset, const void* data, std::size_t size) const;
+  // Copies the coalesced `ranges` of `data`, an array of `element_size` byte elements mirroring the buffer. A few
+  // ranges go out as glBufferSubData, more as writes into one mapped span. Returns the bytes written.
+  std::size_t upload_ranges(const DirtyRanges& ranges, const void* data, std::size_t element_size) const;
+
+  inline unsigned int get_id() const { return m_buffer.get(); }
+  inline std::size_t get_size() const { return m_size; }
+  inline std::size_t get_capacity() const { return m_capacity; }
   
 private:
-  unsigned int m_renderer_id;
+  BufferHandle m_buffer;
+  std::size_t m_size;
+  std::size_t m_capacity;
+  unsigned int m_usage;
+
+  void release();
 };
\ No newline at end of file
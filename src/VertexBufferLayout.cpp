@@ -1,5 +1,11 @@
 ﻿#include "VertexBufferLayout.h"
 
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "vertex_formats.h"
+
 template <>
 void VertexBufferLayout::push<float>(unsigned int count) {
   m_elements.push_back({GL_FLOAT, count, GL_FALSE});
@@ -16,4 +22,35 @@ template <>
 void VertexBufferLayout::push<unsigned char>(unsigned int count) {
   m_elements.push_back({GL_UNSIGNED_BYTE, count, GL_TRUE});
   m_stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_BYTE);
-}
\ No newline at end of file
+}
+
+template <>
+void VertexBufferLayout::push<std::int16_t>(unsigned int count) {
+  m_elements.push_back({GL_SHORT, count, GL_TRUE});
+  m_stride += count * VertexBufferElement::GetSizeOfType(GL_SHORT);
+}
+
+template <>
+void VertexBufferLayout::push<std::uint16_t>(unsigned int count) {
+  m_elements.push_back({GL_UNSIGNED_SHORT, count, GL_TRUE});
+  m_stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_SHORT);
+}
+
+template <>
+void VertexBufferLayout::push<glm::i16vec2>(unsigned int count) {
+  push<std::int16_t>(2 * count);
+}
+
+template <>
+void VertexBufferLayout::push<half>(unsigned int count) {
+  m_elements.push_back({GL_HALF_FLOAT, count, GL_FALSE});
+  m_stride += count * VertexBufferElement::GetSizeOfType(GL_HALF_FLOAT);
+}
+
+template <>
+void VertexBufferLayout::push<packed_10_10_10_2>(unsigned int count) {
+  for (unsigned int i = 0; i < count; ++i) {
+    m_elements.push_back({GL_INT_2_10_10_10_REV, 4, GL_TRUE});
+    m_stride += VertexBufferElement::GetSizeOfType(GL_INT_2_10_10_10_REV);
+  }
+}
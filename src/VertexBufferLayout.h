@@ -15,16 +15,40 @@ struct VertexBufferElement {
     normalized = _normalized;
   }
 
+  // Bytes per component; the packed 10-10-10-2 types hold all four components in these 4 bytes.
   static unsigned int GetSizeOfType(unsigned int type) {
     switch (type) {
     case GL_FLOAT: return 4;
     case GL_UNSIGNED_INT: return 4;
     case GL_UNSIGNED_BYTE: return 1;
+    case GL_SHORT: return 2;
+    case GL_UNSIGNED_SHORT: return 2;
+    case GL_HALF_FLOAT: return 2;
+    case GL_INT_2_10_10_10_REV: return 4;
+    case GL_UNSIGNED_INT_2_10_10_10_REV: return 4;
     }
     return 0;
   }
+
+  static bool IsPackedType(unsigned int type) {
+    return type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV;
+  }
+
+  inline unsigned int get_size() const {
+    return IsPackedType(type) ? GetSizeOfType(type) : count * GetSizeOfType(type);
+  }
 };
 
+/*
+* Vertex buffer layout
+*
+* push<T>(count) appends an attribute of `count` components. Besides
+* float and unsigned int, the compact types from vertex_formats.h are
+* accepted: std::int16_t, std::uint16_t and glm::i16vec2 (normalized to
+* [-1, 1] or [0, 1]), half, and packed_10_10_10_2 (one vec4 per count).
+* unsigned char is normalized as well, for RGBA8 colors.
+*/
+
 class VertexBufferLayout {
 public:
   VertexBufferLayout() : m_stride{0} {}
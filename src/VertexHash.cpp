@@ -0,0 +1,156 @@
+﻿#include "VertexHash.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "util.h"
+
+namespace {
+  constexpr std::size_t INITIAL_CAPACITY = 64;
+  // Cell coordinates are clamped to +-MAX_CELL, then biased by BIAS.
+  constexpr float MAX_CELL = 1073741824.0f; // 2^30
+  constexpr std::uint32_t BIAS = 0x80000000u;
+}
+
+VertexHash::VertexHash(const float cell_size)
+  : m_cell_size(cell_size), m_inverse_cell_size(1.0f / cell_size), m_mask(0), m_cells_used(0), m_size(0) {
+  clear();
+}
+
+void VertexHash::insert(const std::uint32_t item, const glm::vec2& position) {
+  if (item >= m_items.size()) m_items.resize(std::max<std::size_t>(item + 1, m_items.size() * 2));
+  Entry& entry = m_items[item];
+  if (entry.cell != EMPTY) return;
+  entry.position = position;
+  entry.cell = cell_of(position);
+  link(item);
+  ++m_size;
+}
+
+void VertexHash::update(const std::uint32_t item, const glm::vec2& position) {
+  if (item >= m_items.size() || m_items[item].cell == EMPTY) {
+    insert(item, position);
+    return;
+  }
+  Entry& entry = m_items[item];
+  entry.position = position;
+  const std::uint64_t cell = cell_of(position);
+  if (cell == entry.cell) return;
+  unlink(item);
+  entry.cell = cell;
+  link(item);
+}
+
+void VertexHash::remove(const std::uint32_t item) {
+  if (item >= m_items.size() || m_items[item].cell == EMPTY) return;
+  unlink(item);
+  m_items[item] = {};
+  --m_size;
+}
+
+void VertexHash::clear() {
+  m_items.clear();
+  m_cell_keys.assign(INITIAL_CAPACITY, EMPTY);
+  m_cell_heads.assign(INITIAL_CAPACITY, NONE);
+  m_mask = INITIAL_CAPACITY - 1;
+  m_cells_used = 0;
+  m_size = 0;
+}
+
+std::uint32_t VertexHash::find_nearest(const glm::vec2& position, const float radius) const {
+  std::uint32_t nearest = NONE;
+  float nearest_distance = 0.0f;
+  for_each_near(position, radius, [&](const std::uint32_t item, const float distance_squared) {
+    if (nearest == NONE || distance_squared < nearest_distance ||
+        (distance_squared == nearest_distance && item > nearest)) {
+      nearest = item;
+      nearest_distance = distance_squared;
+    }
+  });
+  return nearest;
+}
+
+std::size_t VertexHash::size() const {
+  return m_size;
+}
+
+std::size_t VertexHash::get_cell_count() const {
+  return m_cells_used;
+}
+
+float VertexHash::get_cell_size() const {
+  return m_cell_size;
+}
+
+std::uint32_t VertexHash::cell_coordinate(const float value) const {
+  const float cell = std::clamp(std::floor(value * m_inverse_cell_size), -MAX_CELL, MAX_CELL);
+  return static_cast<std::uint32_t>(static_cast<std::int32_t>(cell)) + BIAS;
+}
+
+std::uint64_t VertexHash::cell_of(const glm::vec2& position) const {
+  return static_cast<std::uint64_t>(cell_coordinate(position.x)) << 32 | cell_coordinate(position.y);
+}
+
+std::size_t VertexHash::find_slot(const std::uint64_t key) const {
+  std::size_t slot = hash_key(key) & m_mask;
+  while (m_cell_keys[slot] != EMPTY && m_cell_keys[slot] != key) slot = (slot + 1) & m_mask;
+  return slot;
+}
+
+std::uint32_t VertexHash::head_of(const std::uint64_t key) const {
+  const std::size_t slot = find_slot(key);
+  return m_cell_keys[slot] == key ? m_cell_heads[slot] : NONE;
+}
+
+void VertexHash::link(const std::uint32_t item) {
+  Entry& entry = m_items[item];
+  std::size_t slot = find_slot(entry.cell);
+  if (m_cell_keys[slot] == EMPTY) {
+    // Growing also drops the cells that emptied out, so keep the table at most half used.
+    if ((m_cells_used + 1) * 2 > m_cell_keys.size()) {
+      rehash(m_cell_keys.size() * 2);
+      slot = find_slot(entry.cell);
+    }
+    if (m_cell_keys[slot] == EMPTY) {
+      m_cell_keys[slot] = entry.cell;
+      m_cell_heads[slot] = NONE;
+      ++m_cells_used;
+    }
+  }
+  entry.previous = NONE;
+  entry.next = m_cell_heads[slot];
+  if (entry.next != NONE) m_items[entry.next].previous = item;
+  m_cell_heads[slot] = item;
+}
+
+void VertexHash::unlink(const std::uint32_t item) {
+  const Entry& entry = m_items[item];
+  if (entry.previous != NONE) m_items[entry.previous].next = entry.next;
+  else m_cell_heads[find_slot(entry.cell)] = entry.next;
+  if (entry.next != NONE) m_items[entry.next].previous = entry.previous;
+}
+
+void VertexHash::rehash(std::size_t capacity) {
+  std::vector<std::uint64_t> keys = std::move(m_cell_keys);
+  std::vector<std::uint32_t> heads = std::move(m_cell_heads);
+
+  // Only occupied cells move over; size for them, not for the empty ones being dropped.
+  std::size_t occupied = 0;
+  for (std::size_t slot = 0; slot < keys.size(); ++slot) {
+    if (keys[slot] != EMPTY && heads[slot] != NONE) ++occupied;
+  }
+  while (occupied * 2 >= capacity) capacity *= 2;
+  while (capacity > INITIAL_CAPACITY && occupied * 4 < capacity) capacity /= 2;
+
+  m_cell_keys.assign(capacity, EMPTY);
+  m_cell_heads.assign(capacity, NONE);
+  m_mask = capacity - 1;
+  m_cells_used = 0;
+  for (std::size_t slot = 0; slot < keys.size(); ++slot) {
+    if (keys[slot] == EMPTY || heads[slot] == NONE) continue;
+    const std::size_t target = find_slot(keys[slot]);
+    m_cell_keys[target] = keys[slot];
+    m_cell_heads[target] = heads[slot];
+    ++m_cells_used;
+  }
+}
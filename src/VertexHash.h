@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*
+* Vertex hash
+*
+* Uniform grid over points, stored sparsely: an open-addressed table
+* maps each occupied cell to an intrusive list of the items in it, so
+* insert, move and remove are O(1) and a radius query only visits the
+* cells the circle's box touches. With a cell size close to the usual
+* query radius that is at most four cells. Items are small dense ids
+* (Scene uses slot index * 3 + corner). Cells that empty out stay in
+* the table until the next growth drops them.
+*/
+class VertexHash {
+public:
+  static constexpr float DEFAULT_CELL_SIZE = 0.5f;
+  static constexpr std::uint32_t NONE = 0xFFFFFFFFu;
+
+  explicit VertexHash(float cell_size = DEFAULT_CELL_SIZE);
+
+  void insert(std::uint32_t item, const glm::vec2& position);
+  // Inserts items that are not in the hash yet.
+  void update(std::uint32_t item, const glm::vec2& position);
+  void remove(std::uint32_t item);
+  void clear();
+
+  // Calls visit(item, squared distance) for every item within `radius` of `position`, inclusive, in no particular
+  // order.
+  template <typename Visit>
+  void for_each_near(const glm::vec2& position, float radius, const Visit& visit) const;
+  // Nearest item within `radius`, or NONE; ties go to the higher item.
+  [[nodiscard]] std::uint32_t find_nearest(const glm::vec2& position, float radius) const;
+
+  [[nodiscard]] std::size_t size() const;
+  [[nodiscard]] std::size_t get_cell_count() const;
+  [[nodiscard]] float get_cell_size() const;
+
+private:
+  // Cell coordinates are biased to be positive, so key 0 never names a cell.
+  static constexpr std::uint64_t EMPTY = 0;
+
+  struct Entry {
+    glm::vec2 position;
+    std::uint64_t cell = EMPTY; // EMPTY while the item is not in the hash
+    std::uint32_t next = NONE;
+    std::uint32_t previous = NONE;
+  };
+
+  float m_cell_size;
+  float m_inverse_cell_size;
+  std::vector<Entry> m_items;
+  std::vector<std::uint64_t> m_cell_keys;
+  std::vector<std::uint32_t> m_cell_heads;
+  std::size_t m_mask;
+  std::size_t m_cells_used;
+  std::size_t m_size;
+
+  [[nodiscard]] std::uint32_t cell_coordinate(float value) const;
+  [[nodiscard]] std::uint64_t cell_of(const glm::vec2& position) const;
+  // Table slot of `key`, or the empty slot where it would go.
+  [[nodiscard]] std::size_t find_slot(std::uint64_t key) const;
+  [[nodiscard]] std::uint32_t head_of(std::uint64_t key) const;
+  void link(std::uint32_t item);
+  void unlink(std::uint32_t item);
+  void rehash(std::size_t capacity);
+};
+
+template <typename Visit>
+void VertexHash::for_each_near(const glm::vec2& position, const float radius, const Visit& visit) const {
+  if (m_size == 0) return;
+  const float radius_squared = radius * radius;
+  const auto visit_list = [&](std::uint32_t item) {
+    for (; item != NONE; item = m_items[item].next) {
+      const glm::vec2 offset = m_items[item].position - position;
+      const float distance_squared = offset.x * offset.x + offset.y * offset.y;
+      if (distance_squared <= radius_squared) visit(item, distance_squared);
+    }
+  };
+
+  const std::uint32_t x_first = cell_coordinate(position.x - radius);
+  const std::uint32_t x_last = cell_coordinate(position.x + radius);
+  const std::uint32_t y_first = cell_coordinate(position.y - radius);
+  const std::uint32_t y_last = cell_coordinate(position.y + radius);
+  // A radius spanning more cells than are occupied is cheaper to answer from the table itself.
+  if (static_cast<double>(x_last - x_first + 1) * static_cast<double>(y_last - y_first + 1) >
+      static_cast<double>(m_cells_used)) {
+    for (std::size_t slot = 0; slot < m_cell_keys.size(); ++slot) {
+      if (m_cell_keys[slot] != EMPTY) visit_list(m_cell_heads[slot]);
+    }
+    return;
+  }
+  for (std::uint32_t y = y_first; y <= y_last; ++y) {
+    for (std::uint32_t x = x_first; x <= x_last; ++x) {
+      visit_list(head_of(static_cast<std::uint64_t>(x) << 32 | y));
+    }
+  }
+}
@@ -0,0 +1,135 @@
+﻿#include "VertexWelder.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include "scoped_timer.h"
+#include "util.h"
+
+namespace {
+  constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+  constexpr float MIN_CELL_SIZE = 1e-6f;
+  // Cell coordinates are clamped to +-MAX_CELL, so the neighbour offsets below cannot overflow.
+  constexpr float MAX_CELL = 1073741824.0f; // 2^30
+
+  // fmax/fmin rather than std::clamp so a NaN coordinate lands on a valid cell instead of an undefined conversion.
+  std::int32_t cell_coordinate(const float value, const float cell_size) {
+    return static_cast<std::int32_t>(std::fmin(std::fmax(std::floor(value / cell_size), -MAX_CELL), MAX_CELL));
+  }
+
+  std::uint64_t cell_key(const std::int32_t x, const std::int32_t y) {
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(y);
+  }
+}
+
+void VertexWelder::CellTable::reset(const std::size_t expected) {
+  const std::size_t capacity = std::bit_ceil(std::max<std::size_t>(expected * 2, 16));
+  keys.assign(capacity, 0);
+  heads.assign(capacity, NONE);
+  tails.assign(capacity, NONE);
+  mask = capacity - 1;
+}
+
+std::uint32_t VertexWelder::CellTable::append(const std::uint64_t key, const std::uint32_t vertex) {
+  for (std::size_t slot = hash_key(key) & mask;; slot = (slot + 1) & mask) {
+    if (heads[slot] == NONE) {
+      keys[slot] = key;
+      heads[slot] = tails[slot] = vertex;
+      return NONE;
+    }
+    if (keys[slot] == key) return std::exchange(tails[slot], vertex);
+  }
+}
+
+std::uint32_t VertexWelder::CellTable::find(const std::uint64_t key) const {
+  for (std::size_t slot = hash_key(key) & mask;; slot = (slot + 1) & mask) {
+    if (heads[slot] == NONE) return NONE;
+    if (keys[slot] == key) return heads[slot];
+  }
+}
+
+std::size_t VertexWelder::weld(const std::span<const glm::vec2> vertices, const float epsilon) {
+  HG_SCOPED_TIMER("VertexWelder::weld");
+  const std::size_t count = vertices.size();
+  const float cell_size = std::max(epsilon, MIN_CELL_SIZE);
+  const float epsilon_squared = epsilon * epsilon;
+
+  const std::size_t workers = count < PARALLEL_THRESHOLD
+    ? 1
+    : std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, count / PARALLEL_THRESHOLD + 1);
+  const auto slice = [&](const std::size_t worker) {
+    return std::pair{count * worker / workers, count * (worker + 1) / workers};
+  };
+
+  // Cell of every vertex, split by index range.
+  m_cells.resize(count);
+  run_parallel(workers, [&](const std::size_t worker) {
+    const auto [first, last] = slice(worker);
+    for (std::size_t i = first; i < last; ++i) {
+      m_cells[i] = cell_key(cell_coordinate(vertices[i].x, cell_size), cell_coordinate(vertices[i].y, cell_size));
+    }
+  });
+
+  // Cell lists, split by cell hash: each worker owns one table and scans all vertices in order, so it alone links
+  // the vertices of its cells and every list comes out ascending.
+  m_tables.resize(workers);
+  m_next.assign(count, NONE);
+  run_parallel(workers, [&](const std::size_t worker) {
+    CellTable& table = m_tables[worker];
+    table.reset(count / workers);
+    for (std::size_t i = 0; i < count; ++i) {
+      if (hash_key(m_cells[i]) % workers != worker) continue;
+      const std::uint32_t previous = table.append(m_cells[i], static_cast<std::uint32_t>(i));
+      if (previous != NONE) m_next[previous] = static_cast<std::uint32_t>(i);
+    }
+  });
+
+  // Lowest vertex within epsilon among the 3x3 neighbouring cells, or the vertex itself.
+  m_matches.resize(count);
+  run_parallel(workers, [&](const std::size_t worker) {
+    const auto [first, last] = slice(worker);
+    for (std::size_t i = first; i < last; ++i) {
+      const auto x = static_cast<std::int32_t>(m_cells[i] >> 32);
+      const auto y = static_cast<std::int32_t>(m_cells[i] & 0xFFFFFFFFu);
+      auto match = static_cast<std::uint32_t>(i);
+      for (std::int32_t dy = -1; dy <= 1; ++dy) {
+        for (std::int32_t dx = -1; dx <= 1; ++dx) {
+          const std::uint64_t key = cell_key(x + dx, y + dy);
+          // Lists are ascending, so the walk stops at the first vertex that could not lower the match.
+          for (std::uint32_t candidate = m_tables[hash_key(key) % workers].find(key); candidate < match;
+               candidate = m_next[candidate]) {
+            const glm::vec2 delta = vertices[candidate] - vertices[i];
+            if (delta.x * delta.x + delta.y * delta.y <= epsilon_squared) match = candidate;
+          }
+        }
+      }
+      m_matches[i] = match;
+    }
+  });
+
+  // Matches always point backwards, so one pass in input order numbers the unique vertices.
+  m_positions.clear();
+  m_indices.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    if (m_matches[i] == i) {
+      m_indices[i] = static_cast<std::uint32_t>(m_positions.size());
+      m_positions.push_back(vertices[i]);
+    }
+    else {
+      m_indices[i] = m_indices[m_matches[i]];
+    }
+  }
+  return m_positions.size();
+}
+
+const std::vector<glm::vec2>& VertexWelder::get_positions() const {
+  return m_positions;
+}
+
+const std::vector<std::uint32_t>& VertexWelder::get_indices() const {
+  return m_indices;
+}
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*
+* Vertex welder
+*
+* Turns a triangle soup into indexed geometry: vertices closer than
+* epsilon collapse into the lowest-numbered one among them. Positions
+* are hashed into a grid of epsilon-sized cells, each listing its
+* vertices in input order, and each vertex checks every earlier vertex
+* of its own and the eight neighbouring cells. Both the hashing and the
+* lookups run on worker threads; the numbering
+* follows the input order, so the result does not depend on the thread
+* count. Buffers are reused between calls.
+*/
+class VertexWelder {
+public:
+  static constexpr float DEFAULT_EPSILON = 1e-4f;
+  // Below this many vertices a single thread is faster than starting workers.
+  static constexpr std::size_t PARALLEL_THRESHOLD = 32 * 1024;
+
+  // Returns the number of unique vertices.
+  std::size_t weld(std::span<const glm::vec2> vertices, float epsilon = DEFAULT_EPSILON);
+
+  // Unique positions in order of first appearance.
+  [[nodiscard]] const std::vector<glm::vec2>& get_positions() const;
+  // One per input vertex, into get_positions().
+  [[nodiscard]] const std::vector<std::uint32_t>& get_indices() const;
+
+private:
+  // Open-addressed map from cell key to the first and last vertex of that cell's list.
+  struct CellTable {
+    std::vector<std::uint64_t> keys;
+    std::vector<std::uint32_t> heads;
+    std::vector<std::uint32_t> tails;
+    std::size_t mask = 0;
+
+    void reset(std::size_t expected);
+    // Returns the cell's previous last vertex, or NONE for a new cell.
+    std::uint32_t append(std::uint64_t key, std::uint32_t vertex);
+    [[nodiscard]] std::uint32_t find(std::uint64_t key) const;
+  };
+
+  std::vector<glm::vec2> m_positions;
+  std::vector<std::uint32_t> m_indices;
+  std::vector<std::uint64_t> m_cells;
+  // Next vertex in the same cell, in input order.
+  std::vector<std::uint32_t> m_next;
+  std::vector<std::uint32_t> m_matches;
+  std::vector<CellTable> m_tables;
+};
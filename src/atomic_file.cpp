@@ -0,0 +1,68 @@
+﻿#include "atomic_file.h"
+
+#include "platform.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifdef HERON_PLATFORM_WINDOWS
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  bool fail(std::string* error, const std::string& message) {
+    if (error) *error = message;
+    return false;
+  }
+
+  bool sync_file(std::FILE* file) {
+    if (std::fflush(file) != 0) return false;
+#ifdef HERON_PLATFORM_WINDOWS
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+  }
+
+  void sync_directory(const std::filesystem::path& path) {
+#ifndef HERON_PLATFORM_WINDOWS
+    // Persist the rename itself; best effort, some filesystems refuse fsync on directories.
+    const std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path{"."};
+    const int fd = open(directory.c_str(), O_RDONLY);
+    if (fd != -1) {
+      fsync(fd);
+      close(fd);
+    }
+#endif
+  }
+}
+
+bool write_file_atomic(const std::string& filename, const std::string_view contents, std::string* error) {
+  const std::string temp_filename = filename + ".tmp";
+
+  std::FILE* file = std::fopen(temp_filename.c_str(), "wb");
+  if (!file) return fail(error, "cannot open " + temp_filename + ": " + std::strerror(errno));
+
+  const bool written = std::fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+  const bool synced = written && sync_file(file);
+  const bool closed = std::fclose(file) == 0;
+  if (!written || !synced || !closed) {
+    std::remove(temp_filename.c_str());
+    return fail(error, "cannot write " + temp_filename + ": " + std::strerror(errno));
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(temp_filename, filename, ec);
+  if (ec) {
+    std::remove(temp_filename.c_str());
+    return fail(error, "cannot rename " + temp_filename + ": " + ec.message());
+  }
+
+  sync_directory(filename);
+  return true;
+}
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+
+// Writes `contents` to `filename` so that readers only ever see the old or the new file:
+// data goes to `filename.tmp`, is flushed and fsync'ed, then renamed over the target.
+bool write_file_atomic(const std::string& filename, std::string_view contents, std::string* error = nullptr);
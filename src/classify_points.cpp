@@ -0,0 +1,101 @@
+﻿#include "classify_points.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "TriangleBvh.h"
+#include "geometry.h"
+#include "scene_generator.h"
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  // Results checked against a linear scan over every triangle.
+  constexpr std::size_t VERIFY_SAMPLES = 1000;
+
+  double elapsed_ms(const clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  }
+
+  // Last (topmost) triangle containing the point, as TriangleBvh::find_topmost() answers it.
+  std::uint32_t find_topmost_linear(const std::vector<glm::vec2>& corners, const glm::vec2& point) {
+    for (std::size_t triangle = corners.size() / 3; triangle-- > 0;) {
+      if (point_in_triangle(std::span<const glm::vec2, 3>(&corners[triangle * 3], 3), point)) {
+        return static_cast<std::uint32_t>(triangle);
+      }
+    }
+    return TriangleBvh::NONE;
+  }
+}
+
+int run_classify_points(const ClassifyPointsOptions& options) {
+  constexpr float extent = 100.0f;
+  const std::vector<glm::vec2> corners = generate_random_triangles(options.triangles, options.seed, extent);
+
+  // Separate stream from the triangles, so the same seed gives the same points for any triangle count.
+  std::mt19937_64 rng(options.seed ^ 0x9E3779B97F4A7C15ull);
+  std::uniform_real_distribution<float> coordinate(-extent, extent);
+  std::vector<glm::vec2> points(options.points);
+  for (glm::vec2& point : points) point = {coordinate(rng), coordinate(rng)};
+
+  const auto build_start = clock::now();
+  TriangleBvh bvh;
+  bvh.build(corners);
+  const double build_ms = elapsed_ms(build_start);
+
+  std::vector<std::uint32_t> results(points.size());
+  const auto classify_start = clock::now();
+  bvh.classify(points, results);
+  const double classify_ms = elapsed_ms(classify_start);
+
+  const std::size_t hits = results.size() -
+    static_cast<std::size_t>(std::count(results.begin(), results.end(), TriangleBvh::NONE));
+
+  const std::size_t stride = std::max<std::size_t>(points.size() / VERIFY_SAMPLES, 1);
+  std::size_t verified = 0;
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < points.size(); i += stride) {
+    ++verified;
+    if (results[i] != find_topmost_linear(corners, points[i])) ++mismatches;
+  }
+
+  const nlohmann::json report = {
+    {"points", points.size()},
+    {"triangles", options.triangles},
+    {"seed", options.seed},
+    {"bvh_nodes", bvh.get_node_count()},
+    {"build_ms", build_ms},
+    {"classify_ms", classify_ms},
+    {"points_per_second", classify_ms > 0.0 ? static_cast<double>(points.size()) * 1000.0 / classify_ms : 0.0},
+    {"hits", hits},
+    {"verified", verified},
+    {"mismatches", mismatches}
+  };
+
+  const int result = mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  if (mismatches > 0) {
+    std::cerr << "ERROR: " << mismatches << " of " << verified << " sampled points disagree with a linear scan\n";
+  }
+
+  if (options.json_path.empty()) {
+    std::cout << report.dump(2) << '\n';
+    return result;
+  }
+
+  std::ofstream file(options.json_path);
+  file << report.dump(2) << '\n';
+  if (!file) {
+    std::cerr << "ERROR: Failed to write " << options.json_path << '\n';
+    return EXIT_FAILURE;
+  }
+  std::cout << "INFO: Wrote point classification report to " << options.json_path << '\n';
+  return result;
+}
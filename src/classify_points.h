@@ -0,0 +1,16 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct ClassifyPointsOptions {
+  std::size_t points = 0;
+  std::size_t triangles = 100000;
+  std::uint64_t seed = 1;
+  std::string json_path; // stdout when empty
+};
+
+// Builds a TriangleBvh over a generated scene, classifies random points against it and reports timings as JSON,
+// with a brute-force check of a sample of the results. Needs no window or GL context.
+int run_classify_points(const ClassifyPointsOptions& options);
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+constexpr float grid_size = 1.0f;
+constexpr float snap_threshold = 0.2f;
+constexpr float pick_radius = 0.3f;
+constexpr float pick_radius_squared = 0.09f;
+
+inline float distance_squared(const glm::vec2& a, const glm::vec2& b) {
+  const glm::vec2 diff = a - b;
+  return diff.x * diff.x + diff.y * diff.y;
+}
+
+inline glm::vec2 snap_to_grid(const glm::vec2& position) {
+  glm::vec2 snapped_position = position;
+
+  const float grid_x = round(position.x / grid_size) * grid_size;
+  const float grid_y = round(position.y / grid_size) * grid_size;
+
+  if (fabs(position.x - grid_x) < snap_threshold) {
+    snapped_position.x = grid_x;
+  }
+
+  if (fabs(position.y - grid_y) < snap_threshold) {
+    snapped_position.y = grid_y;
+  }
+
+  return snapped_position;
+}
+
+inline glm::vec2 screen_to_world(const Camera& cam, const glm::vec2& window_size, const glm::vec2& mouse_pos) {
+  const glm::vec2& cam_pos = cam.get_position();
+  const float zoom = cam.get_zoom();
+
+  const double ndc_x = 2.0f * mouse_pos.x / window_size.x - 1.0f;
+  const double ndc_y = 1.0f - (2.0f * mouse_pos.y) / window_size.y;
+
+  const double world_x = ndc_x * (10.0f * zoom) * (static_cast<float>(window_size.x) / static_cast<float>(window_size.
+      y))
+    + cam_pos.x;
+  const double world_y = ndc_y * (10.0f * zoom) + cam_pos.y;
+
+  return {
+    world_x,
+    world_y
+  };
+}
+
+inline glm::vec2 world_to_screen(const Camera& cam, const glm::vec2& window_size, const glm::vec2& world_pos) {
+  const glm::vec2& cam_pos = cam.get_position();
+  const float zoom = cam.get_zoom();
+
+  const float ndc_x = (world_pos.x - cam_pos.x) / (10.0f * zoom * (window_size.x / window_size.y));
+  const float ndc_y = (world_pos.y - cam_pos.y) / (10.0f * zoom);
+
+  return {
+    (ndc_x + 1.0f) * 0.5f * window_size.x,
+    (1.0f - ndc_y) * 0.5f * window_size.y
+  };
+}
+
+// Returns the index of the first vertex within the pick radius of position, or -1.
+inline int pick_vertex(const std::span<const glm::vec2> vertices, const glm::vec2& position) {
+  for (int i = 0; i < static_cast<int>(vertices.size()); ++i) {
+    if (distance_squared(position, vertices[i]) < pick_radius_squared) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Closest point to `position` on the segment from a to b.
+inline glm::vec2 closest_point_on_segment(const glm::vec2& a, const glm::vec2& b, const glm::vec2& position) {
+  const glm::vec2 ab = b - a;
+  const float length_squared = ab.x * ab.x + ab.y * ab.y;
+  if (length_squared == 0.0f) return a;
+  const float t = ((position.x - a.x) * ab.x + (position.y - a.y) * ab.y) / length_squared;
+  return a + ab * std::clamp(t, 0.0f, 1.0f);
+}
+
+// Inclusive point-in-triangle test, independent of winding order.
+inline bool point_in_triangle(const std::span<const glm::vec2, 3> vertices, const glm::vec2& position) {
+  const auto edge = [&](const glm::vec2& a, const glm::vec2& b) {
+    return (b.x - a.x) * (position.y - a.y) - (b.y - a.y) * (position.x - a.x);
+  };
+  const float d0 = edge(vertices[0], vertices[1]);
+  const float d1 = edge(vertices[1], vertices[2]);
+  const float d2 = edge(vertices[2], vertices[0]);
+  const bool has_negative = d0 < 0.0f || d1 < 0.0f || d2 < 0.0f;
+  const bool has_positive = d0 > 0.0f || d1 > 0.0f || d2 > 0.0f;
+  return !(has_negative && has_positive);
+}
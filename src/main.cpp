@@ -1,22 +1,36 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <charconv>
+#include <string_view>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
-#include "Triangle.h"
+#include "Scene.h"
 #include "Renderer.h"
+#include "AllocTracker.h"
+#include "BufferPool.h"
+#include "FrameArena.h"
+#include "GLState.h"
+#include "GpuResources.h"
+#include "FramePacer.h"
 #include "scoped_timer.h"
 #include "style.h"
-#include <chrono>
-#include <thread>
+#include <iostream>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "AutoSaver.h"
 #include "Camera.h"
+#include "EditJournal.h"
+#include "InputQueue.h"
+#include "LatencyTracker.h"
+#include "classify_points.h"
+#include "geometry.h"
 #include "heron.h"
+#include "render_bench.h"
 #include "saves.h"
 #include "stb_image_write.h"
 
@@ -35,93 +49,103 @@ void save_framebuffer_to_image(const char* filename, int width, int height) {
   stbi_write_png(filename, width, height, 3, flippedPixels.data(), width * 3);
 }
 
-const int TARGET_FPS = 60;
-const int FRAME_TIME = 1000 / TARGET_FPS;
-
-constexpr float grid_size = 1.0f;
-constexpr float snap_threshold = 0.2f;
-
-float distance_squared(const glm::vec2& a, const glm::vec2& b) {
-  const glm::vec2 diff = a - b;
-  return diff.x * diff.x + diff.y * diff.y;
-}
-
 int max_fps = 60;
 bool unlock_fps = true;
 
-void limit_fps(int target_fps, bool unlock) {
-  static auto last_frame_time = std::chrono::high_resolution_clock::now();
-
-  if (!unlock) {
-    int frame_time_ms = 1000 / target_fps;
-    auto current_time = std::chrono::high_resolution_clock::now();
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - last_frame_time).count();
-
-    if (elapsed_time < frame_time_ms) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(frame_time_ms - elapsed_time));
-    }
-
-    last_frame_time = std::chrono::high_resolution_clock::now();
-  }
-  else {
-    last_frame_time = std::chrono::high_resolution_clock::now();
-  }
-}
-
-
-glm::vec2 snap_to_grid(const glm::vec2& position) {
-  glm::vec2 snapped_position = position;
-
-  const float grid_x = round(position.x / grid_size) * grid_size;
-  const float grid_y = round(position.y / grid_size) * grid_size;
-
-  if (fabs(position.x - grid_x) < snap_threshold) {
-    snapped_position.x = grid_x;
-  }
-
-  if (fabs(position.y - grid_y) < snap_threshold) {
-    snapped_position.y = grid_y;
-  }
-
-  return snapped_position;
-}
-
 int window_width = 1000, window_height = 800;
 
 bool isRightMousePressed = false;
+bool isUndoPressed = false;
+bool isRedoPressed = false;
 double lastMouseX, lastMouseY;
 
 bool dragging_vertex = false;
-int selected_vertex = -1;
-
-static glm::vec2 screen_to_world(const Camera& cam, const glm::vec2& window_size, const glm::vec2& mouse_pos) {
-  const glm::vec2& cam_pos = cam.get_position();
-  const float zoom = cam.get_zoom();
-
-  const double ndc_x = 2.0f * mouse_pos.x / window_size.x - 1.0f;
-  const double ndc_y = 1.0f - (2.0f * mouse_pos.y) / window_size.y;
-
-  const double world_x = ndc_x * (10.0f * zoom) * (static_cast<float>(window_size.x) / static_cast<float>(window_size.
-      y))
-    + cam_pos.x;
-  const double world_y = ndc_y * (10.0f * zoom) + cam_pos.y;
-
-  return {
-    world_x,
-    world_y
-  };
-}
+VertexRef dragged_vertex;
+// dragged_vertex plus, with drag_welded_vertices, every corner welded to it.
+std::vector<VertexRef> dragged_vertices;
+bool drag_welded_vertices = true;
+// Objects owning dragged_vertices; drags do not snap to them.
+std::vector<ObjectId> dragged_objects;
+bool snap_to_vertices = true;
+bool snap_to_edges = true;
+ObjectId selected_object;
+// Topmost triangle under the cursor while idle.
+ObjectId hovered_object;
+// Shift+drag selects every triangle the box touches.
+bool box_selecting = false;
+glm::vec2 box_start, box_end;
+std::vector<ObjectId> box_selection;
+// Outlines past this many selected triangles are not drawn.
+constexpr std::size_t MAX_OUTLINED_TRIANGLES = 16384;
 
 void framebuffer_size_callback(GLFWwindow* window, const int width, const int height) {
   window_width = width;
   window_height = height;
-  glViewport(0, 0, window_width, window_height);
+  GLState::viewport(0, 0, window_width, window_height);
+}
+
+void print_usage() {
+  std::cout << "Usage: HeronTriangle [--bench-render <triangles>] [--frames <n>] [--seed <n>] [--json <out.json>]\n"
+    "       HeronTriangle --zero-alloc-test <frames> [--warmup <frames>]\n"
+    "       HeronTriangle --classify-points <count> [--triangles <n>] [--seed <n>] [--json <out.json>]\n";
+}
+
+// Whole argument as an unsigned number; false on signs, trailing characters or overflow.
+template <typename T>
+bool parse_unsigned(const std::string_view text, T& value) {
+  const char* end = text.data() + text.size();
+  const auto [last, error] = std::from_chars(text.data(), end, value);
+  return error == std::errc{} && last == end;
 }
 
-int main() {
+int main(int argc, char** argv) {
+  bool bench_render = false;
+  RenderBenchOptions bench_options;
+  std::size_t zero_alloc_frames = 0;
+  std::size_t warmup_frames = 120;
+  bool classify_points = false;
+  ClassifyPointsOptions classify_options;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    bool valid = true;
+    if (arg == "--bench-render" && has_value) {
+      bench_render = true;
+      valid = parse_unsigned(argv[++i], bench_options.triangles);
+    }
+    else if (arg == "--frames" && has_value) valid = parse_unsigned(argv[++i], bench_options.frames);
+    else if (arg == "--seed" && has_value) {
+      valid = parse_unsigned(argv[++i], bench_options.seed);
+      classify_options.seed = bench_options.seed;
+    }
+    else if (arg == "--json" && has_value) bench_options.json_path = classify_options.json_path = argv[++i];
+    else if (arg == "--zero-alloc-test" && has_value) valid = parse_unsigned(argv[++i], zero_alloc_frames);
+    else if (arg == "--warmup" && has_value) valid = parse_unsigned(argv[++i], warmup_frames);
+    else if (arg == "--classify-points" && has_value) {
+      classify_points = true;
+      valid = parse_unsigned(argv[++i], classify_options.points);
+    }
+    else if (arg == "--triangles" && has_value) valid = parse_unsigned(argv[++i], classify_options.triangles);
+    else valid = false;
+
+    if (!valid) {
+      // argv[i] is the bad value, or the flag itself when it is unknown or misses its value.
+      std::cerr << "ERROR: Invalid argument '" << argv[i] << "'\n";
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (zero_alloc_frames > 0 && !AllocTracker::is_available()) {
+    std::cerr << "ERROR: --zero-alloc-test needs a build with HERON_TRACK_ALLOCATIONS=ON\n";
+    return EXIT_FAILURE;
+  }
+
   std::cout << "HeronTriangle v1.0.1 created by Tymon Wozniak (https://github.com/Moderrek)\nRunning on " 
     << HERON_PLATFORM_NAME << '-' << HERON_MODE << '\n';
 
+  if (classify_points) return run_classify_points(classify_options);
+
   if (!glfwInit()) {
     std::cerr << "FATAL: Failed to initialize GLFW\n";
     return -1;
@@ -130,6 +154,7 @@ int main() {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  if (bench_render) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
   std::cout << "INFO: Initialized GLFW\n";
 
@@ -156,10 +181,23 @@ int main() {
   std::cout << "Renderer: " << glGetString(GL_RENDERER) << '\n';
   std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << '\n';
 
+  if (bench_render) {
+    const int result = run_render_bench(window, bench_options);
+    BufferPool::get().clear();
+    GpuResources::report_leaks();
+    glfwTerminate();
+    return result;
+  }
+
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
   glfwSwapInterval(0);
 
+  // Our callbacks go in before ImGui's, which then chains to them.
+  InputQueue input_queue;
+  input_queue.install(window);
+  Camera::setup_scroll(window);
+
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
   ImGui_ImplGlfw_InitForOpenGL(window, true);
@@ -168,21 +206,26 @@ int main() {
   setup_im_gui_fonts();
   std::cout << "INFO: Created ImGui Context\n";
 
+  int exit_code = EXIT_SUCCESS;
   {
-    Triangle triangle(3.0f, 4.0f, 5.0f);
+    Scene scene;
+    selected_object = scene.add_triangle(Triangle(3.0f, 4.0f, 5.0f).get_vertices());
     Renderer renderer;
     renderer.init();
     std::cout << "INFO: Initialized renderer\n";
 
     glm::vec2 window_size = {window_width, window_height};
     Camera camera{window_size, {0, 0}};
-    Camera::setup_scroll(window);
 
     auto background_color = glm::vec4(0.98f, 0.98f, 0.98f, 1.0f);
     auto grid_color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-    auto triangle_color = glm::vec4(0.0f, 0.16f, 1.0f, 1.0f);
     auto triangle_vertex_color = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
     auto triangle_vertex_selected_color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    auto hover_outline_color = glm::vec4(1.0f, 0.6f, 0.0f, 1.0f);
+    auto selection_outline_color = glm::vec4(0.1f, 0.4f, 1.0f, 1.0f);
+    // Scratch for outline endpoints and box query results, reused every frame.
+    std::vector<glm::vec2> outline_endpoints;
+    std::vector<std::uint32_t> box_indices;
 
     auto grid_model = glm::mat4(1.0f);
     auto triangle_model = glm::mat4(1.0f);
@@ -195,11 +238,127 @@ int main() {
     bool want_vsync = true;
     bool is_vsync = false;
 
+    FramePacer frame_pacer;
+
+    AutoSaver autosaver{"scene.json"};
+    bool autosave_enabled = autosaver.is_enabled();
+    SceneLoader scene_loader;
+    EditJournal journal;
+    LatencyTracker latency;
+    bool use_timerfd = frame_pacer.is_using_timerfd();
+    bool raw_mouse_motion = input_queue.is_raw_motion_enabled();
+
+    const auto drag_to = [&](const glm::vec2& world_pos, const std::int64_t event_ns) {
+      // Other triangles' corners first, then their edges, then the grid.
+      glm::vec2 after = snap_to_grid(world_pos);
+      glm::vec2 edge_point;
+      const VertexRef target = snap_to_vertices
+        ? scene.find_nearest_vertex(world_pos, snap_threshold, dragged_objects)
+        : VertexRef{};
+      if (target.is_valid()) {
+        after = scene.get(target.object)->triangle.get_vertices()[target.vertex];
+      }
+      else if (snap_to_edges && scene.find_nearest_edge_point(world_pos, snap_threshold, dragged_objects, edge_point)) {
+        after = edge_point;
+      }
+      bool moved = false;
+      for (const VertexRef& vertex : dragged_vertices) {
+        const glm::vec2 before = scene.get(vertex.object)->triangle.get_vertices()[vertex.vertex];
+        if (scene.move_vertex(vertex.object, vertex.vertex, after)) {
+          journal.record(vertex.object, vertex.vertex, before, after);
+          moved = true;
+        }
+      }
+      if (moved) {
+        latency.on_input(event_ns);
+        autosaver.mark_dirty();
+      }
+    };
+
+    const auto end_drag = [&] {
+      journal.end_group();
+      if (input_queue.is_capturing()) {
+        // Put the visible cursor back onto the vertex it was dragging.
+        glm::vec2 release_pos = {0, 0};
+        if (const SceneObject* object = scene.get(dragged_vertex.object)) {
+          release_pos = world_to_screen(camera, window_size, object->triangle.get_vertices()[dragged_vertex.vertex]);
+        }
+        input_queue.end_capture(release_pos.x, release_pos.y);
+      }
+      dragging_vertex = false;
+      dragged_vertex = {};
+      dragged_vertices.clear();
+      dragged_objects.clear();
+    };
+
+    // Replays queued mouse events in arrival order, so short clicks and intermediate drag motion are not lost.
+    const auto handle_mouse_event = [&](const InputEvent& event) {
+      const glm::vec2 world_pos = screen_to_world(camera, window_size, {event.x, event.y});
+      if (event.type == InputEvent::Type::CURSOR) {
+        if (dragging_vertex) drag_to(world_pos, event.time_ns);
+        if (box_selecting) box_end = world_pos;
+        return;
+      }
+      if (event.button != GLFW_MOUSE_BUTTON_LEFT) return;
+
+      const bool shift = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ||
+        glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS;
+      if (event.action == GLFW_PRESS && !dragging_vertex && !box_selecting && shift &&
+          !ImGui::GetIO().WantCaptureMouse) {
+        box_selecting = true;
+        box_start = box_end = world_pos;
+      }
+      else if (event.action == GLFW_RELEASE && box_selecting) {
+        box_selecting = false;
+        box_end = world_pos;
+        scene.query_triangles({glm::min(box_start, box_end), glm::max(box_start, box_end)}, box_indices);
+        box_selection.clear();
+        for (const std::uint32_t index : box_indices) box_selection.push_back(scene.get_objects().id_at(index));
+      }
+      else if (event.action == GLFW_PRESS && !dragging_vertex && !box_selecting &&
+               !ImGui::GetIO().WantCaptureMouse) {
+        box_selection.clear();
+        dragged_vertex = scene.pick_vertex(world_pos);
+        dragging_vertex = dragged_vertex.is_valid();
+        selected_object = dragging_vertex ? dragged_vertex.object : scene.pick_object(world_pos);
+        latency.on_input(event.time_ns);
+        if (dragging_vertex) {
+          dragged_vertices.clear();
+          if (drag_welded_vertices) {
+            scene.find_coincident(dragged_vertex, renderer.get_weld_epsilon(), dragged_vertices);
+          }
+          else {
+            dragged_vertices.push_back(dragged_vertex);
+          }
+          dragged_objects.clear();
+          for (const VertexRef& vertex : dragged_vertices) dragged_objects.push_back(vertex.object);
+          journal.begin_group();
+          input_queue.begin_capture();
+        }
+      }
+      else if (event.action == GLFW_RELEASE && dragging_vertex) {
+        end_drag();
+      }
+    };
+
     HeronSteps steps = {3.0f, 4.0f, 5.0f};
     steps.calculate();
 
+    std::size_t frame_index = 0;
+
     std::cout << "INFO: Starting game loop\n";
     while (!glfwWindowShouldClose(window)) {
+      FrameArena::get().reset();
+      AllocTracker::new_frame();
+      Profiler::new_frame();
+      latency.begin_frame();
+      latency.set_mode(is_vsync ? "vsync" : unlock_fps ? "unlocked" : "cap " + std::to_string(max_fps));
+
+      {
+        HG_SCOPED_TIMER("Poll events");
+        glfwPollEvents();
+      }
+
       // Calculate delta time
       current_time = glfwGetTime();
       timer = current_time - previous_time;
@@ -212,7 +371,6 @@ int main() {
       double mouse_x, mouse_y;
       glfwGetCursorPos(window, &mouse_x, &mouse_y);
       glm::vec2 mouse_pos = {mouse_x, mouse_y};
-      glm::vec2 mouse_world_pos = screen_to_world(camera, window_size, mouse_pos);
 
       const float aspect_ratio = static_cast<float>(window_width) / static_cast<float>(window_height);
 
@@ -229,6 +387,7 @@ int main() {
       }
 
       {
+        HG_SCOPED_TIMER("Camera pan");
         if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
           if (!isRightMousePressed) {
             isRightMousePressed = true;
@@ -260,43 +419,87 @@ int main() {
 
 
       {
-        if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
-          if (!dragging_vertex) {
-            for (int i = 0; i < 3; ++i) {
-              if (distance_squared(mouse_world_pos, triangle.get_vertices()[i]) < 0.09f) {
-                dragging_vertex = true;
-                selected_vertex = i;
-                break;
-              }
-            }
-          }
-          else if (selected_vertex != -1) {
-            if (glm::vec2 snapped_pos = snap_to_grid(mouse_world_pos); snapped_pos != triangle.get_vertices()[
-              selected_vertex]) {
-              triangle.move_vertex(selected_vertex, snapped_pos);
-            }
-          }
-        }
-        else if (dragging_vertex) {
-          dragging_vertex = false;
-          selected_vertex = -1;
+        HG_SCOPED_TIMER("Vertex drag");
+        input_queue.drain(handle_mouse_event);
+      }
+
+      {
+        HG_SCOPED_TIMER("Hover");
+        hovered_object = dragging_vertex || box_selecting || ImGui::GetIO().WantCaptureMouse
+          ? ObjectId{}
+          : scene.pick_object(screen_to_world(camera, window_size, mouse_pos));
+      }
+
+      {
+        // Ctrl+Z undo, Ctrl+Y / Ctrl+Shift+Z redo; not while a drag is still recording.
+        const bool ctrl = glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS ||
+          glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS;
+        const bool shift = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ||
+          glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS;
+        const bool z = glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS;
+        const bool undo_pressed = ctrl && !shift && z;
+        const bool redo_pressed = ctrl && (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS || (shift && z));
+        if (!dragging_vertex && !ImGui::GetIO().WantCaptureKeyboard) {
+          if (undo_pressed && !isUndoPressed && journal.undo(scene)) autosaver.mark_dirty();
+          if (redo_pressed && !isRedoPressed && journal.redo(scene)) autosaver.mark_dirty();
         }
+        isUndoPressed = undo_pressed;
+        isRedoPressed = redo_pressed;
       }
 
       // Rendering
-      glClearColor(background_color.x, background_color.y, background_color.z, 1.0f);
-      glClear(GL_COLOR_BUFFER_BIT);
-
-      renderer.set_color(grid_color);
-      renderer.draw_grid(camera.get_projection(), camera.get_view(), grid_model);
+      renderer.begin_frame();
+      {
+        HG_SCOPED_TIMER("Scene");
+        glClearColor(background_color.x, background_color.y, background_color.z, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        renderer.set_color(grid_color);
+        renderer.draw_grid(camera.get_projection(), camera.get_view(), grid_model);
+
+        if (dragging_vertex) {
+          // Late latch: pick up motion that arrived while this frame was being built, right before the upload.
+          HG_SCOPED_TIMER("Late latch");
+          glfwPollEvents();
+          input_queue.drain(handle_mouse_event);
+        }
 
-      renderer.set_color(triangle_color);
-      renderer.draw_triangle(triangle, camera.get_projection(), camera.get_view(), triangle_model);
+        renderer.draw_scene(scene, camera.get_projection(), camera.get_view(), triangle_model);
 
-      for (int i = 0; i < 3; ++i) {
-        bool selected = dragging_vertex && i == selected_vertex;
-        renderer.set_color(selected ? triangle_vertex_selected_color : triangle_vertex_color);
-        renderer.draw_circle(triangle.get_vertices()[i], 0.15f, camera.get_projection(), camera.get_view());
+        const auto add_outline = [&](const ObjectId id) {
+          if (const SceneObject* object = scene.get(id)) {
+            const auto& corners = object->triangle.get_vertices();
+            for (int i = 0; i < 3; ++i) {
+              outline_endpoints.push_back(corners[i]);
+              outline_endpoints.push_back(corners[(i + 1) % 3]);
+            }
+          }
+        };
+        outline_endpoints.clear();
+        for (std::size_t i = 0; i < std::min(box_selection.size(), MAX_OUTLINED_TRIANGLES); ++i) {
+          add_outline(box_selection[i]);
+        }
+        if (box_selecting) {
+          const glm::vec2 corners[] = {box_start, {box_end.x, box_start.y}, box_end, {box_start.x, box_end.y}};
+          for (int i = 0; i < 4; ++i) {
+            outline_endpoints.push_back(corners[i]);
+            outline_endpoints.push_back(corners[(i + 1) % 4]);
+          }
+        }
+        renderer.set_color(selection_outline_color);
+        renderer.draw_lines(outline_endpoints, camera.get_projection(), camera.get_view());
+        outline_endpoints.clear();
+        add_outline(hovered_object);
+        renderer.set_color(hover_outline_color);
+        renderer.draw_lines(outline_endpoints, camera.get_projection(), camera.get_view());
+
+        if (const SceneObject* selected = scene.get(selected_object)) {
+          for (int i = 0; i < 3; ++i) {
+            bool dragged = dragging_vertex && dragged_vertex.object == selected_object && i == dragged_vertex.vertex;
+            renderer.set_color(dragged ? triangle_vertex_selected_color : triangle_vertex_color);
+            renderer.draw_circle(selected->triangle.get_vertices()[i], 0.15f, camera.get_projection(), camera.get_view());
+          }
+        }
       }
 
       ImGui_ImplOpenGL3_NewFrame();
@@ -306,6 +509,10 @@ int main() {
       bool save_screenshot = false;
       bool save_scene = false;
       bool load_scene = false;
+      bool undo = false;
+      bool redo = false;
+      bool add_triangle = false;
+      bool remove_selected = false;
       bool exit = false;
       if (ImGui::BeginMainMenuBar()) {
         if (ImGui::BeginMenu("File")) {
@@ -318,11 +525,36 @@ int main() {
           if (ImGui::MenuItem("Load scene", "Ctrl+O")) {
             load_scene = true;
           }
+          if (ImGui::MenuItem("Autosave", nullptr, &autosave_enabled)) {
+            autosaver.set_enabled(autosave_enabled);
+          }
           if (ImGui::MenuItem("Exit", "Alt+F4")) {
             exit = true;
           }
           ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Edit")) {
+          if (ImGui::MenuItem("Undo", "Ctrl+Z", false, journal.can_undo() && !dragging_vertex)) {
+            undo = true;
+          }
+          if (ImGui::MenuItem("Redo", "Ctrl+Y", false, journal.can_redo() && !dragging_vertex)) {
+            redo = true;
+          }
+          ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("Scene")) {
+          if (ImGui::MenuItem("Add triangle")) {
+            add_triangle = true;
+          }
+          if (ImGui::MenuItem("Remove selected", nullptr, false,
+                              scene.contains(selected_object) || !box_selection.empty())) {
+            remove_selected = true;
+          }
+          ImGui::MenuItem("Drag welded vertices together", nullptr, &drag_welded_vertices);
+          ImGui::MenuItem("Snap to vertices", nullptr, &snap_to_vertices);
+          ImGui::MenuItem("Snap to edges", nullptr, &snap_to_edges);
+          ImGui::EndMenu();
+        }
         ImGui::EndMainMenuBar();
       }
 
@@ -332,16 +564,80 @@ int main() {
         std::cout << "INFO: Saved screenshot as screenshot.png\n";
       }
 
+      if (undo) {
+        if (journal.undo(scene)) autosaver.mark_dirty();
+        undo = false;
+      }
+
+      if (redo) {
+        if (journal.redo(scene)) autosaver.mark_dirty();
+        redo = false;
+      }
+
+      if (add_triangle) {
+        std::array<glm::vec2, 3> vertices = Triangle(3.0f, 4.0f, 5.0f).get_vertices();
+        const glm::vec2 origin = snap_to_grid(camera.get_position());
+        for (glm::vec2& vertex : vertices) vertex += origin;
+        selected_object = scene.add_triangle(vertices);
+        autosaver.mark_dirty();
+        add_triangle = false;
+      }
+
+      if (remove_selected) {
+        if (scene.remove(selected_object)) autosaver.mark_dirty();
+        for (const ObjectId id : box_selection) {
+          if (scene.remove(id)) autosaver.mark_dirty();
+        }
+        selected_object = {};
+        box_selection.clear();
+        remove_selected = false;
+      }
+
       if (save_scene) {
-        save_scene_to_file("scene.json", triangle, triangle_color);
+        HG_SCOPED_TIMER("Save scene");
+        autosaver.submit(make_scene_snapshot(scene));
         save_scene = false;
-        std::cout << "INFO: Saved scene to scene.json\n";
+        std::cout << "INFO: Saving scene to " << autosaver.get_filename() << '\n';
+      }
+      else if (autosaver.wants_snapshot()) {
+        HG_SCOPED_TIMER("Autosave snapshot");
+        autosaver.submit(make_scene_snapshot(scene));
       }
 
       if (load_scene) {
-        load_scene_from_file("scene.json", triangle, triangle_color);
+        if (scene_loader.start(autosaver.get_filename())) {
+          std::cout << "INFO: Loading scene from " << autosaver.get_filename() << '\n';
+        }
         load_scene = false;
-        std::cout << "INFO: Loaded scene from scene.json\n";
+      }
+
+      switch (scene_loader.poll()) {
+      case SceneLoader::State::DONE: {
+        HG_SCOPED_TIMER("Apply scene");
+        apply_scene_snapshot(*scene_loader.take_result(), scene);
+        selected_object = scene.empty() ? ObjectId{} : scene.get_objects().id_at(0);
+        box_selection.clear();
+        if (dragging_vertex) end_drag();
+        journal.clear();
+        autosaver.mark_clean();
+        std::cout << "INFO: Loaded scene from " << autosaver.get_filename() << '\n';
+        break;
+      }
+      case SceneLoader::State::FAILED:
+        std::cerr << "ERROR: Failed to load scene: " << scene_loader.get_error() << '\n';
+        break;
+      case SceneLoader::State::CANCELLED:
+        std::cout << "INFO: Cancelled loading scene\n";
+        break;
+      default:
+        break;
+      }
+
+      if (scene_loader.is_loading()) {
+        ImGui::Begin("Loading scene", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_AlwaysAutoResize);
+        ImGui::ProgressBar(scene_loader.get_progress(), ImVec2(240, 0));
+        if (ImGui::Button("Cancel")) scene_loader.cancel();
+        ImGui::End();
       }
 
       if (exit) {
@@ -350,18 +646,26 @@ int main() {
         glfwSetWindowShouldClose(window, true);
       }
 
-      auto sides = triangle.get_sides();
+      const SceneObject* selected = scene.get(selected_object);
 
       {
         ImGui::Begin("Properties");
-        ImGui::InputFloat("Side A", &sides[0], 0.1f, 1.0f, "%.2f");
-        ImGui::InputFloat("Side B", &sides[1], 0.1f, 1.0f, "%.2f");
-        ImGui::InputFloat("Side C", &sides[2], 0.1f, 1.0f, "%.2f");
+        ImGui::Text("Triangles: %zu", scene.size());
         ImGui::Separator();
-        ImGui::Text("Triangle Area: %.2f", triangle.get_area());
-        ImGui::Separator();
-        for (auto vertex : triangle.get_vertices()) {
-          ImGui::Text("(%.2f %.2f)", vertex.x, vertex.y);
+        if (selected) {
+          auto sides = selected->triangle.get_sides();
+          ImGui::InputFloat("Side A", &sides[0], 0.1f, 1.0f, "%.2f");
+          ImGui::InputFloat("Side B", &sides[1], 0.1f, 1.0f, "%.2f");
+          ImGui::InputFloat("Side C", &sides[2], 0.1f, 1.0f, "%.2f");
+          ImGui::Separator();
+          ImGui::Text("Triangle Area: %.2f", selected->triangle.get_area());
+          ImGui::Separator();
+          for (auto vertex : selected->triangle.get_vertices()) {
+            ImGui::Text("(%.2f %.2f)", vertex.x, vertex.y);
+          }
+        }
+        else {
+          ImGui::Text("No triangle selected");
         }
         ImGui::End();
       } // ImGui Properties
@@ -372,9 +676,17 @@ int main() {
         ImGui::Begin("Colors");
         ImGui::ColorEdit4("Background", glm::value_ptr(background_color));
         ImGui::ColorEdit4("Grid", glm::value_ptr(grid_color));
-        ImGui::ColorEdit4("Triangle", glm::value_ptr(triangle_color));
+        if (selected) {
+          glm::vec4 triangle_color = selected->color;
+          if (ImGui::ColorEdit4("Triangle", glm::value_ptr(triangle_color)) &&
+              scene.set_color(selected_object, triangle_color)) {
+            autosaver.mark_dirty();
+          }
+        }
         ImGui::ColorEdit4("Vertex", glm::value_ptr(triangle_vertex_color));
         ImGui::ColorEdit4("Selected Vertex", glm::value_ptr(triangle_vertex_selected_color));
+        ImGui::ColorEdit4("Hover Outline", glm::value_ptr(hover_outline_color));
+        ImGui::ColorEdit4("Selection Outline", glm::value_ptr(selection_outline_color));
         ImGui::End();
       } // ImGui Colors
 
@@ -386,11 +698,93 @@ int main() {
 
         ImGui::Separator();
 
+        renderer.get_gpu_timer().render_stats();
+
+        ImGui::Text("Draw calls: %u", renderer.get_stats().draw_calls);
+        const GLState::Stats gl_state = GLState::get_last_frame();
+        ImGui::Text("GL state changes: %llu issued, %llu skipped", static_cast<unsigned long long>(gl_state.issued),
+                    static_cast<unsigned long long>(gl_state.skipped));
+        ImGui::Text("Uploaded: %zu bytes", renderer.get_stats().bytes_uploaded);
+        ImGui::Text("Vertex quantization error: %.2g", static_cast<double>(renderer.get_quantization_error()));
+        ImGui::Text("Scene vertices: %zu welded from %zu", renderer.get_scene_vertex_count(), scene.size() * 3);
+        ImGui::Text("Visible triangles: %zu / %zu", renderer.get_visible_triangle_count(), scene.size());
+        ImGui::Text("Box selection: %zu triangles", box_selection.size());
+        bool lod_enabled = renderer.is_lod_enabled();
+        if (ImGui::Checkbox("Zoomed-out LOD", &lod_enabled)) renderer.set_lod_enabled(lod_enabled);
+        ImGui::Text("Density raster: %.0f%% opaque, last built in %.1f ms",
+                    static_cast<double>(renderer.get_lod_blend()) * 100.0,
+                    renderer.get_density_raster().get_last_duration_ms());
+        float weld_epsilon = renderer.get_weld_epsilon();
+        if (ImGui::InputFloat("Weld epsilon", &weld_epsilon, 0.0f, 0.0f, "%.5f")) {
+          renderer.set_weld_epsilon(std::max(weld_epsilon, 0.0f));
+        }
+
+        const FrameArena& arena = FrameArena::get();
+        ImGui::Text("Frame arena: %zu / %zu KB, peak %zu KB, %zu overflows", arena.get_used() / 1024,
+                    arena.get_capacity() / 1024, arena.get_peak() / 1024, arena.get_overflow_count());
+        AllocTracker::render_stats();
+
+        ImGui::Separator();
+
+        GpuResources::render_stats();
+        BufferPool::get().render_stats();
+
+        ImGui::Separator();
+
+        if (InputQueue::is_raw_motion_supported() && ImGui::Checkbox("Raw mouse motion", &raw_mouse_motion)) {
+          input_queue.set_raw_motion(raw_mouse_motion);
+        }
+        ImGui::Text("Dropped input events: %llu", static_cast<unsigned long long>(input_queue.get_dropped()));
+        latency.render_stats();
+
+        ImGui::Separator();
+
+        const EditJournal::Stats history = journal.get_stats();
+        ImGui::Text("Undo: %zu entries, redo: %zu entries", history.undo_entries, history.redo_entries);
+        ImGui::Text("History memory: %zu bytes, spilled: %zu entries (%zu bytes)", history.memory_bytes,
+                    history.spilled_entries, history.spilled_bytes);
+
+        ImGui::Separator();
+
+        const AutoSaver::Status autosave = autosaver.get_status();
+        if (!autosave.last_error.empty()) {
+          ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Autosave failed: %s", autosave.last_error.c_str());
+        }
+        else if (autosave.saving) {
+          ImGui::Text("Autosave: saving...");
+        }
+        else if (autosave.has_saved) {
+          const double seconds_ago = std::chrono::duration<double>(AutoSaver::clock::now() - autosave.last_save).count();
+          ImGui::Text("Autosave: %.0f s ago (%.2f ms, %zu saves)", seconds_ago, autosave.last_duration_ms,
+                      autosave.save_count);
+        }
+        else {
+          ImGui::Text("Autosave: %s", autosaver.is_enabled() ? "nothing to save yet" : "off");
+        }
+
+        ImGui::Separator();
+
         ImGui::Checkbox("VSync", &want_vsync);
         ImGui::Checkbox("Unlock FPS", &unlock_fps);
         if (!unlock_fps) {
           ImGui::SliderInt("Max FPS", &max_fps, 15, 240);
           ImGui::Text("Target FPS: %d", max_fps);
+
+          if (frame_pacer.is_timerfd_available() && ImGui::Checkbox("Use timerfd", &use_timerfd)) {
+            frame_pacer.set_use_timerfd(use_timerfd);
+          }
+
+          const FramePacer::Stats pacing = frame_pacer.get_stats();
+          ImGui::Text("Pacing error p50: %.1f us", pacing.p50_us);
+          ImGui::Text("Pacing error p99: %.1f us", pacing.p99_us);
+          ImGui::Text("Pacing error max: %.1f us", pacing.max_us);
+          ImGui::Text("Spin threshold: %.0f us",
+                      std::chrono::duration<double, std::micro>(frame_pacer.get_spin_threshold()).count());
+
+          static float pacing_history[FramePacer::ERROR_HISTORY];
+          const auto pacing_count = frame_pacer.copy_error_history(pacing_history, FramePacer::ERROR_HISTORY);
+          ImGui::PlotLines("##pacing", pacing_history, static_cast<int>(pacing_count), 0, "Pacing error (us)", 0.0f,
+                           FLT_MAX, ImVec2(0, 60));
         }
         else {
           ImGui::Text("Target FPS: Unlimited");
@@ -399,19 +793,64 @@ int main() {
         ImGui::End();
       } // ImGui Debug
 
+      Profiler::render_panel();
 
-      ImGui::Render();
-      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      {
+        HG_SCOPED_TIMER("ImGui render");
+        GpuTimerScope gpu_scope{renderer.get_gpu_timer(), "ImGui"};
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      }
 
+      {
+        HG_SCOPED_TIMER("Present");
+        latency.before_swap();
+        glfwSwapBuffers(window);
+        latency.after_swap();
+      }
 
-      glfwSwapBuffers(window);
-      glfwPollEvents();
+      if (!unlock_fps) {
+        HG_SCOPED_TIMER("Frame pacing");
+        frame_pacer.set_target_fps(max_fps);
+        frame_pacer.wait();
+      }
+      else {
+        frame_pacer.reset();
+      }
 
-      if (!unlock_fps) limit_fps(max_fps, unlock_fps);
+      if (zero_alloc_frames > 0) {
+        // From here on the render thread must not touch the heap.
+        ++frame_index;
+        if (frame_index == warmup_frames) AllocTracker::watch_thread(true);
+        if (frame_index == warmup_frames + zero_alloc_frames) glfwSetWindowShouldClose(window, GLFW_TRUE);
+      }
     } // end of game loop
+    AllocTracker::watch_thread(false);
+
+    // Edits still waiting for the debounce or interval would be lost otherwise; ~AutoSaver() writes this out.
+    if (autosaver.is_enabled() && autosaver.has_unsaved_changes()) {
+      autosaver.submit(make_scene_snapshot(scene));
+      std::cout << "INFO: Saving scene to " << autosaver.get_filename() << '\n';
+    }
+
+    if (zero_alloc_frames > 0) {
+      if (AllocTracker::get_violations() > 0) {
+        AllocTracker::report_violations();
+        exit_code = EXIT_FAILURE;
+      }
+      else if (frame_index >= warmup_frames + zero_alloc_frames) {
+        std::cout << "INFO: No heap allocations in " << zero_alloc_frames << " frames after warm-up\n";
+      }
+      else {
+        std::cerr << "ERROR: Zero allocation test stopped after " << frame_index << " frames\n";
+        exit_code = EXIT_FAILURE;
+      }
+    }
 
     std::cout << "INFO: Cleaning up...\n";
   } // end of renderer
+  BufferPool::get().clear();
+  GpuResources::report_leaks();
 
   // Cleanup
   ImGui_ImplOpenGL3_Shutdown();
@@ -419,7 +858,7 @@ int main() {
   if (ImGui::GetCurrentContext() != nullptr) ImGui::DestroyContext();
   glfwTerminate();
   std::cout << "INFO: Successfully cleaned up\n";
-  return EXIT_SUCCESS;
+  return exit_code;
 }
 
 #ifdef HERON_RELEASE
@@ -0,0 +1,136 @@
+﻿#include "render_bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/constants.hpp>
+#include <nlohmann/json.hpp>
+
+#include "Camera.h"
+#include "GLState.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "scene_generator.h"
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  double percentile(std::vector<double> values, const double p) {
+    if (values.empty()) return 0.0;
+    const auto nth = values.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+  }
+
+  double mean(const std::vector<double>& values) {
+    if (values.empty()) return 0.0;
+    return std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+  }
+}
+
+int run_render_bench(GLFWwindow* window, const RenderBenchOptions& options) {
+  int width = 0, height = 0;
+  glfwGetFramebufferSize(window, &width, &height);
+  width = std::max(width, 1);
+  height = std::max(height, 1);
+  GLState::viewport(0, 0, width, height);
+  glfwSwapInterval(0);
+
+  Renderer renderer;
+  renderer.init();
+
+  const glm::vec2 window_size{width, height};
+  Camera camera{window_size, {0, 0}};
+
+  const auto generate_start = clock::now();
+  const std::vector<glm::vec2> vertices = generate_random_triangles(options.triangles, options.seed);
+  Scene scene;
+  scene.reserve(options.triangles);
+  for (std::size_t i = 0; i + 2 < vertices.size(); i += 3) {
+    scene.add_triangle({vertices[i], vertices[i + 1], vertices[i + 2]});
+  }
+  const double generate_ms = std::chrono::duration<double, std::milli>(clock::now() - generate_start).count();
+
+  renderer.upload_scene(scene);
+  const std::size_t initial_upload_bytes = renderer.get_stats().bytes_uploaded;
+
+  const auto grid_color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  const auto model = glm::mat4(1.0f);
+
+  std::vector<double> frame_ms;
+  std::vector<double> draw_calls;
+  std::vector<double> bytes_uploaded;
+  frame_ms.reserve(options.frames);
+  draw_calls.reserve(options.frames);
+  bytes_uploaded.reserve(options.frames);
+
+  const std::size_t total_frames = options.warmup_frames + options.frames;
+  for (std::size_t frame = 0; frame < total_frames && !glfwWindowShouldClose(window); ++frame) {
+    const auto frame_start = clock::now();
+
+    // Scripted path: one orbit around the scene while zooming out to the scroll limit and back.
+    const float t = static_cast<float>(frame) / static_cast<float>(std::max<std::size_t>(total_frames, 1));
+    const float angle = 2.0f * glm::pi<float>() * t;
+    camera.set_position({std::cos(angle) * 60.0f, std::sin(angle) * 60.0f});
+    camera.set_zoom(1.0f + 4.5f * (1.0f - std::cos(angle)));
+    camera.update_matrix(window_size);
+
+    renderer.begin_frame();
+    glClearColor(0.98f, 0.98f, 0.98f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    renderer.set_color(grid_color);
+    renderer.draw_grid(camera.get_projection(), camera.get_view(), model);
+    renderer.draw_scene(scene, camera.get_projection(), camera.get_view(), model);
+
+    // Wait for the GPU so frame times include rendering, not just command submission.
+    glFinish();
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+
+    if (frame < options.warmup_frames) continue;
+    frame_ms.push_back(std::chrono::duration<double, std::milli>(clock::now() - frame_start).count());
+    draw_calls.push_back(renderer.get_stats().draw_calls);
+    bytes_uploaded.push_back(static_cast<double>(renderer.get_stats().bytes_uploaded));
+  }
+
+  const nlohmann::json report = {
+    {"triangles", options.triangles},
+    {"frames", frame_ms.size()},
+    {"seed", options.seed},
+    {"resolution", {width, height}},
+    {"gl_renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER))},
+    {"generate_ms", generate_ms},
+    {"initial_upload_bytes", initial_upload_bytes},
+    {"frame_ms", {
+      {"mean", mean(frame_ms)},
+      {"p50", percentile(frame_ms, 0.50)},
+      {"p90", percentile(frame_ms, 0.90)},
+      {"p99", percentile(frame_ms, 0.99)},
+      {"max", frame_ms.empty() ? 0.0 : *std::max_element(frame_ms.begin(), frame_ms.end())}
+    }},
+    {"draw_calls_per_frame", mean(draw_calls)},
+    {"bytes_uploaded_per_frame", mean(bytes_uploaded)}
+  };
+
+  if (options.json_path.empty()) {
+    std::cout << report.dump(2) << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  std::ofstream file(options.json_path);
+  file << report.dump(2) << '\n';
+  if (!file) {
+    std::cerr << "ERROR: Failed to write " << options.json_path << '\n';
+    return EXIT_FAILURE;
+  }
+  std::cout << "INFO: Wrote render benchmark to " << options.json_path << '\n';
+  return EXIT_SUCCESS;
+}
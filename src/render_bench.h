@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct GLFWwindow;
+
+struct RenderBenchOptions {
+  std::size_t triangles = 0;
+  std::size_t frames = 600;
+  std::size_t warmup_frames = 30;
+  std::uint64_t seed = 1;
+  std::string json_path; // stdout when empty
+};
+
+// Renders a generated scene along a scripted camera path and reports frame statistics as JSON.
+// Runs fine in a hidden window, e.g. `xvfb-run -a env LIBGL_ALWAYS_SOFTWARE=1 HeronTriangle --bench-render 100000`.
+int run_render_bench(GLFWwindow* window, const RenderBenchOptions& options);
@@ -1,37 +1,83 @@
 ﻿#pragma once
 
-#include <nlohmann/json.hpp>
-#include <fstream>
+#include <charconv>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
 
-#include "Triangle.h"
+#include "Scene.h"
+#include "SceneLoader.h"
+#include "SceneSnapshot.h"
+#include "atomic_file.h"
 
-void save_scene_to_file(const std::string& filename, const Triangle& triangle, const glm::vec4& triangle_color) {
-  nlohmann::json scene;
+inline std::shared_ptr<const SceneSnapshot> make_scene_snapshot(const Scene& scene) {
+  return scene.make_snapshot();
+}
+
+// Writes the scene straight into one string, one triangle per line:
+// { "count": N, "triangles": [ { "vertices": [[x, y], ...], "color": [r, g, b, a] }, ... ] }
+// "count" comes first so the streaming loader can reserve before the array starts.
+inline std::string serialize_scene(const SceneSnapshot& snapshot) {
+  std::string out;
+  out.reserve(64 + snapshot.colors.size() * 160);
 
-  scene["triangle"]["vertices"] = {
-    {triangle.get_vertices()[0].x, triangle.get_vertices()[0].y},
-    {triangle.get_vertices()[1].x, triangle.get_vertices()[1].y},
-    {triangle.get_vertices()[2].x, triangle.get_vertices()[2].y}
+  char number[32];
+  const auto append = [&](const float value) {
+    if (!std::isfinite(value)) {
+      // JSON has no inf/nan; keep the file loadable.
+      out += '0';
+      return;
+    }
+    const auto result = std::to_chars(number, number + sizeof(number), value);
+    out.append(number, result.ptr);
   };
 
-  scene["triangle"]["color"] = {triangle_color.r, triangle_color.g, triangle_color.b, triangle_color.a};
+  out += "{\n  \"count\": ";
+  out += std::to_string(snapshot.colors.size());
+  out += ",\n  \"triangles\": [";
+  for (std::size_t i = 0; i < snapshot.colors.size(); ++i) {
+    out += i == 0 ? "\n    {\"vertices\": [" : ",\n    {\"vertices\": [";
+    for (std::size_t v = 0; v < 3; ++v) {
+      const glm::vec2& vertex = snapshot.vertices[i * 3 + v];
+      out += v == 0 ? "[" : ", [";
+      append(vertex.x);
+      out += ", ";
+      append(vertex.y);
+      out += ']';
+    }
+    out += "], \"color\": [";
+    const glm::vec4& color = snapshot.colors[i];
+    for (int c = 0; c < 4; ++c) {
+      if (c != 0) out += ", ";
+      append(color[c]);
+    }
+    out += "]}";
+  }
+  out += snapshot.colors.empty() ? "]\n}\n" : "\n  ]\n}\n";
+  return out;
+}
+
+inline bool save_scene_to_file(const std::string& filename, const SceneSnapshot& snapshot) {
+  return write_file_atomic(filename, serialize_scene(snapshot));
+}
 
-  std::ofstream file(filename);
-  file << scene.dump(2);
+inline bool save_scene_to_file(const std::string& filename, const Scene& scene) {
+  return save_scene_to_file(filename, *scene.make_snapshot());
 }
 
-void load_scene_from_file(const std::string& filename, Triangle& triangle, glm::vec4& triangle_color) {
-  std::ifstream file(filename);
-  nlohmann::json scene;
-  file >> scene;
-
-  auto vertices = scene["triangle"]["vertices"];
-  triangle.set_vertices({
-      glm::vec2(vertices[0][0], vertices[0][1]),
-      glm::vec2(vertices[1][0], vertices[1][1]),
-      glm::vec2(vertices[2][0], vertices[2][1])
-  });
-
-  auto color = scene["triangle"]["color"];
-  triangle_color = glm::vec4(color[0], color[1], color[2], color[3]);
-}
\ No newline at end of file
+inline void apply_scene_snapshot(const SceneSnapshot& snapshot, Scene& scene) {
+  scene.load_snapshot(snapshot);
+}
+
+inline bool load_scene_from_file(const std::string& filename, Scene& scene) {
+  SceneSnapshot snapshot;
+  std::string error;
+  if (!load_scene_snapshot(filename, snapshot, &error)) {
+    std::cerr << "ERROR: Failed to load scene: " << error << '\n';
+    return false;
+  }
+
+  apply_scene_snapshot(snapshot, scene);
+  return true;
+}
@@ -0,0 +1,57 @@
+﻿#include "scene_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+#include "util.h"
+
+namespace {
+  constexpr std::size_t CHUNK_SIZE = 16384;
+
+  void generate_chunk(glm::vec2* out, const std::size_t count, const std::uint64_t seed, const std::size_t chunk,
+                      const float extent, const float max_size) {
+    std::seed_seq seq{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+                      static_cast<std::uint32_t>(chunk)};
+    std::mt19937 rng{seq};
+    std::uniform_real_distribution<float> center_dist(-extent, extent);
+    std::uniform_real_distribution<float> offset_dist(-max_size, max_size);
+
+    const float min_area = max_size * max_size * 0.01f;
+    for (std::size_t i = 0; i < count; ++i) {
+      const glm::vec2 center{center_dist(rng), center_dist(rng)};
+      glm::vec2 a, b, c;
+      float area;
+      do {
+        a = center + glm::vec2(offset_dist(rng), offset_dist(rng));
+        b = center + glm::vec2(offset_dist(rng), offset_dist(rng));
+        c = center + glm::vec2(offset_dist(rng), offset_dist(rng));
+        area = std::abs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y)) * 0.5f;
+      } while (area < min_area);
+
+      out[i * 3 + 0] = a;
+      out[i * 3 + 1] = b;
+      out[i * 3 + 2] = c;
+    }
+  }
+}
+
+std::vector<glm::vec2> generate_random_triangles(const std::size_t count, const std::uint64_t seed, const float extent,
+                                                 const float max_size) {
+  std::vector<glm::vec2> vertices(count * 3);
+
+  const std::size_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  const std::size_t workers = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, std::max<std::size_t>(chunks, 1));
+
+  const auto work = [&](const std::size_t worker) {
+    for (std::size_t chunk = worker; chunk < chunks; chunk += workers) {
+      const std::size_t first = chunk * CHUNK_SIZE;
+      generate_chunk(vertices.data() + first * 3, std::min(CHUNK_SIZE, count - first), seed, chunk, extent, max_size);
+    }
+  };
+
+  run_parallel(workers, work);
+
+  return vertices;
+}
@@ -0,0 +1,14 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Generates `count` random non-degenerate triangles (3 vertices each), centered inside [-extent, extent]^2 with
+// corners up to `max_size` further out on each axis, so within [-extent - max_size, extent + max_size]^2.
+// Work is split into fixed-size chunks with their own seeded RNG, so the result only depends on
+// `seed`, not on the number of worker threads.
+std::vector<glm::vec2> generate_random_triangles(std::size_t count, std::uint64_t seed, float extent = 100.0f,
+                                                 float max_size = 1.0f);
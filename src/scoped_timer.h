@@ -7,13 +7,25 @@
 * used for profiling
 * speed measure
 * 
+* every timer is recorded as a zone
+* in the in-app Profiler (see Profiler.h)
+* 
 * define HG_TIMER_OFF
 * if you want to disable
 * timer e.g. for release
+*
+* with HERON_TRACK_ALLOCATIONS
+* zones also attribute heap
+* allocations (see AllocTracker.h)
 */
 
-#include <iostream>
-#include <chrono>
+#include <string>
+
+#include "Profiler.h"
+
+#ifdef HERON_TRACK_ALLOCATIONS
+#include "AllocTracker.h"
+#endif
 
 #ifdef HG_TIMER_OFF
 
@@ -36,43 +48,49 @@ public:
 
   ~ScopedTimer();
 
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  // Ends the zone early, returns the elapsed time in microseconds.
   long long stop();
 
 private:
   const char* m_name;
-  std::chrono::time_point<std::chrono::high_resolution_clock> m_start_point;
+  std::uint64_t m_start_ticks;
   bool m_stopped;
 };
 
-ScopedTimer::ScopedTimer(const char* name) : m_name{ name } {
-  m_start_point = std::chrono::high_resolution_clock::now();
+inline ScopedTimer::ScopedTimer(const char* name) : m_name{ name } {
+  Profiler::begin_zone(m_name);
+#ifdef HERON_TRACK_ALLOCATIONS
+  AllocTracker::push_zone(m_name);
+#endif
+  m_start_ticks = Profiler::now_ticks();
   m_stopped = false;
 }
 
-ScopedTimer::ScopedTimer(const std::string& name) : m_name{ name.c_str() } {
-  m_start_point = std::chrono::high_resolution_clock::now();
+inline ScopedTimer::ScopedTimer(const std::string& name) : m_name{ Profiler::intern(name) } {
+  Profiler::begin_zone(m_name);
+#ifdef HERON_TRACK_ALLOCATIONS
+  AllocTracker::push_zone(m_name);
+#endif
+  m_start_ticks = Profiler::now_ticks();
   m_stopped = false;
 }
 
-ScopedTimer::ScopedTimer() {
-  m_name = "";
-  m_start_point = std::chrono::high_resolution_clock::now();
-  m_stopped = false;
-}
+inline ScopedTimer::ScopedTimer() : ScopedTimer("") {}
 
-ScopedTimer::~ScopedTimer() {
+inline ScopedTimer::~ScopedTimer() {
   if (!m_stopped) stop();
 }
 
-long long ScopedTimer::stop() {
-  const auto end_point = std::chrono::high_resolution_clock::now();
-
-  const long long start = std::chrono::time_point_cast<std::chrono::microseconds>(m_start_point).time_since_epoch().count();
-  const long long end = std::chrono::time_point_cast<std::chrono::microseconds>(end_point).time_since_epoch().count();
-  const long long diff = end - start;
-
-  std::cout << "[TIMER] " << m_name << ' ' << diff << "ms\n";
+inline long long ScopedTimer::stop() {
+  const std::uint64_t end_ticks = Profiler::now_ticks();
+  Profiler::end_zone(m_name);
+#ifdef HERON_TRACK_ALLOCATIONS
+  AllocTracker::pop_zone();
+#endif
 
   m_stopped = true;
-  return diff;
-}
\ No newline at end of file
+  return static_cast<long long>(Profiler::ticks_to_us(end_ticks - m_start_ticks));
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct StringHash {
+  using is_transparent = void;
+
+  std::size_t operator()(const std::string_view value) const noexcept {
+    return std::hash<std::string_view>{}(value);
+  }
+};
+
+// String-keyed map that can be looked up with a literal or string_view without building a std::string.
+template <typename T>
+using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Runs work(worker) on `workers` threads, the calling thread included.
+template <typename Work>
+void run_parallel(const std::size_t workers, const Work& work) {
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (std::size_t worker = 1; worker < workers; ++worker) threads.emplace_back(work, worker);
+  work(0);
+  for (std::thread& thread : threads) thread.join();
+}
+
+// splitmix64 finalizer: spreads packed grid keys over every bit, for open-addressed tables indexed by the low bits.
+inline std::uint64_t hash_key(std::uint64_t key) {
+  key ^= key >> 30;
+  key *= 0xBF58476D1CE4E5B9ull;
+  key ^= key >> 27;
+  key *= 0x94D049BB133111EBull;
+  return key ^ (key >> 31);
+}
+
+// Clamped to [0, 1] and rounded. Memory order R, G, B, A on little-endian, matching GL_UNSIGNED_BYTE x4.
+inline std::uint32_t pack_rgba8(const glm::vec4& color) {
+  const auto channel = [](const float value) {
+    return static_cast<std::uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+  };
+  return channel(color.r) | channel(color.g) << 8 | channel(color.b) << 16 | channel(color.a) << 24;
+}
@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+/*
+* Compact vertex formats
+*
+* CPU-side encoders for the attribute types VertexBufferLayout accepts
+* besides float: IEEE half floats, signed normalized 16-bit integers and
+* the packed signed 10-10-10-2 format. The GPU decodes all of them in the
+* input assembler, so shaders still see floats.
+*/
+
+struct half {
+  std::uint16_t bits;
+};
+
+// x, y, z in the low 30 bits and w in the top 2 (GL_INT_2_10_10_10_REV, normalized).
+struct packed_10_10_10_2 {
+  std::uint32_t bits;
+};
+
+// Round to nearest even; out-of-range values become infinity.
+inline half float_to_half(const float value) {
+  const std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+  const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+  const std::uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+  if (magnitude >= 0x7F800000u) {
+    const std::uint16_t nan = magnitude > 0x7F800000u ? 0x0200u : 0u;
+    return {static_cast<std::uint16_t>(sign | 0x7C00u | nan)};
+  }
+  if (magnitude >= 0x477FF000u) return {static_cast<std::uint16_t>(sign | 0x7C00u)};
+
+  if (magnitude < 0x38800000u) {
+    // Below the smallest normal half: shift the full mantissa into a subnormal.
+    if (magnitude < 0x33000000u) return {sign};
+    const std::uint32_t exponent = magnitude >> 23;
+    const std::uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+    const std::uint32_t shift = 126 - exponent;
+    std::uint32_t result = mantissa >> shift;
+    const std::uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const std::uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (result & 1u))) ++result;
+    return {static_cast<std::uint16_t>(sign | result)};
+  }
+
+  std::uint32_t result = (magnitude - 0x38000000u) >> 13;
+  const std::uint32_t remainder = magnitude & 0x1FFFu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (result & 1u))) ++result;
+  return {static_cast<std::uint16_t>(sign | result)};
+}
+
+inline float half_to_float(const half value) {
+  const std::uint32_t sign = static_cast<std::uint32_t>(value.bits & 0x8000u) << 16;
+  const std::uint32_t exponent = (value.bits >> 10) & 0x1Fu;
+  const std::uint32_t mantissa = value.bits & 0x3FFu;
+  if (exponent == 0x1F) return std::bit_cast<float>(sign | 0x7F800000u | mantissa << 13);
+  if (exponent == 0) {
+    const float subnormal = std::ldexp(static_cast<float>(mantissa), -24);
+    return sign ? -subnormal : subnormal;
+  }
+  return std::bit_cast<float>(sign | (exponent + 112) << 23 | mantissa << 13);
+}
+
+// GL decodes a normalized signed integer c with b bits as max(c / (2^(b-1) - 1), -1).
+inline std::int16_t float_to_snorm16(const float value) {
+  return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline float snorm16_to_float(const std::int16_t value) {
+  return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+inline packed_10_10_10_2 pack_snorm_10_10_10_2(const glm::vec4& value) {
+  const auto component = [](const float v, const float max, const std::uint32_t mask) {
+    return static_cast<std::uint32_t>(static_cast<std::int32_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * max))) & mask;
+  };
+  return {component(value.x, 511.0f, 0x3FFu) | component(value.y, 511.0f, 0x3FFu) << 10 |
+          component(value.z, 511.0f, 0x3FFu) << 20 | component(value.w, 1.0f, 0x3u) << 30};
+}
+
+/*
+* Position quantizer
+*
+* Maps positions inside a bounding box to signed normalized 16-bit
+* coordinates around the box center. The shader reverses it with
+* origin + scale * position; the error per axis is half a step,
+* scale / 32767 / 2, plus float rounding, so smaller boxes keep more
+* precision.
+*/
+struct PositionQuantizer {
+  glm::vec2 origin;
+  glm::vec2 scale;
+
+  static PositionQuantizer from_bounds(const glm::vec2& min, const glm::vec2& max) {
+    constexpr float MIN_SCALE = 1e-6f;
+    const glm::vec2 half_extent = (max - min) * 0.5f;
+    return {(min + max) * 0.5f, {std::max(half_extent.x, MIN_SCALE), std::max(half_extent.y, MIN_SCALE)}};
+  }
+
+  [[nodiscard]] glm::i16vec2 quantize(const glm::vec2& position) const {
+    const glm::vec2 local = (position - origin) / scale;
+    return {float_to_snorm16(local.x), float_to_snorm16(local.y)};
+  }
+
+  [[nodiscard]] glm::vec2 dequantize(const glm::i16vec2& position) const {
+    return origin + scale * glm::vec2{snorm16_to_float(position.x), snorm16_to_float(position.y)};
+  }
+
+  [[nodiscard]] float get_max_error() const {
+    return std::max(scale.x, scale.y) / (2.0f * 32767.0f);
+  }
+};